@@ -1,25 +1,93 @@
 #include "Actor.hpp"
+#include <algorithm>
 
 namespace itc
 {
 	////////////////////////////////////////////////////////////////////////////
 
-	Actor::Actor()
+	Actor::Actor() : Position(0.0f, 0.0f, 0.0f), Rotation(quat::IDENTITY), Scale(1.0f, 1.0f, 1.0f), Lod(0), Mip(-1), Occluder(false)
 	{
+		saveState();
 	}
 
 	Actor::~Actor()
 	{
 	}
 
-	void Actor::affineTransform(mat4& outModelViewProj, const mat4& viewProj) const
+	static void affine_transform(mat4& outModelViewProj, const mat4& viewProj,
+								 const vec3& pos, const quat& rot, const vec3& scale)
 	{
-		mat4 affine;
-		mat4::from_position(affine, Position);
-		affine.scale(Scale);
-		affine.multiply(mat4::from_rotation(mat4{}, Rotation));
+		mat4 affine, rotation;
+		mat4::from_position(affine, pos);
+		affine.scale(scale);
+		affine.multiply(mat4::from_rotation(rotation, rot));
 		outModelViewProj = viewProj;
-		outModelViewProj.multiply(affine);	}
+		outModelViewProj.multiply(affine);
+	}
+
+	void Actor::affineTransform(mat4& outModelViewProj, const mat4& viewProj) const
+	{
+		affine_transform(outModelViewProj, viewProj, Position, Rotation, Scale);
+	}
+
+	void Actor::affineTransform(mat4& outModelViewProj, const mat4& viewProj, float alpha) const
+	{
+		affine_transform(outModelViewProj, viewProj,
+			lerp(PrevPosition, Position, alpha),
+			nlerp(PrevRotation, Rotation, alpha), // one fixed step apart, so nlerp is as good as slerp
+			lerp(PrevScale,    Scale,    alpha));
+	}
+
+	void Actor::modelTransform(mat4& outModel, float alpha) const
+	{
+		affineTransform(outModel, IDENTITY, alpha);
+	}
+
+	void Actor::saveState()
+	{
+		PrevPosition = Position;
+		PrevRotation = Rotation;
+		PrevScale    = Scale;
+	}
+
+	void Actor::boundingSphere(vec3& outCenter, float& outRadius) const
+	{
+		// through the same translate * scale * rotate matrix the mesh is drawn with
+		mat4 model;
+		affineTransform(model, IDENTITY);
+		vec4 c = model.multiply(Mesh->BoundsCenter);
+		outCenter = vec3(c.x, c.y, c.z);
+		outRadius = Mesh->BoundsRadius * max(Scale.x, max(Scale.y, Scale.z));
+	}
+
+	int Actor::selectLod(const LodView& view)
+	{
+		if (!visible())
+			return Lod = -1;
+
+		vec3 center; float radius;
+		boundingSphere(center, radius);
+		return Lod = Mesh->selectLod(view.screenSize(center, radius), Lod);
+	}
+
+	int Actor::selectMip(const LodView& view, float screenHeight)
+	{
+		if (!visible() || Mesh->UvDensity <= 0.0f)
+			return Mip = -1;
+
+		vec3 center; float radius;
+		boundingSphere(center, radius);
+		float size = view.screenSize(center, radius);
+		if (size <= 0.0f || radius <= 0.0f)
+			return Mip = -1;
+
+		// one texel per pixel: every mip halves the texels per world unit
+		float pixelsPerUnit = size * screenHeight / (2.0f * radius);
+		float texelsPerUnit = Mesh->UvDensity * max(Texture->width(), Texture->height())
+		                    / max(Scale.x, max(Scale.y, Scale.z));
+		int mip = (int)floorf(log2f(texelsPerUnit / pixelsPerUnit));
+		return Mip = min(max(mip, 0), Texture->levels() - 1);
+	}
 
 	void Actor::draw(Shader& shader, const mat4& viewProj) const
 	{
@@ -27,9 +95,8 @@ namespace itc
 		affineTransform(modelViewProj, viewProj);
 
 		shader.bind(u_Transform, modelViewProj);
-		shader.bind(u_DiffuseTex, Texture);
-
-		
+		shader.bind(u_DiffuseTex, Texture->handle());
+		Mesh->buffer(Lod < 0 ? 0 : Lod).draw();
 	}
 
 	////////////////////////////////////////////////////////////////////////////
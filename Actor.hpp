@@ -1,5 +1,6 @@
 #pragma once
 #include "StaticMesh.hpp"
+#include "Texture2D.hpp"
 
 namespace itc
 {
@@ -9,11 +10,21 @@ namespace itc
 	{
 	public:
 		vec3 Position;
-		vec3 Rotation;
+		quat Rotation; // orientation, keep it unit length
 		vec3 Scale;
 
-		unique_ptr<BMDModel> Model;
-		sf::Texture Texture;
+		// transform at the previous fixed simulation step, for render interpolation
+		vec3 PrevPosition;
+		quat PrevRotation;
+		vec3 PrevScale;
+
+		shared_ptr<StaticMesh>  Mesh;    // shared between actors
+		shared_ptr<Texture2D>   Texture; // shared between actors
+
+		int Lod; // current level of detail of Mesh, -1 if too small to draw
+		int Mip; // finest mip of Texture needed at the current screen size, -1 if off screen
+
+		bool Occluder; // rendered into the OcclusionBuffer, and never occlusion culled itself
 
 	public:
 		Actor();
@@ -21,7 +32,36 @@ namespace itc
 
 		void affineTransform(mat4& outModelViewProj, const mat4& viewProj) const;
 
+		/** @brief Same as above, but interpolated between the previous and current state */
+		void affineTransform(mat4& outModelViewProj, const mat4& viewProj, float alpha) const;
+
+		/** @brief Interpolated model to world transform, without the view-projection */
+		void modelTransform(mat4& outModel, float alpha) const;
+
+		/** @brief Remembers the current transform as the previous simulation state */
+		void saveState();
+
+		/**
+		 * @brief Updates Lod from the projected size of the mesh bounding sphere,
+		 *        with hysteresis so the LOD doesn't flicker around a threshold
+		 * @return The new Lod
+		 */
+		int selectLod(const LodView& view);
+
+		/**
+		 * @brief Updates Mip so one texel of Texture covers about one pixel, from the
+		 *        projected bounding sphere and the UV density of the mesh
+		 * @return The new Mip
+		 */
+		int selectMip(const LodView& view, float screenHeight);
+
+		/** @brief World space bounding sphere of Mesh */
+		void boundingSphere(vec3& outCenter, float& outRadius) const;
+
 		void draw(Shader& shader, const mat4& viewProj) const;
+
+		/** @return true if this actor has a valid mesh and texture to draw */
+		bool visible() const { return Mesh && *Mesh && Texture; }
 	};
 
 	////////////////////////////////////////////////////////////////////////////
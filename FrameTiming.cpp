@@ -0,0 +1,117 @@
+#include "FrameTiming.hpp"
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#ifdef _WIN32
+	#include <windows.h>
+	#include <mmsystem.h> // timeBeginPeriod
+#endif
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	double time_ms()
+	{
+		using namespace std::chrono;
+		return duration<double, milli>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	int FixedTimestep::advance(double frameTime)
+	{
+		accumulator += frameTime;
+		int steps = (int)(accumulator / step);
+		if (steps > maxSteps) {
+			steps = maxSteps;
+			accumulator = step * maxSteps;
+		}
+		accumulator -= steps * step;
+		return steps;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	FramePacer::FramePacer(double targetFps, double spinMargin)
+		: period(0.0), deadline(0.0), spinMargin(spinMargin)
+	{
+		#ifdef _WIN32
+			timeBeginPeriod(1); // default scheduler granularity is 15.6ms
+		#endif
+		setTargetFps(targetFps);
+	}
+
+	FramePacer::~FramePacer()
+	{
+		#ifdef _WIN32
+			timeEndPeriod(1);
+		#endif
+	}
+
+	void FramePacer::setTargetFps(double fps)
+	{
+		period   = fps > 0.0 ? 1000.0 / fps : 0.0;
+		deadline = time_ms() + period;
+	}
+
+	void FramePacer::wait()
+	{
+		if (period <= 0.0)
+			return;
+
+		double now = time_ms();
+		if (now > deadline + period) {
+			deadline = now + period; // missed a whole frame, don't try to catch up
+			return;
+		}
+
+		double sleepFor = deadline - now - spinMargin;
+		if (sleepFor > 0.0)
+			this_thread::sleep_for(chrono::microseconds((long long)(sleepFor * 1000.0)));
+		while (time_ms() < deadline)
+			this_thread::yield();
+
+		deadline += period;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	static float percentile(const vector<float>& sorted, float p)
+	{
+		int i = (int)ceilf(p * sorted.size()) - 1;
+		return sorted[i < 0 ? 0 : i];
+	}
+
+	FrameStats::Summary FrameStats::summary() const
+	{
+		Summary s = { (int)samples.size(), 0, 0, 0, 0, 0, 0 };
+		if (samples.empty())
+			return s;
+
+		vector<float> sorted = samples;
+		sort(sorted.begin(), sorted.end());
+
+		double sum = 0.0;
+		for (float t : sorted) sum += t;
+		s.mean = (float)(sum / sorted.size());
+		s.p50  = percentile(sorted, 0.50f);
+		s.p90  = percentile(sorted, 0.90f);
+		s.p99  = percentile(sorted, 0.99f);
+		s.max  = sorted.back();
+
+		for (float& t : sorted) t = fabsf(t - s.mean);
+		sort(sorted.begin(), sorted.end());
+		s.jitter99 = percentile(sorted, 0.99f);
+		return s;
+	}
+
+	void FrameStats::print(const char* title) const
+	{
+		Summary s = summary();
+		printf("%s: %d frames, mean %.2fms p50 %.2fms p90 %.2fms p99 %.2fms max %.2fms, jitter p99 %.2fms\n",
+			title, s.count, s.mean, s.p50, s.p90, s.p99, s.max, s.jitter99);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
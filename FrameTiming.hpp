@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/** @return Monotonic time in milliseconds */
+	double time_ms();
+
+	/**
+	 * Fixed timestep accumulator: the simulation always advances in `step` sized
+	 * increments, no matter how long the rendered frame took.
+	 *
+	 *   for (int n = timestep.advance(frameTime); n; --n) update(timestep.step);
+	 *   render(timestep.alpha()); // interpolate between previous and current state
+	 */
+	struct FixedTimestep
+	{
+		double step;        // simulation step in seconds
+		double accumulator; // unsimulated time left over from previous frames
+		int    maxSteps;    // spiral of death guard: drop time if we fall too far behind
+
+		explicit FixedTimestep(double step = 1.0 / 120.0, int maxSteps = 8)
+			: step(step), accumulator(0.0), maxSteps(maxSteps) {}
+
+		/** @return Number of simulation steps to run for this frame */
+		int advance(double frameTime);
+
+		/** @return Interpolation factor [0..1] between the last two simulation states */
+		float alpha() const { return (float)(accumulator / step); }
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Hybrid sleep/spin frame pacer. Sleeps until shortly before the next
+	 * frame deadline and spins the rest, since OS sleeps routinely overshoot
+	 * by a millisecond or more. Deadlines are absolute, so errors don't accumulate.
+	 */
+	class FramePacer
+	{
+		double period;     // target frame period (ms), 0 disables pacing
+		double deadline;   // next frame deadline (ms)
+		double spinMargin; // how long before the deadline we stop sleeping (ms)
+	public:
+		explicit FramePacer(double targetFps = 60.0, double spinMargin = 2.0);
+		~FramePacer();
+
+		void setTargetFps(double fps);
+
+		/** @brief Blocks until the next frame deadline */
+		void wait();
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/** @brief Collects frame times and reports them as percentiles */
+	class FrameStats
+	{
+		vector<float> samples; // frame times in ms
+	public:
+		struct Summary
+		{
+			int   count;
+			float mean, p50, p90, p99, max;
+			float jitter99; // p99 of |frameTime - mean|
+		};
+
+		void reserve(int n) { samples.reserve(n); }
+		void add(float frameTimeMs) { samples.push_back(frameTimeMs); }
+		void clear() { samples.clear(); }
+		int  count() const { return (int)samples.size(); }
+
+		Summary summary() const;
+		void print(const char* title) const;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,271 @@
+#include "JobSystem.hpp"
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	JobDeque::JobDeque() : top(0), bottom(0)
+	{
+		for (auto& j : jobs) j.store(nullptr, memory_order_relaxed);
+	}
+
+	bool JobDeque::push(Job* job)
+	{
+		long long b = bottom.load(memory_order_relaxed);
+		long long t = top.load(memory_order_acquire);
+		if (b - t >= Capacity)
+			return false;
+		jobs[b & (Capacity - 1)].store(job, memory_order_relaxed);
+		bottom.store(b + 1, memory_order_release);
+		return true;
+	}
+
+	Job* JobDeque::pop()
+	{
+		long long b = bottom.load(memory_order_relaxed) - 1;
+		bottom.store(b, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		long long t = top.load(memory_order_relaxed);
+		if (t > b) { // deque was empty
+			bottom.store(b + 1, memory_order_relaxed);
+			return nullptr;
+		}
+		Job* job = jobs[b & (Capacity - 1)].load(memory_order_relaxed);
+		if (t == b) { // last item, race against stealers
+			if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+				job = nullptr;
+			bottom.store(b + 1, memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* JobDeque::steal()
+	{
+		long long t = top.load(memory_order_acquire);
+		atomic_thread_fence(memory_order_seq_cst);
+		long long b = bottom.load(memory_order_acquire);
+		if (t >= b)
+			return nullptr;
+		Job* job = jobs[t & (Capacity - 1)].load(memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+			return nullptr; // another thief or the owner got it first
+		return job;
+	}
+
+	int JobDeque::size() const
+	{
+		long long n = bottom.load(memory_order_relaxed) - top.load(memory_order_relaxed);
+		return n > 0 ? (int)n : 0;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	static thread_local JobSystem* tlsSystem = nullptr;
+	static thread_local int        tlsWorker = -1;
+
+	JobSystem::JobSystem(int numThreads) : running(true), owner(this_thread::get_id()), numInjected(0), sleeping(0)
+	{
+		if (numThreads <= 0)
+			numThreads = (int)thread::hardware_concurrency();
+		if (numThreads <= 0)
+			numThreads = 1;
+
+		for (int i = 0; i < numThreads; ++i) {
+			workers.emplace_back(new Worker());
+			workers.back()->rng = 0x9E3779B9u * (i + 1);
+			for (auto& used : workers.back()->poolUsed) used.store(false, memory_order_relaxed);
+		}
+
+		for (int i = 1; i < numThreads; ++i)
+			threads.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+
+	JobSystem::~JobSystem()
+	{
+		running = false;
+		{
+			lock_guard<mutex> lock(sleepMutex);
+			wakeup.notify_all();
+		}
+		for (thread& t : threads)
+			t.join();
+	}
+
+	int JobSystem::workerIndex() const
+	{
+		// worker threads belong to one system each, the owner thread can own several
+		if (tlsSystem == this)
+			return tlsWorker;
+		return this_thread::get_id() == owner ? 0 : -1;
+	}
+
+	Job* JobSystem::allocJob(int index)
+	{
+		// skip slots whose job hasn't been copied out yet, e.g. an old one still at the top
+		// of the deque or one a thief has taken but not started; only the owner allocates
+		Worker& w = *workers[index];
+		for (int i = 0; i < PoolSize; ++i) {
+			unsigned slot = w.poolNext++ & (PoolSize - 1);
+			if (!w.poolUsed[slot].load(memory_order_acquire)) {
+				w.poolUsed[slot].store(true, memory_order_relaxed);
+				return &w.pool[slot];
+			}
+		}
+		return nullptr; // all jobs of this worker are in flight
+	}
+
+	void JobSystem::releaseJob(Job* slot)
+	{
+		for (auto& w : workers) {
+			if (slot >= w->pool && slot < w->pool + PoolSize) {
+				w->poolUsed[slot - w->pool].store(false, memory_order_release);
+				return;
+			}
+		}
+	}
+
+	void JobSystem::run(JobFunc func, void* arg, JobCounter* counter,
+	                    JobCounter* dependsOn, int begin, int end)
+	{
+		if (counter) counter->pending.fetch_add(1, memory_order_relaxed);
+
+		int index = workerIndex();
+		Job job = { func, arg, begin, end, counter, dependsOn };
+		if (index != -1) {
+			if (Job* j = allocJob(index)) {
+				*j = job;
+				if (workers[index]->deque.push(j)) {
+					notify();
+					return;
+				}
+				releaseJob(j);
+			}
+			// pool or deque full, fall through to the injection queue
+		}
+		{
+			lock_guard<mutex> lock(injectMutex);
+			injected.push_back(job);
+			++numInjected;
+		}
+		notify();
+	}
+
+	void JobSystem::notify()
+	{
+		if (sleeping.load(memory_order_acquire) > 0) {
+			lock_guard<mutex> lock(sleepMutex);
+			wakeup.notify_one();
+		}
+	}
+
+	Job* JobSystem::findJob(int index)
+	{
+		Worker& self = *workers[index];
+		if (Job* job = self.deque.pop())
+			return job;
+
+		// pick victims starting from a random worker to spread contention
+		int n = numWorkers();
+		if (n > 1) {
+			self.rng ^= self.rng << 13, self.rng ^= self.rng >> 17, self.rng ^= self.rng << 5;
+			int start = (int)(self.rng % (unsigned)n);
+			for (int i = 0; i < n; ++i) {
+				int victim = (start + i) % n;
+				if (victim == index) continue;
+				if (Job* job = workers[victim]->deque.steal())
+					return job;
+			}
+		}
+
+		if (numInjected.load(memory_order_acquire) > 0) {
+			if (Job* job = allocJob(index)) {
+				if (takeInjected(*job))
+					return job;
+				releaseJob(job);
+			}
+		}
+		return nullptr;
+	}
+
+	bool JobSystem::takeInjected(Job& out)
+	{
+		if (numInjected.load(memory_order_acquire) == 0)
+			return false;
+		lock_guard<mutex> lock(injectMutex);
+		for (auto it = injected.begin(); it != injected.end(); ++it) {
+			if (it->dependsOn && !it->dependsOn->done())
+				continue; // leave it queued instead of cycling it through execute() again
+			out = *it;
+			injected.erase(it);
+			--numInjected;
+			return true;
+		}
+		return false;
+	}
+
+	void JobSystem::execute(Job* slot)
+	{
+		Job job = *slot; // copy out, the pool slot gets recycled while we run
+		releaseJob(slot);
+		execute(job);
+	}
+
+	void JobSystem::execute(const Job& job)
+	{
+		if (job.dependsOn && !job.dependsOn->done()) {
+			// not ready yet: park it in the FIFO, takeInjected() skips it until the dependency is done
+			lock_guard<mutex> lock(injectMutex);
+			injected.push_back(job);
+			++numInjected;
+			return;
+		}
+		job.func(job.arg, job.begin, job.end);
+		// the last job of a counter may unblock parked dependents, wake a sleeper to run them
+		if (job.counter && job.counter->pending.fetch_sub(1, memory_order_release) == 1
+		    && numInjected.load(memory_order_acquire) > 0)
+			notify();
+	}
+
+	void JobSystem::wait(JobCounter& counter)
+	{
+		int index = workerIndex();
+		Job injectedJob;
+		while (!counter.done())
+		{
+			// foreign threads have no deque or pool, but can still run the injected jobs
+			Job* job = index != -1 ? findJob(index) : nullptr;
+			if (job) execute(job);
+			else if (index == -1 && takeInjected(injectedJob)) execute(injectedJob);
+			else this_thread::yield();
+		}
+	}
+
+	void JobSystem::workerLoop(int index)
+	{
+		tlsSystem = this;
+		tlsWorker = index;
+
+		int idleSpins = 0;
+		while (running.load(memory_order_relaxed))
+		{
+			if (Job* job = findJob(index)) {
+				execute(job);
+				idleSpins = 0;
+				continue;
+			}
+			if (++idleSpins < 64) {
+				this_thread::yield();
+				continue;
+			}
+
+			// nothing to steal for a while, go to sleep until new work arrives
+			unique_lock<mutex> lock(sleepMutex);
+			++sleeping;
+			wakeup.wait_for(lock, chrono::milliseconds(2));
+			--sleeping;
+			idleSpins = 0;
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <deque>
+#include <memory>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Dependency counter - incremented for every job scheduled against it
+	 * and decremented when that job finishes. A counter of 0 means all work is done.
+	 * Jobs can be made dependent on a counter, so a chain of counters forms a simple DAG.
+	 */
+	struct JobCounter
+	{
+		atomic<int> pending;
+		JobCounter() : pending(0) {}
+		bool done() const { return pending.load(memory_order_acquire) == 0; }
+	};
+
+	typedef void (*JobFunc)(void* arg, int begin, int end);
+
+	struct Job
+	{
+		JobFunc     func;      // job entry point
+		void*       arg;       // user data passed to func
+		int         begin;     // [begin, end) range for parallel_for style jobs
+		int         end;
+		JobCounter* counter;   // decremented when this job finishes; can be null
+		JobCounter* dependsOn; // job won't run until this counter reaches 0; can be null
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Chase-Lev work stealing deque. The owner thread push()es and pop()s
+	 * at the bottom, any other thread can steal() from the top. Lock-free.
+	 */
+	class JobDeque
+	{
+		static const int Capacity = 4096; // must be a power of 2
+		atomic<long long> top;
+		atomic<long long> bottom;
+		atomic<Job*> jobs[Capacity];
+	public:
+		JobDeque();
+		/** @return false if the deque is full. Owner thread only. */
+		bool push(Job* job);
+		/** @return LIFO job or null if empty. Owner thread only. */
+		Job* pop();
+		/** @return FIFO job or null if empty or the race was lost. Any thread. */
+		Job* steal();
+		int size() const;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Work-stealing job scheduler with one worker per core.
+	 * The thread that created the JobSystem acts as worker 0 and helps out
+	 * whenever it wait()s, so numWorkers() includes the calling thread.
+	 *
+	 * Threads that are not workers can still schedule jobs, those go through
+	 * a small locked injection queue, and run queued jobs while they wait().
+	 */
+	class JobSystem
+	{
+		static const int PoolSize = 4096; // jobs per worker, must be a power of 2
+
+		struct Worker
+		{
+			JobDeque     deque;
+			Job          pool[PoolSize];     // ring allocator for this worker's jobs
+			atomic<bool> poolUsed[PoolSize]; // set until execute() has copied the job out
+			unsigned     poolNext = 0;
+			unsigned     rng      = 0; // steal victim selection
+		};
+
+		vector<unique_ptr<Worker>> workers;
+		vector<thread> threads;
+		atomic<bool> running;
+		thread::id   owner;      // the constructing thread, worker 0
+
+		mutex injectMutex;       // guards injected jobs from non-worker threads
+		deque<Job> injected;
+		atomic<int> numInjected;
+
+		mutex sleepMutex;
+		condition_variable wakeup;
+		atomic<int> sleeping;
+
+	public:
+		/** @brief Starts numThreads workers, 0 means one per hardware core */
+		explicit JobSystem(int numThreads = 0);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		/** @return Number of workers, including the owner thread */
+		int numWorkers() const { return (int)workers.size(); }
+
+		/** @return Index of the current worker, or -1 if called from a foreign thread */
+		int workerIndex() const;
+
+		/** @brief Schedules a job; counter is incremented now and decremented once the job finishes */
+		void run(JobFunc func, void* arg, JobCounter* counter = nullptr,
+		         JobCounter* dependsOn = nullptr, int begin = 0, int end = 0);
+
+		/** @brief Helps execute jobs until the counter reaches 0 */
+		void wait(JobCounter& counter);
+
+		/**
+		 * @brief Splits [0, count) into batches of at least minBatch and runs
+		 *        func(begin, end) on all workers. Blocks until all batches are done.
+		 */
+		template<class Func> void parallel_for(int count, int minBatch, const Func& func)
+		{
+			if (count <= 0) return;
+			int numBatches = numWorkers() * 4;
+			int batchSize  = (count + numBatches - 1) / numBatches;
+			if (batchSize < minBatch) batchSize = minBatch;
+			if (batchSize >= count) { func(0, count); return; }
+
+			JobCounter counter;
+			JobFunc trampoline = [](void* arg, int begin, int end) {
+				(*(const Func*)arg)(begin, end);
+			};
+			for (int begin = batchSize; begin < count; begin += batchSize) {
+				int end = begin + batchSize;
+				run(trampoline, (void*)&func, &counter, nullptr, begin, end < count ? end : count);
+			}
+			func(0, batchSize); // do the first batch ourselves
+			wait(counter);
+		}
+
+	private:
+		void workerLoop(int index);
+		Job* allocJob(int index);
+		void releaseJob(Job* slot);
+		Job* findJob(int index);
+		bool takeInjected(Job& out);
+		void execute(Job* slot);
+		void execute(const Job& job);
+		void notify();
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,416 @@
+#include "MeshSimplify.hpp"
+#include "JobSystem.hpp"
+#include "FrameTiming.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+#include <stdio.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	// symmetric 4x4 error quadric: sum of w * (n.p + d)^2 over all accumulated planes
+	struct Quadric
+	{
+		double a00, a01, a02, a03;
+		double      a11, a12, a13;
+		double           a22, a23;
+		double                a33;
+		double weight; // total area of the accumulated planes
+
+		void addPlane(const vec3& n, float d, double w)
+		{
+			a00 += w*n.x*n.x; a01 += w*n.x*n.y; a02 += w*n.x*n.z; a03 += w*n.x*d;
+			a11 += w*n.y*n.y; a12 += w*n.y*n.z; a13 += w*n.y*d;
+			a22 += w*n.z*n.z; a23 += w*n.z*d;
+			a33 += w*d*d;
+			weight += w;
+		}
+		void add(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23;
+			a33 += q.a33;
+			weight += q.weight;
+		}
+		double eval(const vec3& v) const
+		{
+			double x = v.x, y = v.y, z = v.z;
+			double e = a00*x*x + 2*a01*x*y + 2*a02*x*z + 2*a03*x
+			         + a11*y*y + 2*a12*y*z + 2*a13*y
+			         + a22*z*z + 2*a23*z
+			         + a33;
+			return e > 0.0 ? e : 0.0;
+		}
+	};
+
+	static const float BorderWeight = 10.0f; // keeps open borders from shrinking
+
+	struct WedgeMap { index_t from, to; };
+
+	struct Simplifier
+	{
+		const vertex3d* verts;
+		int numVerts;
+		SimplifyOptions opt;
+
+		vector<int>  posOf;   // vertex -> welded position
+		vector<vec3> pos;     // welded positions
+		vector<char> border;  // position lies on an open border
+		vector<Quadric> quadrics;
+		vector<vector<int>> posTris; // position -> triangles using it, may contain dead ones
+
+		vector<index_t> tris; // 3 vertex indices per triangle
+		vector<char>    alive;
+		int liveTris = 0;
+
+		int posIndex(int tri, int corner) const { return posOf[tris[tri*3 + corner]]; }
+
+		int cornerOf(int tri, int p) const
+		{
+			for (int c = 0; c < 3; ++c) if (posIndex(tri, c) == p) return c;
+			return -1;
+		}
+
+		void init(const vertex3d* vertices, int numVertices, const index_t* indices, int numIndices)
+		{
+			verts    = vertices;
+			numVerts = numVertices;
+			tris.assign(indices, indices + numIndices);
+			alive.assign(numIndices / 3, 1);
+			liveTris = numIndices / 3;
+
+			// weld split vertices by exact position
+			struct PosHash { size_t operator()(const vec3& v) const {
+				unsigned h[3]; memcpy(h, &v, sizeof(h));
+				return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+			}};
+			struct PosEq { bool operator()(const vec3& a, const vec3& b) const {
+				return a.x == b.x && a.y == b.y && a.z == b.z;
+			}};
+			unordered_map<vec3, int, PosHash, PosEq> welded;
+			posOf.resize(numVertices);
+			for (int v = 0; v < numVertices; ++v)
+			{
+				auto it = welded.find(vertices[v].pos);
+				if (it == welded.end()) {
+					it = welded.emplace(vertices[v].pos, (int)pos.size()).first;
+					pos.push_back(vertices[v].pos);
+				}
+				posOf[v] = it->second;
+			}
+
+			int numPos = (int)pos.size();
+			posTris.resize(numPos);
+			border.assign(numPos, 0);
+			quadrics.assign(numPos, Quadric());
+
+			// edges used by a single triangle are open borders
+			unordered_map<unsigned long long, int> edgeUse;
+			for (int t = 0; t < liveTris; ++t)
+			{
+				for (int c = 0; c < 3; ++c) {
+					posTris[posIndex(t, c)].push_back(t);
+					unsigned long long a = posIndex(t, c), b = posIndex(t, (c + 1) % 3);
+					++edgeUse[a < b ? (a << 32) | b : (b << 32) | a];
+				}
+			}
+
+			for (int t = 0; t < liveTris; ++t)
+			{
+				const vec3& p0 = pos[posIndex(t, 0)];
+				vec3 n = (pos[posIndex(t, 1)] - p0).cross(pos[posIndex(t, 2)] - p0);
+				float len = sqrtf(n.dot(n));
+				if (len <= 0.0f) continue;
+				n = n / len;
+				double area = len * 0.5;
+				for (int c = 0; c < 3; ++c)
+					quadrics[posIndex(t, c)].addPlane(n, -n.dot(p0), area);
+
+				for (int c = 0; c < 3; ++c)
+				{
+					unsigned long long a = posIndex(t, c), b = posIndex(t, (c + 1) % 3);
+					if (edgeUse[a < b ? (a << 32) | b : (b << 32) | a] != 1)
+						continue;
+					border[a] = border[b] = 1;
+					// plane through the border edge, perpendicular to the face
+					vec3 edge = pos[b] - pos[a];
+					vec3 bn = edge.cross(n);
+					float blen = sqrtf(bn.dot(bn));
+					if (blen <= 0.0f) continue;
+					bn = bn / blen;
+					double w = BorderWeight * edge.dot(edge);
+					quadrics[a].addPlane(bn, -bn.dot(pos[a]), w);
+					quadrics[b].addPlane(bn, -bn.dot(pos[a]), w);
+				}
+			}
+		}
+
+		/**
+		 * Checks if collapsing position p onto q keeps seams, borders and face
+		 * orientation intact. Only reads mesh state, so it's safe to call in parallel.
+		 */
+		bool evaluate(int p, int q, double& outCost, double& outError,
+		              WedgeMap* map, int& mapCount, int mapCapacity) const
+		{
+			if (p == q) return false;
+			mapCount = 0;
+			int edgeTris = 0;
+
+			// each split copy of p maps onto the copy of q it shares a triangle with
+			for (int t : posTris[p])
+			{
+				if (!alive[t]) continue;
+				int cq = cornerOf(t, q);
+				if (cq < 0) continue;
+				++edgeTris;
+				index_t wp = tris[t*3 + cornerOf(t, p)];
+				index_t wq = tris[t*3 + cq];
+				int i = 0;
+				for (; i < mapCount; ++i) if (map[i].from == wp) break;
+				if (i < mapCount) {
+					if (map[i].to != wq) return false; // would cut p's attributes in two
+				}
+				else {
+					if (mapCount == mapCapacity) return false;
+					map[mapCount++] = { wp, wq };
+				}
+			}
+			if (edgeTris == 0) return false;
+			if (border[p] && (!border[q] || edgeTris != 1))
+				return false; // borders only collapse along themselves
+
+			const vec3& pp = pos[p];
+			const vec3& pq = pos[q];
+			for (int t : posTris[p])
+			{
+				if (!alive[t]) continue;
+				int cp = cornerOf(t, p);
+				index_t wp = tris[t*3 + cp];
+				int i = 0;
+				for (; i < mapCount; ++i) if (map[i].from == wp) break;
+				if (i == mapCount) return false; // a seam copy of p has no matching copy at q
+				if (cornerOf(t, q) >= 0) continue; // this triangle collapses away
+
+				const vec3& a = pos[posIndex(t, (cp + 1) % 3)];
+				const vec3& b = pos[posIndex(t, (cp + 2) % 3)];
+				vec3 before = (a - pp).cross(b - pp);
+				vec3 after  = (a - pq).cross(b - pq);
+				float lb = before.dot(before), la = after.dot(after);
+				if (la <= 0.0f) return false;
+				float d = before.dot(after);
+				if (d <= 0.0f || d * d < opt.maxNormalTurn * opt.maxNormalTurn * lb * la)
+					return false; // face flips or turns too far
+			}
+
+			double bend = 0.0;
+			for (int i = 0; i < mapCount; ++i) {
+				double dot = verts[map[i].from].norm.dot(verts[map[i].to].norm);
+				bend = max(bend, 1.0 - dot);
+			}
+
+			const Quadric& Q = quadrics[p];
+			double e = Q.eval(pq);
+			vec3 edge = pq - pp;
+			outCost  = e + opt.normalWeight * bend * edge.dot(edge) * Q.weight;
+			outError = Q.weight > 0.0 ? sqrt(e / Q.weight) : 0.0;
+			return true;
+		}
+
+		void collapse(int p, int q, const WedgeMap* map, int mapCount)
+		{
+			for (int t : posTris[p])
+			{
+				if (!alive[t]) continue;
+				if (cornerOf(t, q) >= 0) {
+					alive[t] = 0;
+					--liveTris;
+					continue;
+				}
+				index_t& w = tris[t*3 + cornerOf(t, p)];
+				for (int i = 0; i < mapCount; ++i)
+					if (map[i].from == w) { w = map[i].to; break; }
+				posTris[q].push_back(t);
+			}
+			quadrics[q].add(quadrics[p]);
+			posTris[p].clear();
+
+			// drop dead triangles so adjacency lists don't grow without bound
+			vector<int>& adj = posTris[q];
+			adj.erase(remove_if(adj.begin(), adj.end(), [&](int t) { return !alive[t]; }), adj.end());
+		}
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	void simplify_mesh(SimplifiedMesh& out, const vertex3d* vertices, int numVertices,
+	                   const index_t* indices, int numIndices, int targetIndexCount,
+	                   JobSystem* jobs, const SimplifyOptions& options)
+	{
+		double start = time_ms();
+		Simplifier s;
+		s.opt = options;
+		s.init(vertices, numVertices, indices, numIndices);
+
+		vec3 lo = s.pos.empty() ? vec3(0,0,0) : s.pos[0], hi = lo;
+		for (const vec3& p : s.pos) {
+			lo = vec3(min(lo.x, p.x), min(lo.y, p.y), min(lo.z, p.z));
+			hi = vec3(max(hi.x, p.x), max(hi.y, p.y), max(hi.z, p.z));
+		}
+		vec3 extent = (hi - lo) * 0.5f;
+		float radius = sqrtf(extent.dot(extent));
+		double maxError = options.maxRelativeError * radius;
+
+		out.error = 0.0f;
+		out.collapses = 0;
+		int targetTris = max(targetIndexCount / 3, 1);
+		const int MaxWedges = 16;
+
+		struct Candidate { double cost, error; };
+		vector<Candidate> edgeCost;
+		vector<int>  best;
+		vector<Candidate> bestCost;
+		vector<int>  order;
+		vector<char> locked;
+		int numPos = (int)s.pos.size();
+
+		while (s.liveTris > targetTris)
+		{
+			// evaluate both directions of every triangle edge
+			int numTris = (int)s.alive.size();
+			edgeCost.assign(numTris * 6, Candidate{ -1.0, 0.0 });
+			auto evaluate = [&](int begin, int end) {
+				WedgeMap map[MaxWedges]; int mapCount;
+				for (int t = begin; t < end; ++t)
+				{
+					if (!s.alive[t]) continue;
+					for (int c = 0; c < 3; ++c) {
+						int a = s.posIndex(t, c), b = s.posIndex(t, (c + 1) % 3);
+						Candidate& ab = edgeCost[t*6 + c*2];
+						Candidate& ba = edgeCost[t*6 + c*2 + 1];
+						if (!s.evaluate(a, b, ab.cost, ab.error, map, mapCount, MaxWedges)) ab.cost = -1.0;
+						if (!s.evaluate(b, a, ba.cost, ba.error, map, mapCount, MaxWedges)) ba.cost = -1.0;
+					}
+				}
+			};
+			if (jobs && s.liveTris >= options.parallelMinTris)
+				jobs->parallel_for(numTris, 256, evaluate);
+			else
+				evaluate(0, numTris);
+
+			// cheapest collapse of every position
+			best.assign(numPos, -1);
+			bestCost.assign(numPos, Candidate{ DBL_MAX, 0.0 });
+			for (int t = 0; t < numTris; ++t)
+			{
+				if (!s.alive[t]) continue;
+				for (int c = 0; c < 3; ++c) {
+					int a = s.posIndex(t, c), b = s.posIndex(t, (c + 1) % 3);
+					const Candidate& ab = edgeCost[t*6 + c*2];
+					const Candidate& ba = edgeCost[t*6 + c*2 + 1];
+					if (ab.cost >= 0.0 && ab.cost < bestCost[a].cost) bestCost[a] = ab, best[a] = b;
+					if (ba.cost >= 0.0 && ba.cost < bestCost[b].cost) bestCost[b] = ba, best[b] = a;
+				}
+			}
+
+			order.clear();
+			for (int p = 0; p < numPos; ++p)
+				if (best[p] >= 0 && bestCost[p].error <= maxError) order.push_back(p);
+			if (order.empty()) break;
+			sort(order.begin(), order.end(), [&](int a, int b) { return bestCost[a].cost < bestCost[b].cost; });
+
+			// apply the cheapest half; neighbours of a collapse wait for the next pass
+			locked.assign(numPos, 0);
+			int applied = 0;
+			size_t limit = max<size_t>(order.size() / 2, 1);
+			for (size_t i = 0; i < limit && s.liveTris > targetTris; ++i)
+			{
+				int p = order[i], q = best[p];
+				if (locked[p] || locked[q]) continue;
+
+				WedgeMap map[MaxWedges]; int mapCount;
+				double cost, error;
+				if (!s.evaluate(p, q, cost, error, map, mapCount, MaxWedges) || error > maxError)
+					continue;
+				for (int t : s.posTris[p])
+					if (s.alive[t]) for (int c = 0; c < 3; ++c) locked[s.posIndex(t, c)] = 1;
+
+				s.collapse(p, q, map, mapCount);
+				out.error = max(out.error, (float)error);
+				++applied;
+			}
+			out.collapses += applied;
+			if (!applied) break;
+		}
+
+		// compact the surviving triangles and the vertices they still use
+		vector<int> newIndex(numVertices, -1);
+		out.vertices.clear();
+		out.indices.clear();
+		out.indices.reserve(s.liveTris * 3);
+		for (int t = 0; t < (int)s.alive.size(); ++t)
+		{
+			if (!s.alive[t]) continue;
+			for (int c = 0; c < 3; ++c) {
+				index_t v = s.tris[t*3 + c];
+				if (newIndex[v] < 0) {
+					newIndex[v] = (int)out.vertices.size();
+					out.vertices.push_back(vertices[v]);
+				}
+				out.indices.push_back((index_t)newIndex[v]);
+			}
+		}
+
+		out.relativeError = radius > 0.0f ? out.error / radius : 0.0f;
+		out.timeMs = time_ms() - start;
+	}
+
+	const float DefaultLodRatios[3] = { 0.5f, 0.25f, 0.12f };
+	const float MaxLodTriangleRatio  = 0.75f;
+
+	vector<SimplifiedMesh> generate_lod_chain(const vertex3d* vertices, int numVertices,
+	                                          const index_t* indices, int numIndices,
+	                                          const float* ratios, int numRatios, JobSystem* jobs)
+	{
+		vector<SimplifiedMesh> chain(numRatios);
+		const vertex3d* srcVerts = vertices;
+		const index_t*  srcIndices = indices;
+		int numSrcVerts = numVertices, numSrcIndices = numIndices;
+		for (int i = 0; i < numRatios; ++i)
+		{
+			SimplifiedMesh& lod = chain[i];
+			int target = (int)(numIndices / 3 * ratios[i]) * 3;
+			simplify_mesh(lod, srcVerts, numSrcVerts, srcIndices, numSrcIndices, target, jobs);
+
+			// a level that barely reduces would be drawn where LodScreenSizes expects half the detail
+			if (lod.indices.size() > numSrcIndices * MaxLodTriangleRatio) {
+				printf("  LOD%d stopped at %.1f%%, missed the %.1f%% target and isn't coarser than the previous level, "
+				       "dropping it and any coarser ones\n", i + 1, lod.indices.size() * 100.0 / numIndices, ratios[i] * 100.0f);
+				chain.resize(i);
+				break;
+			}
+
+			// errors of a chain add up, so report them against the full detail mesh
+			if (i > 0) {
+				lod.error += chain[i - 1].error;
+				lod.relativeError += chain[i - 1].relativeError;
+			}
+			printf("  LOD%d %7d tris (%5.1f%%)  error %.4f (%.3f%% of radius)  %.1fms\n",
+				i + 1, (int)lod.indices.size() / 3, lod.indices.size() * 100.0 / numIndices,
+				lod.error, lod.relativeError * 100.0f, lod.timeMs);
+			if (lod.indices.size() > target * 1.1)
+				printf("  LOD%d missed the %.1f%% target\n", i + 1, ratios[i] * 100.0f);
+
+			srcVerts      = lod.vertices.data();
+			srcIndices    = lod.indices.data();
+			numSrcVerts   = (int)lod.vertices.size();
+			numSrcIndices = (int)lod.indices.size();
+		}
+		return chain;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "Shader.hpp" // vertex3d, index_t
+#include <vector>
+
+namespace itc
+{
+	using namespace std;
+	class JobSystem;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	struct SimplifyOptions
+	{
+		float normalWeight = 1.0f;    // cost of bending vertex normals, relative to squared edge length
+		float maxNormalTurn = 0.25f;  // reject collapses that turn a face normal past this cosine (~75 deg)
+		float maxRelativeError = 0.1f; // stop short of the target rather than exceed this error, relative to the bounding radius
+		int   parallelMinTris = 8192; // use the JobSystem for meshes with at least this many triangles
+	};
+
+	/** @brief A simplified mesh and its error measured against the input */
+	struct SimplifiedMesh
+	{
+		vector<vertex3d> vertices;
+		vector<index_t>  indices;
+		float error;         // largest collapse error as a distance in model units
+		float relativeError; // error divided by the input bounding radius
+		int   collapses;     // edge collapses performed
+		double timeMs;       // time spent simplifying
+	};
+
+	/**
+	 * Quadric error metric edge collapse simplifier (Garland-Heckbert).
+	 *
+	 * Vertices are welded by position, so a vertex split along a UV or normal seam
+	 * is collapsed as one point. A collapse only happens along an edge that every
+	 * split copy of the vertex touches, which keeps seams intact. Open borders only
+	 * collapse along the border. Collapses are half-edge collapses onto an existing
+	 * vertex, so no new UVs or normals are interpolated. Normals are preserved by
+	 * penalizing collapses that bend vertex normals and rejecting ones that turn a
+	 * face too far.
+	 *
+	 * Each pass evaluates all candidate collapses, in parallel on large meshes, then
+	 * applies the cheapest independent half of them. Meshes with many hard edges or
+	 * seams may stop short of the target, check the returned index count.
+	 *
+	 * @param targetIndexCount Number of indices to reduce to (3 per triangle)
+	 * @param jobs Optional JobSystem for parallel cost evaluation
+	 */
+	void simplify_mesh(SimplifiedMesh& out, const vertex3d* vertices, int numVertices,
+	                   const index_t* indices, int numIndices, int targetIndexCount,
+	                   JobSystem* jobs = nullptr, const SimplifyOptions& options = SimplifyOptions());
+
+	/** @brief Default LOD chain, as fractions of the full detail triangle count */
+	extern const float DefaultLodRatios[3];
+
+	/** @brief A LOD level with more than this fraction of the previous level's triangles isn't worth keeping */
+	extern const float MaxLodTriangleRatio;
+
+	/**
+	 * @brief Builds a LOD chain, each level simplified from the previous one,
+	 *        and prints the triangle count and error of every level. Levels that miss
+	 *        their target are reported; the chain stops at the first level that isn't
+	 *        coarser than the previous one by MaxLodTriangleRatio, so it can be shorter than numRatios
+	 * @param ratios Target triangle ratios relative to the input, in decreasing order
+	 */
+	vector<SimplifiedMesh> generate_lod_chain(const vertex3d* vertices, int numVertices,
+	                                          const index_t* indices, int numIndices,
+	                                          const float* ratios, int numRatios, JobSystem* jobs = nullptr);
+
+	////////////////////////////////////////////////////////////////////////////////
+}
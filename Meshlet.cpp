@@ -0,0 +1,289 @@
+#include "Meshlet.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	// unit face normal, flipped to the side the vertex normals point to: the shipped
+	// models are wound clockwise, so the winding order alone would point it inwards
+	static vec3 face_normal(const vertex3d* vertices, const index_t* tri)
+	{
+		const vec3& p0 = vertices[tri[0]].pos;
+		vec3 n = (vertices[tri[1]].pos - p0).cross(vertices[tri[2]].pos - p0);
+		if (n.dot(vertices[tri[0]].norm + vertices[tri[1]].norm + vertices[tri[2]].norm) < 0.0f)
+			n = n * -1.0f;
+		float len = sqrtf(n.dot(n));
+		return len > 0.0f ? n / len : vec3(0.0f, 0.0f, 0.0f);
+	}
+
+	void MeshletMesh::build(const vertex3d* vertices, int numVertices, const index_t* srcIndices, int numIndices)
+	{
+		meshlets.clear();
+		indices.clear();
+		indices.reserve(numIndices);
+		int numTris = numIndices / 3;
+
+		// adjacency goes through welded positions so clusters grow across UV and normal seams
+		struct PosHash { size_t operator()(const vec3& v) const {
+			unsigned h[3]; memcpy(h, &v, sizeof(h));
+			return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+		}};
+		struct PosEq { bool operator()(const vec3& a, const vec3& b) const {
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		}};
+		unordered_map<vec3, int, PosHash, PosEq> welded;
+		vector<int> posOf(numVertices);
+		for (int v = 0; v < numVertices; ++v)
+			posOf[v] = welded.emplace(vertices[v].pos, (int)welded.size()).first->second;
+
+		// position -> triangles, as offsets into one flat array
+		int numPos = (int)welded.size();
+		vector<int> adjStart(numPos + 1, 0), adjTris(numTris * 3);
+		for (int i = 0; i < numTris * 3; ++i) ++adjStart[posOf[srcIndices[i]] + 1];
+		for (int p = 0; p < numPos; ++p) adjStart[p + 1] += adjStart[p];
+		vector<int> fill(adjStart.begin(), adjStart.end() - 1);
+		for (int i = 0; i < numTris * 3; ++i) adjTris[fill[posOf[srcIndices[i]]]++] = i / 3;
+
+		// face normals and centroids keep clusters compact and their normal cones narrow
+		vector<vec3> faceNormal(numTris), faceCenter(numTris);
+		for (int t = 0; t < numTris; ++t)
+		{
+			const vec3& p0 = vertices[srcIndices[t*3]].pos;
+			const vec3& p1 = vertices[srcIndices[t*3 + 1]].pos;
+			const vec3& p2 = vertices[srcIndices[t*3 + 2]].pos;
+			faceNormal[t] = face_normal(vertices, &srcIndices[t*3]);
+			faceCenter[t] = (p0 + p1 + p2) / 3.0f;
+		}
+
+		vector<char> used(numTris, 0);
+		vector<int>  candidates;
+		index_t local[MaxVertices];
+		int seed = 0;
+
+		for (;;)
+		{
+			while (seed < numTris && used[seed]) ++seed;
+			if (seed == numTris) break;
+
+			Meshlet m = {};
+			m.firstIndex = (unsigned)indices.size();
+			candidates.clear();
+			candidates.push_back(seed);
+			vec3 centerSum(0.0f, 0.0f, 0.0f), normalSum(0.0f, 0.0f, 0.0f);
+			float radius = 0.0f; // rough cluster size, for scoring only
+
+			for (;;)
+			{
+				// the adjacent triangle that adds the fewest new vertices, then the one
+				// closest to the cluster and facing the same way
+				int best = -1;
+				float bestScore = FLT_MAX;
+				vec3 center = m.triangleCount ? centerSum / (float)m.triangleCount : faceCenter[seed];
+				float normalLen = sqrtf(normalSum.dot(normalSum));
+				vec3 normal = normalLen > 0.0f ? normalSum / normalLen : faceNormal[seed];
+				for (int t : candidates)
+				{
+					if (used[t]) continue;
+					int added = 0;
+					for (int c = 0; c < 3; ++c) {
+						index_t v = srcIndices[t*3 + c];
+						if (find(local, local + m.vertexCount, v) == local + m.vertexCount) ++added;
+					}
+					if (m.vertexCount + added > MaxVertices) continue;
+					vec3 d = faceCenter[t] - center;
+					float spread = m.triangleCount ? sqrtf(d.dot(d)) / (radius + 1e-6f) : 0.0f;
+					float score  = added + spread + 2.0f * (1.0f - faceNormal[t].dot(normal));
+					if (score < bestScore)
+						best = t, bestScore = score;
+				}
+				if (best < 0) break;
+
+				used[best] = 1;
+				centerSum = centerSum + faceCenter[best];
+				normalSum = normalSum + faceNormal[best];
+				vec3 d = faceCenter[best] - center;
+				radius = max(radius, sqrtf(d.dot(d)));
+				for (int c = 0; c < 3; ++c)
+				{
+					index_t v = srcIndices[best*3 + c];
+					indices.push_back(v);
+					if (find(local, local + m.vertexCount, v) == local + m.vertexCount)
+						local[m.vertexCount++] = v;
+					int p = posOf[v];
+					for (int i = adjStart[p]; i < adjStart[p + 1]; ++i)
+						if (!used[adjTris[i]]) candidates.push_back(adjTris[i]);
+				}
+				if (++m.triangleCount == MaxTriangles) break;
+
+				// keep the candidate list from growing with stale entries
+				if (candidates.size() > 512)
+					candidates.erase(remove_if(candidates.begin(), candidates.end(),
+						[&](int t) { return used[t] != 0; }), candidates.end());
+			}
+
+			// bounding sphere around the cluster's AABB center
+			vec3 lo = vertices[local[0]].pos, hi = lo;
+			for (unsigned i = 1; i < m.vertexCount; ++i) {
+				const vec3& p = vertices[local[i]].pos;
+				lo = vec3(min(lo.x, p.x), min(lo.y, p.y), min(lo.z, p.z));
+				hi = vec3(max(hi.x, p.x), max(hi.y, p.y), max(hi.z, p.z));
+			}
+			m.center = (lo + hi) * 0.5f;
+			float sqRadius = 0.0f;
+			for (unsigned i = 0; i < m.vertexCount; ++i) {
+				vec3 d = vertices[local[i]].pos - m.center;
+				sqRadius = max(sqRadius, d.dot(d));
+			}
+			m.radius = sqrtf(sqRadius);
+
+			// normal cone: average face normal and the widest deviation from it
+			vec3 axis(0.0f, 0.0f, 0.0f);
+			vector<vec3> normals(m.triangleCount);
+			for (unsigned t = 0; t < m.triangleCount; ++t)
+			{
+				normals[t] = face_normal(vertices, &indices[m.firstIndex + t*3]);
+				axis = axis + normals[t];
+			}
+			float axisLen = sqrtf(axis.dot(axis));
+			m.coneAxis   = axisLen > 0.0f ? axis / axisLen : vec3(0.0f, 0.0f, 1.0f);
+			m.coneCutoff = 1.0f;
+			if (axisLen > 0.0f)
+			{
+				float minDot = 1.0f;
+				for (const vec3& n : normals)
+					minDot = min(minDot, n.dot(m.coneAxis));
+				if (minDot > 0.0f)
+					m.coneCutoff = sqrtf(1.0f - minDot * minDot);
+			}
+			meshlets.push_back(m);
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	static const char MeshletMagic[4] = { 'M','L','T','3' }; // 3: cones follow the vertex normals
+
+	static unsigned long long fnv1a(unsigned long long hash, const void* data, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i)
+			hash = (hash ^ ((const unsigned char*)data)[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	unsigned long long MeshletMesh::sourceHash(const vertex3d* vertices, int numVertices,
+	                                           const index_t* indices, int numIndices)
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		hash = fnv1a(hash, vertices, sizeof(vertex3d) * numVertices);
+		return fnv1a(hash, indices, sizeof(index_t) * numIndices);
+	}
+
+	bool MeshletMesh::loadFromFile(const string& file, unsigned long long sourceHash, int numVertices)
+	{
+		FILE* f = fopen(file.c_str(), "rb");
+		if (!f)
+			return false;
+		fseek(f, 0, SEEK_END);
+		long size = ftell(f);
+		fseek(f, 0, SEEK_SET);
+
+		char magic[4];
+		unsigned long long hash;
+		int counts[2];
+		bool ok = fread(magic, 4, 1, f) == 1 && memcmp(magic, MeshletMagic, 4) == 0
+		       && fread(&hash, sizeof(hash), 1, f) == 1
+		       && fread(counts, sizeof(counts), 1, f) == 1
+		       && counts[0] >= 0 && counts[1] >= 0
+		       && (long long)size == (long long)(4 + sizeof(hash) + sizeof(counts))
+		                           + counts[0] * (long long)sizeof(Meshlet) + counts[1] * (long long)sizeof(index_t);
+		bool stale = ok && hash != sourceHash;
+		if (ok && !stale) {
+			meshlets.resize(counts[0]);
+			indices.resize(counts[1]);
+			ok = fread(meshlets.data(), sizeof(Meshlet), counts[0], f) == (size_t)counts[0]
+			  && fread(indices.data(), sizeof(index_t), counts[1], f) == (size_t)counts[1];
+		}
+		fclose(f);
+
+		for (size_t i = 0; ok && !stale && i < meshlets.size(); ++i) {
+			const Meshlet& m = meshlets[i];
+			ok = m.triangleCount <= MaxTriangles && m.vertexCount <= MaxVertices
+			  && (unsigned long long)m.firstIndex + 3ull * m.triangleCount <= indices.size();
+		}
+		for (size_t i = 0; ok && !stale && i < indices.size(); ++i)
+			ok = indices[i] < (index_t)numVertices;
+
+		if (!ok || stale) {
+			fprintf(stderr, "MeshletMesh::loadFromFile(): %s file %s\n", stale ? "stale" : "invalid", file.c_str());
+			meshlets.clear();
+			indices.clear();
+			return false;
+		}
+		return true;
+	}
+
+	bool MeshletMesh::saveToFile(const string& file, unsigned long long sourceHash) const
+	{
+		FILE* f = fopen(file.c_str(), "wb");
+		if (!f) {
+			fprintf(stderr, "MeshletMesh::saveToFile(): fopen failed %s\n", file.c_str());
+			return false;
+		}
+		int counts[2] = { (int)meshlets.size(), (int)indices.size() };
+		bool ok = fwrite(MeshletMagic, 4, 1, f) == 1
+		       && fwrite(&sourceHash, sizeof(sourceHash), 1, f) == 1
+		       && fwrite(counts, sizeof(counts), 1, f) == 1
+		       && fwrite(meshlets.data(), sizeof(Meshlet), meshlets.size(), f) == meshlets.size()
+		       && fwrite(indices.data(), sizeof(index_t), indices.size(), f) == indices.size();
+		fclose(f);
+		if (!ok) fprintf(stderr, "MeshletMesh::saveToFile(): fwrite failed %s\n", file.c_str());
+		return ok;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	int MeshletMesh::cull(MeshletDrawList& outList, const mat4& model, float modelScale,
+	                      const Frustum& frustum, const vec3& eye) const
+	{
+		int triangles = 0;
+		int first = outList.size();
+		for (const Meshlet& m : meshlets)
+		{
+			vec4 c = model.multiply(m.center);
+			vec3 center(c.x, c.y, c.z);
+			float radius = m.radius * modelScale;
+			if (!frustum.sphereVisible(center, radius))
+				continue;
+
+			// backfacing if the whole sphere sees the cone from behind
+			if (m.coneCutoff < 1.0f)
+			{
+				vec4 a = model.multiply(vec4{ m.coneAxis.x, m.coneAxis.y, m.coneAxis.z, 0.0f });
+				vec3 axis = vec3(a.x, a.y, a.z) / modelScale;
+				vec3 view = center - eye;
+				if (view.dot(axis) >= m.coneCutoff * sqrtf(view.dot(view)) + radius)
+					continue;
+			}
+
+			// merge with the previous range if it ends where this one starts
+			const GLvoid* offset = (const GLvoid*)(size_t)(m.firstIndex * sizeof(index_t));
+			GLsizei count = m.triangleCount * 3;
+			if (outList.size() > first &&
+				(const char*)outList.offsets.back() + outList.counts.back() * sizeof(index_t) == (const char*)offset)
+				outList.counts.back() += count;
+			else {
+				outList.counts.push_back(count);
+				outList.offsets.push_back(offset);
+			}
+			triangles += m.triangleCount;
+		}
+		return triangles;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
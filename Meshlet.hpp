@@ -0,0 +1,75 @@
+#pragma once
+#include "Shader.hpp" // vertex3d, index_t
+#include <vector>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/** @brief A small cluster of triangles with bounds for per-cluster culling */
+	struct Meshlet
+	{
+		unsigned firstIndex;    // into MeshletMesh::indices
+		unsigned triangleCount; // at most MeshletMesh::MaxTriangles
+		unsigned vertexCount;   // unique vertices, at most MeshletMesh::MaxVertices
+		vec3  center;           // bounding sphere
+		float radius;
+		vec3  coneAxis;         // average facing direction of the triangles
+		float coneCutoff;       // sin of the cone half-angle, 1 if the cluster can't be backface culled
+	};
+
+	/** @brief Survivors of meshlet culling as glMultiDrawElements ranges */
+	struct MeshletDrawList
+	{
+		vector<GLsizei>       counts;  // index counts
+		vector<const GLvoid*> offsets; // byte offsets into the element buffer
+
+		void clear() { counts.clear(); offsets.clear(); }
+		int size() const { return (int)counts.size(); }
+	};
+
+	/**
+	 * A mesh split into meshlets of up to 64 vertices and 124 triangles. The index
+	 * list is the original one reordered so every meshlet is a contiguous range,
+	 * which lets culled draws reuse the mesh's own element buffer.
+	 */
+	struct MeshletMesh
+	{
+		enum { MaxVertices = 64, MaxTriangles = 124 };
+
+		vector<Meshlet> meshlets;
+		vector<index_t> indices; // meshlet ordered copy of the mesh indices
+
+		/** @brief Greedily grows meshlets over shared vertices, preferring the ones that add the fewest new vertices */
+		void build(const vertex3d* vertices, int numVertices, const index_t* indices, int numIndices);
+
+		/** @return Hash of a source mesh, stored in sidecar files to detect stale ones */
+		static unsigned long long sourceHash(const vertex3d* vertices, int numVertices,
+		                                     const index_t* indices, int numIndices);
+
+		/**
+		 * @brief Reads a meshlet sidecar file written by saveToFile()
+		 * @return false if the file is invalid, was built from a different mesh, or has
+		 *         meshlet ranges or indices outside of the source mesh
+		 */
+		bool loadFromFile(const string& file, unsigned long long sourceHash, int numVertices);
+
+		/** @return true if the meshlets were written to file */
+		bool saveToFile(const string& file, unsigned long long sourceHash) const;
+
+		/**
+		 * @brief Rejects meshlets that are outside the frustum or face away from the eye
+		 *        and appends the survivors to outList, merging adjacent ranges
+		 * @param model Model transform of the mesh, assumed to have uniform scale
+		 * @param frustum World space view frustum
+		 * @param eye World space camera position
+		 * @return Number of triangles that survived
+		 */
+		int cull(MeshletDrawList& outList, const mat4& model, float modelScale,
+		         const Frustum& frustum, const vec3& eye) const;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
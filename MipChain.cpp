@@ -0,0 +1,196 @@
+#include "MipChain.hpp"
+#include "JobSystem.hpp"
+#include <emmintrin.h> // SSE2
+#include <algorithm>
+#include <math.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	// weights of one output pixel, taps cover input pixels 2x+first ... 2x+first+count-1
+	struct MipTaps
+	{
+		int   first;
+		int   count;
+		float weights[8];
+	};
+
+	static double bessel_i0(double x)
+	{
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; ++k) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum  += term;
+		}
+		return sum;
+	}
+
+	static MipTaps make_taps(MipFilter filter)
+	{
+		MipTaps taps;
+		if (filter == MipBox) {
+			taps.first = 0, taps.count = 2;
+			taps.weights[0] = taps.weights[1] = 0.5f;
+			return taps;
+		}
+		// sinc at the output rate, windowed to 4 input pixels on either side of the center
+		const double pi = 3.14159265358979, alpha = 4.0, radius = 4.0;
+		taps.first = -3, taps.count = 8;
+		double sum = 0.0, w[8];
+		for (int t = 0; t < 8; ++t) {
+			double d = (taps.first + t) - 0.5; // input pixel center to output pixel center
+			double x = pi * d * 0.5;
+			double sinc   = x != 0.0 ? sin(x) / x : 1.0;
+			double window = bessel_i0(alpha * sqrt(max(0.0, 1.0 - (d / radius) * (d / radius)))) / bessel_i0(alpha);
+			sum += w[t] = sinc * window;
+		}
+		for (int t = 0; t < 8; ++t)
+			taps.weights[t] = (float)(w[t] / sum);
+		return taps;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	struct SrgbTables
+	{
+		enum { EncodeSize = 16384 };
+		float     toLinear[256];
+		sf::Uint8 toSrgb[EncodeSize]; // linear 0..1 in EncodeSize steps
+
+		SrgbTables()
+		{
+			for (int i = 0; i < 256; ++i) {
+				float c = i / 255.0f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < EncodeSize; ++i) {
+				float c = i / (float)(EncodeSize - 1);
+				float s = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+				toSrgb[i] = (sf::Uint8)(s * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	static const SrgbTables& srgb_tables()
+	{
+		static SrgbTables tables;
+		return tables;
+	}
+
+	static void to_linear(const sf::Uint8* rgba, float* out, int count, bool srgb)
+	{
+		const float* table = srgb_tables().toLinear;
+		for (int i = 0; i < count; ++i)
+		{
+			const sf::Uint8* p = rgba + i * 4;
+			float a = p[3] / 255.0f;
+			__m128 color = srgb ? _mm_setr_ps(table[p[0]], table[p[1]], table[p[2]], 1.0f)
+			                    : _mm_setr_ps(p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, 1.0f);
+			_mm_storeu_ps(out + i * 4, _mm_mul_ps(color, _mm_set1_ps(a))); // premultiplied, alpha ends up as a * 1
+		}
+	}
+
+	static void to_rgba8(const float* in, sf::Uint8* rgba, int count, bool srgb)
+	{
+		const sf::Uint8* table = srgb_tables().toSrgb;
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		for (int i = 0; i < count; ++i)
+		{
+			float p[4];
+			_mm_storeu_ps(p, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i * 4), zero), one)); // the Kaiser filter rings a little
+			float a = p[3];
+			float inv = a > 0.0f ? 1.0f / a : 0.0f;
+			sf::Uint8* out = rgba + i * 4;
+			for (int c = 0; c < 3; ++c) {
+				float v = min(p[c] * inv, 1.0f);
+				out[c] = srgb ? table[(int)(v * (SrgbTables::EncodeSize - 1) + 0.5f)] : (sf::Uint8)(v * 255.0f + 0.5f);
+			}
+			out[3] = (sf::Uint8)(a * 255.0f + 0.5f);
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	template<class Func> static void for_rows(JobSystem* jobs, int rows, int minBatch, const Func& func)
+	{
+		if (jobs) jobs->parallel_for(rows, minBatch, func);
+		else      func(0, rows);
+	}
+
+	void generate_mips(vector<TextureLevel>& outLevels, const sf::Uint8* rgba, int width, int height,
+	                   MipFilter filter, bool srgb, JobSystem* jobs)
+	{
+		outLevels.clear();
+		TextureLevel top;
+		top.width  = width;
+		top.height = height;
+		top.data.assign(rgba, rgba + width * height * 4);
+		outLevels.push_back(move(top));
+
+		const MipTaps taps = make_taps(filter);
+		__m128 weights[8];
+		for (int t = 0; t < taps.count; ++t)
+			weights[t] = _mm_set1_ps(taps.weights[t]);
+
+		vector<float> image(width * height * 4), rows, next; // premultiplied linear RGBA
+		for_rows(jobs, height, 16, [&](int begin, int end) {
+			to_linear(rgba + begin * width * 4, &image[begin * width * 4], (end - begin) * width, srgb);
+		});
+
+		while (width > 1 || height > 1)
+		{
+			const int w = max(width / 2, 1), h = max(height / 2, 1);
+			const int srcW = width, srcH = height;
+
+			// horizontal pass: every input row to the new width
+			rows.resize(w * srcH * 4);
+			for_rows(jobs, srcH, 16, [&](int begin, int end) {
+				for (int y = begin; y < end; ++y)
+				{
+					const float* src = &image[y * srcW * 4];
+					float* dst = &rows[y * w * 4];
+					for (int x = 0; x < w; ++x)
+					{
+						__m128 sum = _mm_setzero_ps();
+						for (int t = 0; t < taps.count; ++t) {
+							int sx = min(max(x * 2 + taps.first + t, 0), srcW - 1);
+							sum = _mm_add_ps(sum, _mm_mul_ps(weights[t], _mm_loadu_ps(src + sx * 4)));
+						}
+						_mm_storeu_ps(dst + x * 4, sum);
+					}
+				}
+			});
+
+			// vertical pass to the new height, then back to RGBA8
+			TextureLevel level;
+			level.width  = w;
+			level.height = h;
+			level.data.resize(w * h * 4);
+			next.resize(w * h * 4);
+			for_rows(jobs, h, 8, [&](int begin, int end) {
+				for (int y = begin; y < end; ++y)
+				{
+					const float* src[8];
+					for (int t = 0; t < taps.count; ++t)
+						src[t] = &rows[min(max(y * 2 + taps.first + t, 0), srcH - 1) * w * 4];
+					float* dst = &next[y * w * 4];
+					for (int x = 0; x < w; ++x)
+					{
+						__m128 sum = _mm_setzero_ps();
+						for (int t = 0; t < taps.count; ++t)
+							sum = _mm_add_ps(sum, _mm_mul_ps(weights[t], _mm_loadu_ps(src[t] + x * 4)));
+						_mm_storeu_ps(dst + x * 4, sum);
+					}
+					to_rgba8(dst, &level.data[y * w * 4], w, srgb);
+				}
+			});
+			outLevels.push_back(move(level));
+			image.swap(next);
+			width  = w;
+			height = h;
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "TextureCodec.hpp"
+
+namespace itc
+{
+	using namespace std;
+
+	class JobSystem;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * @brief Builds the full mip chain of an RGBA8 image down to 1x1, as RGBA8 levels.
+	 *        Filtering happens on premultiplied linear floats with SSE, four channels
+	 *        at a time. Each level is filtered from the one above it, with the rows of
+	 *        a level split across the JobSystem.
+	 * @param srgb Color channels are sRGB encoded, so they are filtered in linear space
+	 *             and encoded back; false for data such as normal maps. Alpha is always linear.
+	 * @param outLevels outLevels[0] is a copy of the image
+	 */
+	void generate_mips(vector<TextureLevel>& outLevels, const sf::Uint8* rgba, int width, int height,
+	                   MipFilter filter = MipKaiser, bool srgb = true, JobSystem* jobs = nullptr);
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,228 @@
+#include "OcclusionBuffer.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include <emmintrin.h> // SSE2
+#include <algorithm>
+#include <math.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	static const float NearW = 1e-4f; // vertices with clip w below this are behind the eye
+
+	OcclusionBuffer::OcclusionBuffer() : depth(Width * Height, 1.0f), tileMax(TilesX * TilesY, 1.0f)
+	{
+	}
+
+	void OcclusionBuffer::render(const Occluder* occluders, int count, JobSystem* jobs)
+	{
+		PROFILE_SCOPE("OcclusionBuffer::render");
+		firstVertex.resize(count + 1);
+		firstVertex[0] = 0;
+		numTriangles   = 0;
+		for (int i = 0; i < count; ++i) {
+			firstVertex[i + 1] = firstVertex[i] + occluders[i].mesh->num_verts;
+			numTriangles += occluders[i].mesh->num_indices / 3;
+		}
+		screen.resize(firstVertex[count]);
+
+		auto transformVertices = [&](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+			{
+				const Occluder& o = occluders[i];
+				const vertex3d* v = o.mesh->vertices();
+				vec4* out = &screen[firstVertex[i]];
+				for (int j = 0; j < o.mesh->num_verts; ++j)
+				{
+					vec4 c = o.transform.multiply(v[j].pos);
+					float invW = c.w > NearW ? 1.0f / c.w : 0.0f;
+					out[j].x = (c.x * invW * 0.5f + 0.5f) * Width;
+					out[j].y = (0.5f - c.y * invW * 0.5f) * Height;
+					out[j].z = c.z * invW;
+					out[j].w = c.w;
+				}
+			}
+		};
+		auto rasterize = [&](int begin, int end) {
+			for (int band = begin; band < end; ++band)
+				rasterizeBand(occluders, count, band);
+		};
+
+		const int numBands = Height / BandHeight;
+		if (jobs) {
+			jobs->parallel_for(count, 1, transformVertices);
+			jobs->parallel_for(numBands, 1, rasterize);
+		}
+		else {
+			transformVertices(0, count);
+			rasterize(0, numBands);
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	// edge function a + b*x + c*y, positive on the inside of a counter-clockwise edge
+	struct Edge
+	{
+		float a, b, c;
+		Edge(const vec4& v0, const vec4& v1)
+		{
+			b = v0.y - v1.y;
+			c = v1.x - v0.x;
+			a = -(b * v0.x + c * v0.y);
+		}
+	};
+
+	void OcclusionBuffer::rasterizeBand(const Occluder* occluders, int count, int band)
+	{
+		const int bandTop    = band * BandHeight;
+		const int bandBottom = bandTop + BandHeight;
+		const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f); // pixel centers
+
+		float* bandDepth = &depth[bandTop * Width];
+		fill(bandDepth, bandDepth + BandHeight * Width, 1.0f);
+
+		for (int o = 0; o < count; ++o)
+		{
+			const BMDModel* mesh  = occluders[o].mesh;
+			const index_t*  index = mesh->indices();
+			const vec4*     verts = &screen[firstVertex[o]];
+			for (int t = 0; t + 2 < mesh->num_indices; t += 3)
+			{
+				vec4 v0 = verts[index[t]], v1 = verts[index[t + 1]], v2 = verts[index[t + 2]];
+				if (v0.w <= NearW || v1.w <= NearW || v2.w <= NearW)
+					continue;
+
+				// rows first, most triangles miss this band
+				int minY = max(bandTop,        (int)floorf(min(v0.y, min(v1.y, v2.y))));
+				int maxY = min(bandBottom - 1, (int)ceilf (max(v0.y, max(v1.y, v2.y))));
+				if (minY > maxY) continue;
+				int minX = max(0,         (int)floorf(min(v0.x, min(v1.x, v2.x))));
+				int maxX = min(Width - 1, (int)ceilf (max(v0.x, max(v1.x, v2.x))));
+				if (minX > maxX) continue;
+
+				// both windings are rasterized, occluders don't need to be closed
+				float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+				if (area == 0.0f) continue;
+				if (area < 0.0f) { swap(v1, v2); area = -area; }
+
+				Edge e0(v1, v2), e1(v2, v0), e2(v0, v1); // e0 is the barycentric weight of v0, etc.
+				float invArea = 1.0f / area;
+				float za = (e0.a * v0.z + e1.a * v1.z + e2.a * v2.z) * invArea;
+				float zb = (e0.b * v0.z + e1.b * v1.z + e2.b * v2.z) * invArea;
+				float zc = (e0.c * v0.z + e1.c * v1.z + e2.c * v2.z) * invArea;
+
+				minX &= ~3; // Width is a multiple of 4, so whole quads stay inside the row
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)minX), laneOffsets);
+				__m128 w0Row = _mm_add_ps(_mm_set1_ps(e0.a), _mm_mul_ps(_mm_set1_ps(e0.b), px));
+				__m128 w1Row = _mm_add_ps(_mm_set1_ps(e1.a), _mm_mul_ps(_mm_set1_ps(e1.b), px));
+				__m128 w2Row = _mm_add_ps(_mm_set1_ps(e2.a), _mm_mul_ps(_mm_set1_ps(e2.b), px));
+				__m128 zRow  = _mm_add_ps(_mm_set1_ps(za),   _mm_mul_ps(_mm_set1_ps(zb),   px));
+				__m128 w0Step = _mm_set1_ps(e0.b * 4.0f), w1Step = _mm_set1_ps(e1.b * 4.0f);
+				__m128 w2Step = _mm_set1_ps(e2.b * 4.0f), zStep  = _mm_set1_ps(zb * 4.0f);
+				__m128 zero = _mm_setzero_ps();
+
+				for (int y = minY; y <= maxY; ++y)
+				{
+					float py = y + 0.5f;
+					__m128 w0 = _mm_add_ps(w0Row, _mm_set1_ps(e0.c * py));
+					__m128 w1 = _mm_add_ps(w1Row, _mm_set1_ps(e1.c * py));
+					__m128 w2 = _mm_add_ps(w2Row, _mm_set1_ps(e2.c * py));
+					__m128 z  = _mm_add_ps(zRow,  _mm_set1_ps(zc * py));
+					float* row = &depth[y * Width];
+					for (int x = minX; x <= maxX; x += 4)
+					{
+						__m128 inside = _mm_and_ps(_mm_cmpge_ps(w0, zero),
+						                _mm_and_ps(_mm_cmpge_ps(w1, zero), _mm_cmpge_ps(w2, zero)));
+						if (_mm_movemask_ps(inside))
+						{
+							__m128 old = _mm_loadu_ps(row + x);
+							__m128 nearest = _mm_min_ps(old, z);
+							_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+						}
+						w0 = _mm_add_ps(w0, w0Step);
+						w1 = _mm_add_ps(w1, w1Step);
+						w2 = _mm_add_ps(w2, w2Step);
+						z  = _mm_add_ps(z,  zStep);
+					}
+				}
+			}
+		}
+
+		// the hierarchical level: farthest depth of each 8x8 tile in this band
+		for (int ty = bandTop / TileSize; ty < bandBottom / TileSize; ++ty)
+		{
+			for (int tx = 0; tx < TilesX; ++tx)
+			{
+				__m128 farthest = _mm_setzero_ps();
+				for (int y = ty * TileSize; y < (ty + 1) * TileSize; ++y) {
+					const float* row = &depth[y * Width + tx * TileSize];
+					farthest = _mm_max_ps(farthest, _mm_max_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4)));
+				}
+				float lanes[4];
+				_mm_storeu_ps(lanes, farthest);
+				tileMax[ty * TilesX + tx] = max(max(lanes[0], lanes[1]), max(lanes[2], lanes[3]));
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool OcclusionBuffer::boxVisible(const vec3& boxMin, const vec3& boxMax, const mat4& transform) const
+	{
+		float minX = 1e30f, maxX = -1e30f, minY = 1e30f, maxY = -1e30f, nearestZ = 1e30f;
+		for (int i = 0; i < 8; ++i)
+		{
+			vec3 corner(i & 1 ? boxMax.x : boxMin.x, i & 2 ? boxMax.y : boxMin.y, i & 4 ? boxMax.z : boxMin.z);
+			vec4 c = transform.multiply(corner);
+			if (c.w <= NearW)
+				return true; // the box reaches behind the eye, nothing can cover it
+			float invW = 1.0f / c.w;
+			float x = (c.x * invW * 0.5f + 0.5f) * Width;
+			float y = (0.5f - c.y * invW * 0.5f) * Height;
+			minX = min(minX, x), maxX = max(maxX, x);
+			minY = min(minY, y), maxY = max(maxY, y);
+			nearestZ = min(nearestZ, c.z * invW);
+		}
+
+		int x0 = max(0, (int)floorf(minX)), x1 = min(Width - 1,  (int)ceilf(maxX));
+		int y0 = max(0, (int)floorf(minY)), y1 = min(Height - 1, (int)ceilf(maxY));
+		if (x0 > x1 || y0 > y1)
+			return true; // off screen, that's for frustum culling to decide
+
+		for (int ty = y0 / TileSize; ty <= y1 / TileSize; ++ty)
+		{
+			for (int tx = x0 / TileSize; tx <= x1 / TileSize; ++tx)
+			{
+				if (tileMax[ty * TilesX + tx] < nearestZ)
+					continue; // the whole tile is in front of the box
+
+				int px0 = max(x0, tx * TileSize), px1 = min(x1, tx * TileSize + TileSize - 1);
+				int py0 = max(y0, ty * TileSize), py1 = min(y1, ty * TileSize + TileSize - 1);
+				for (int y = py0; y <= py1; ++y) {
+					const float* row = &depth[y * Width];
+					for (int x = px0; x <= px1; ++x)
+						if (row[x] >= nearestZ) return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void OcclusionBuffer::toPixels(unsigned char* rgba) const
+	{
+		// NDC depth bunches up near 1, so stretch the range that is actually used
+		float nearest = *min_element(depth.begin(), depth.end());
+		float scale   = nearest < 1.0f ? 191.0f / (1.0f - nearest) : 0.0f;
+		for (int i = 0; i < Width * Height; ++i, rgba += 4)
+		{
+			float d = depth[i];
+			unsigned char v = d < 1.0f ? (unsigned char)(64.0f + (1.0f - d) * scale) : 0;
+			rgba[0] = rgba[1] = rgba[2] = v;
+			rgba[3] = 255;
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "StaticMesh.hpp"
+#include <vector>
+
+namespace itc { class JobSystem; }
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/** @brief A mesh rendered into the OcclusionBuffer, ideally a coarse LOD */
+	struct Occluder
+	{
+		const BMDModel* mesh;
+		mat4 transform; // model-view-projection
+	};
+
+	/**
+	 * Low resolution software depth buffer for occlusion culling. Occluders are
+	 * rasterized with SSE, four pixels at a time, in horizontal bands that run on
+	 * the JobSystem workers. Every 8x8 tile also keeps its farthest depth, so most
+	 * bounding box tests are answered without touching individual pixels.
+	 *
+	 * Depth is NDC z, smaller is closer. Triangles crossing the near plane are
+	 * skipped, which can only make the buffer occlude less.
+	 */
+	class OcclusionBuffer
+	{
+	public:
+		enum {
+			Width      = 256,
+			Height     = 128,
+			TileSize   = 8,
+			TilesX     = Width / TileSize,
+			TilesY     = Height / TileSize,
+			BandHeight = 16, // rows per rasterizer job, a multiple of TileSize
+		};
+
+	private:
+		vector<float> depth;   // Width * Height, row 0 is the top of the screen
+		vector<float> tileMax; // TilesX * TilesY, farthest depth in each tile
+		vector<vec4>  screen;  // transformed occluder vertices: pixel x, y, NDC z, clip w
+		vector<int>   firstVertex; // per occluder, into screen
+		int numTriangles = 0;
+
+	public:
+		OcclusionBuffer();
+
+		/** @brief Clears the buffer and rasterizes all occluders, in parallel if jobs is set */
+		void render(const Occluder* occluders, int count, JobSystem* jobs = nullptr);
+
+		/**
+		 * @brief Tests a model space bounding box against the rendered occluders
+		 * @param transform Model-view-projection of the box
+		 * @return false only if every pixel the box covers is behind an occluder
+		 */
+		bool boxVisible(const vec3& boxMin, const vec3& boxMax, const mat4& transform) const;
+
+		/** @brief Writes the depth buffer as Width x Height grayscale RGBA, nearer is brighter */
+		void toPixels(unsigned char* rgba) const;
+
+		/** @return Triangles rasterized by the last render() */
+		int trianglesRendered() const { return numTriangles; }
+
+	private:
+		void rasterizeBand(const Occluder* occluders, int count, int band);
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
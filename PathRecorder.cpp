@@ -0,0 +1,120 @@
+#include "PathRecorder.hpp"
+#include <algorithm>
+#include <limits.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	static float distance_sq(const sf::Vector2f& a, const sf::Vector2f& b)
+	{
+		sf::Vector2f d = a - b;
+		return d.x * d.x + d.y * d.y;
+	}
+
+	static float segment_distance_sq(const sf::Vector2f& p, const sf::Vector2f& a, const sf::Vector2f& b)
+	{
+		sf::Vector2f ab = b - a, ap = p - a;
+		float len = ab.x * ab.x + ab.y * ab.y;
+		float t   = len > 0.0f ? max(0.0f, min(1.0f, (ap.x * ab.x + ap.y * ab.y) / len)) : 0.0f;
+		return distance_sq(p, a + ab * t);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	PathRecorder::PathRecorder(int capacity, float minDistance, float tolerance, int rawPoints)
+		: MinDistance(minDistance), Tolerance(tolerance), RawPoints(rawPoints),
+		  ring(max(capacity, 4)), dirtyFrom(INT_MAX)
+	{
+	}
+
+	bool PathRecorder::add(const sf::Vector2f& point)
+	{
+		if (count && distance_sq(point, (*this)[count - 1]) < MinDistance * MinDistance)
+			return false;
+		if (count == capacity())
+		{
+			simplify();
+			if (count == capacity())
+				dropOldest(capacity() / 4);
+		}
+		ring[(head + count) % ring.size()] = point;
+		++count;
+		if (count - settled > 2 * RawPoints) // simplify in batches, not on every point
+			simplify();
+		return true;
+	}
+
+	void PathRecorder::clear()
+	{
+		head = count = settled = sent = 0;
+		dirtyFrom = 0;
+	}
+
+	int PathRecorder::collect(vector<sf::Vertex>& out, const sf::Color& color)
+	{
+		int from = min(dirtyFrom, sent);
+		for (int i = from; i < count; ++i)
+			out.push_back(sf::Vertex((*this)[i], color));
+		sent      = count;
+		dirtyFrom = INT_MAX;
+		return from;
+	}
+
+	void PathRecorder::simplify()
+	{
+		// the last simplified point anchors the new run, so the path stays connected
+		int start = max(settled - 1, 0);
+		int end   = count - 1 - RawPoints;
+		if (end - start < 2)
+			return;
+
+		scratch.resize(count);
+		for (int i = 0; i < count; ++i)
+			scratch[i] = (*this)[i];
+
+		keep.assign(count, 1);
+		fill(keep.begin() + start + 1, keep.begin() + end, 0);
+		const float tolSq = Tolerance * Tolerance;
+		stack.clear();
+		stack.push_back({ start, end });
+		while (!stack.empty())
+		{
+			pair<int,int> seg = stack.back();
+			stack.pop_back();
+			int   farthest = -1;
+			float maxDist  = tolSq;
+			for (int i = seg.first + 1; i < seg.second; ++i) {
+				float d = segment_distance_sq(scratch[i], scratch[seg.first], scratch[seg.second]);
+				if (d > maxDist) maxDist = d, farthest = i;
+			}
+			if (farthest < 0)
+				continue;
+			keep[farthest] = 1;
+			stack.push_back({ seg.first, farthest });
+			stack.push_back({ farthest, seg.second });
+		}
+
+		// compact back into the ring, starting over at index 0
+		head  = 0;
+		int n = 0;
+		for (int i = 0; i < count; ++i) {
+			if (!keep[i]) continue;
+			if (i == end) settled = n + 1;
+			ring[n++] = scratch[i];
+		}
+		count = n;
+		dirtyFrom = min(dirtyFrom, start + 1);
+	}
+
+	void PathRecorder::dropOldest(int n)
+	{
+		n       = min(n, count);
+		head    = (head + n) % ring.size();
+		count  -= n;
+		settled = max(settled - n, 0);
+		dirtyFrom = 0;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
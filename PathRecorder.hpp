@@ -0,0 +1,62 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Records a 2D path, e.g. the mouse trail, in bounded memory. Points closer
+	 * than MinDistance to the last point are skipped, and only the newest
+	 * RawPoints are kept exactly as recorded. Older points are simplified
+	 * incrementally with Douglas-Peucker; each pass only looks at points that
+	 * haven't been simplified yet. When the ring is still full after that, the
+	 * oldest quarter of the path is dropped.
+	 */
+	class PathRecorder
+	{
+	public:
+		float MinDistance; // pixels
+		float Tolerance;   // max Douglas-Peucker error of simplified points, in pixels
+		int   RawPoints;   // newest points that are never simplified
+
+	private:
+		vector<sf::Vector2f> ring;
+		int head    = 0; // oldest point
+		int count   = 0;
+		int settled = 0; // points [0, settled) are already simplified
+		int sent    = 0; // points handed out by collect()
+		int dirtyFrom;   // first point that changed since collect(), INT_MAX if none
+		vector<sf::Vector2f> scratch;
+		vector<char> keep;
+		vector<pair<int,int>> stack;
+
+	public:
+		explicit PathRecorder(int capacity = 1024, float minDistance = 2.0f,
+		                      float tolerance = 0.75f, int rawPoints = 32);
+
+		/** @return false if the point was too close to the previous one */
+		bool add(const sf::Vector2f& point);
+		void clear();
+
+		int size() const { return count; }
+		int capacity() const { return (int)ring.size(); }
+		const sf::Vector2f& operator[](int i) const { return ring[(head + i) % ring.size()]; }
+
+		/**
+		 * @brief Appends the points that changed since the last call to out, for
+		 *        keeping a GPU copy in sync without resending the whole path
+		 * @return Number of leading points that are unchanged; out replaces everything after them
+		 */
+		int collect(vector<sf::Vertex>& out, const sf::Color& color);
+
+	private:
+		void simplify();
+		void dropOldest(int n);
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
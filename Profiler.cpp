@@ -0,0 +1,170 @@
+#include "Profiler.hpp"
+#include "Util.hpp"
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <stdio.h>
+#include <string.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	atomic<bool> Profiler::Enabled { false };
+
+	static const unsigned RingCapacity = 65536; // events per thread, must be a power of 2
+
+	struct ProfileRing
+	{
+		atomic<unsigned> head { 0 }; // total number of events ever written
+		int  tid;
+		char name[32];
+		ProfileEvent events[RingCapacity];
+
+		// copies out the events that can't have been overwritten while copying
+		void snapshot(vector<ProfileEvent>& out) const
+		{
+			unsigned end   = head.load(memory_order_acquire);
+			unsigned begin = end > RingCapacity ? end - RingCapacity : 0;
+			size_t first   = out.size();
+			for (unsigned i = begin; i < end; ++i)
+				out.push_back(events[i & (RingCapacity - 1)]);
+
+			// producer may have lapped us during the copy; drop the possibly torn entries,
+			// including the slot of event 'after' which it may be writing right now
+			unsigned after = head.load(memory_order_acquire);
+			if (after + 1 - begin > RingCapacity) {
+				size_t torn = min<size_t>(after + 1 - begin - RingCapacity, end - begin);
+				out.erase(out.begin() + first, out.begin() + first + torn);
+			}
+		}
+	};
+
+	static mutex rings_mutex; // only taken when a thread records for the first time
+	static vector<unique_ptr<ProfileRing>> rings;
+	static thread_local ProfileRing* tlsRing = nullptr;
+	static thread_local char tlsName[32];
+
+	static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+	double Profiler::now()
+	{
+		return chrono::duration<double, micro>(chrono::steady_clock::now() - epoch).count();
+	}
+
+	static ProfileRing* thread_ring()
+	{
+		if (!tlsRing)
+		{
+			lock_guard<mutex> lock(rings_mutex);
+			rings.emplace_back(new ProfileRing());
+			tlsRing = rings.back().get();
+			tlsRing->tid = (int)rings.size();
+			if (tlsName[0]) strcpy(tlsRing->name, tlsName);
+			else snprintf(tlsRing->name, sizeof(tlsRing->name), "Thread %d", tlsRing->tid);
+		}
+		return tlsRing;
+	}
+
+	void Profiler::setThreadName(const char* name)
+	{
+		snprintf(tlsName, sizeof(tlsName), "%s", name);
+		if (tlsRing) {
+			lock_guard<mutex> lock(rings_mutex);
+			strcpy(tlsRing->name, tlsName);
+		}
+	}
+
+	void Profiler::record(const char* name, double start, double end)
+	{
+		ProfileRing* ring = thread_ring();
+		unsigned h = ring->head.load(memory_order_relaxed);
+		ProfileEvent& e = ring->events[h & (RingCapacity - 1)];
+		e.name  = name;
+		e.start = start;
+		e.end   = end;
+		ring->head.store(h + 1, memory_order_release);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	bool Profiler::exportChromeTrace(const string& file)
+	{
+		FILE* f = fopen(file.c_str(), "wb");
+		if (!f) {
+			fprintf(stderr, "Profiler::exportChromeTrace(): fopen failed %s\n", file.c_str());
+			return false;
+		}
+
+		lock_guard<mutex> lock(rings_mutex);
+		fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		bool first = true;
+		vector<ProfileEvent> events;
+		for (auto& ring : rings)
+		{
+			fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+				first ? "" : ",\n", ring->tid);
+			writeJsonString(f, ring->name);
+			fprintf(f, "}}");
+			first = false;
+
+			events.clear();
+			ring->snapshot(events);
+			for (const ProfileEvent& e : events) {
+				fprintf(f, ",\n{\"name\":");
+				writeJsonString(f, e.name);
+				fprintf(f, ",\"cat\":\"itc\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					ring->tid, e.start, e.end - e.start);
+			}
+		}
+		fprintf(f, "\n]}\n");
+		fclose(f);
+		printf("Profiler: wrote %s\n", file.c_str());
+		return true;
+	}
+
+	vector<ProfileZoneStats> Profiler::summary(double windowMs)
+	{
+		double from = now() - windowMs * 1000.0;
+		unordered_map<const char*, ProfileZoneStats> zones;
+		vector<ProfileEvent> events;
+		{
+			lock_guard<mutex> lock(rings_mutex);
+			for (auto& ring : rings) ring->snapshot(events);
+		}
+		for (const ProfileEvent& e : events)
+		{
+			if (e.start < from) continue;
+			ProfileZoneStats& z = zones[e.name];
+			double ms = (e.end - e.start) / 1000.0;
+			z.name = e.name;
+			z.calls += 1;
+			z.totalMs += ms;
+			if (ms > z.maxMs) z.maxMs = ms;
+		}
+
+		vector<ProfileZoneStats> result;
+		for (auto& kv : zones) result.push_back(kv.second);
+		sort(result.begin(), result.end(), [](const ProfileZoneStats& a, const ProfileZoneStats& b) {
+			return a.totalMs > b.totalMs;
+		});
+		return result;
+	}
+
+	string Profiler::summaryText(double windowMs, int frames)
+	{
+		if (frames <= 0) frames = 1;
+		string text = "zone                 ms/frame   max ms  calls\n";
+		char line[128];
+		for (const ProfileZoneStats& z : summary(windowMs)) {
+			snprintf(line, sizeof(line), "%-20.20s %8.3f %8.3f %6d\n",
+				z.name, z.totalMs / frames, z.maxMs, z.calls);
+			text += line;
+		}
+		return text;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
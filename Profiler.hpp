@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <string>
+
+// Set ITC_PROFILER=0 to compile all profiling zones out of the build
+#ifndef ITC_PROFILER
+	#define ITC_PROFILER 1
+#endif
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	struct ProfileEvent
+	{
+		const char* name; // must be a string literal or otherwise outlive the profiler
+		double start;     // microseconds since profiler epoch
+		double end;
+	};
+
+	/** @brief Aggregated timings of one zone name */
+	struct ProfileZoneStats
+	{
+		const char* name;
+		int    calls;
+		double totalMs;
+		double maxMs;
+	};
+
+	/**
+	 * Records scoped zones into per-thread ring buffers. Each thread only ever
+	 * writes its own buffer, so recording is lock-free; readers take a consistent
+	 * snapshot by checking the write head before and after copying.
+	 *
+	 * Recording is off by default. When disabled, a zone costs one relaxed atomic load.
+	 */
+	class Profiler
+	{
+	public:
+		static atomic<bool> Enabled;
+
+		/** @return Microseconds since the profiler epoch */
+		static double now();
+
+		/** @brief Names the calling thread in trace exports */
+		static void setThreadName(const char* name);
+
+		/** @brief Appends a finished zone to the calling thread's ring buffer */
+		static void record(const char* name, double start, double end);
+
+		/** @brief Writes all buffered zones as chrome://tracing / Perfetto JSON */
+		static bool exportChromeTrace(const string& file);
+
+		/** @brief Per-zone totals over the last windowMs, sorted by total time */
+		static vector<ProfileZoneStats> summary(double windowMs);
+
+		/** @brief Formats summary() as a multi-line table with per-frame averages */
+		static string summaryText(double windowMs, int frames);
+	};
+
+	/** @brief RAII zone, use through PROFILE_SCOPE */
+	struct ProfileScope
+	{
+		const char* name;
+		double start;
+		explicit ProfileScope(const char* name) : name(name),
+			start(Profiler::Enabled.load(memory_order_relaxed) ? Profiler::now() : -1.0) {}
+		~ProfileScope() {
+			if (start >= 0.0) Profiler::record(name, start, Profiler::now());
+		}
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
+
+#define ITC_PROFILE_CONCAT2(a, b) a##b
+#define ITC_PROFILE_CONCAT(a, b) ITC_PROFILE_CONCAT2(a, b)
+
+#if ITC_PROFILER
+	#define PROFILE_SCOPE(name) itc::ProfileScope ITC_PROFILE_CONCAT(_profileScope, __LINE__) { name }
+#else
+	#define PROFILE_SCOPE(name) /*do nothing*/
+#endif
@@ -0,0 +1,366 @@
+#include "RenderQueue.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <stddef.h> // offsetof
+#include <stdio.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	MeshPool::~MeshPool()
+	{
+		if (vertexBuf)   glDeleteBuffers(1, &vertexBuf);
+		if (indexBuf)    glDeleteBuffers(1, &indexBuf);
+		if (instanceBuf) glDeleteBuffers(1, &instanceBuf);
+		if (layerBuf)    glDeleteBuffers(1, &layerBuf);
+		if (arrayObj)    glDeleteVertexArrays(1, &arrayObj);
+	}
+
+	const PooledMesh& MeshPool::get(const MeshLod& lod)
+	{
+		auto it = meshes.find(&lod);
+		if (it != meshes.end())
+			return it->second;
+
+		// meshlet ranges are offsets into the meshlet ordered indices, so pool those
+		const BMDModel* m = lod.MeshData.get();
+		const index_t* lodIndices = lod.Meshlets ? lod.Meshlets->indices.data() : m->indices();
+		PooledMesh pm;
+		pm.baseVertex = (GLint)vertices.size();
+		pm.firstIndex = (GLuint)indices.size();
+		pm.indexCount = (GLuint)m->num_indices;
+		vertices.insert(vertices.end(), m->vertices(), m->vertices() + m->num_verts);
+		indices.insert(indices.end(), lodIndices, lodIndices + m->num_indices);
+		dirty = true;
+		return meshes.emplace(&lod, pm).first->second;
+	}
+
+	void MeshPool::upload()
+	{
+		if (!dirty) return;
+		dirty = false;
+		if (!arrayObj)
+		{
+			glGenVertexArrays(1, &arrayObj);
+			glGenBuffers(1, &vertexBuf);
+			glGenBuffers(1, &indexBuf);
+			glGenBuffers(1, &instanceBuf);
+			glGenBuffers(1, &layerBuf);
+			glBindVertexArray(arrayObj);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuf);
+			glBindBuffer(GL_ARRAY_BUFFER, vertexBuf);
+			glVertexAttribPointer(a_Position, 3, GL_FLOAT, 0, sizeof(vertex3d), (void*)offsetof(vertex3d, pos));
+			glEnableVertexAttribArray(a_Position);
+			glVertexAttribPointer(a_Coord, 2, GL_FLOAT, 0, sizeof(vertex3d), (void*)offsetof(vertex3d, tex));
+			glEnableVertexAttribArray(a_Coord);
+			glVertexAttribPointer(a_Normal, 3, GL_FLOAT, 0, sizeof(vertex3d), (void*)offsetof(vertex3d, norm));
+			glEnableVertexAttribArray(a_Normal);
+			for (int i = 0; i < 4; ++i) { // a mat4 attribute takes 4 vec4 slots
+				glEnableVertexAttribArray(a_Transform + i);
+				glVertexAttribDivisor(a_Transform + i, 1);
+			}
+			glEnableVertexAttribArray(a_Layer);
+			glVertexAttribDivisor(a_Layer, 1);
+			setInstanceOffset(0);
+			glBindVertexArray(0);
+		}
+		glBindVertexArray(arrayObj); // the element buffer binding is VAO state
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(index_t), indices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuf);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertex3d), vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	void MeshPool::setInstanceOffset(int firstInstance)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuf);
+		for (int i = 0; i < 4; ++i) {
+			size_t offset = firstInstance * sizeof(mat4) + i * sizeof(vec4);
+			glVertexAttribPointer(a_Transform + i, 4, GL_FLOAT, 0, sizeof(mat4), (void*)offset);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, layerBuf);
+		glVertexAttribIPointer(a_Layer, 1, GL_INT, sizeof(GLint), (void*)(firstInstance * sizeof(GLint)));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	TextureArrayPool::~TextureArrayPool()
+	{
+		for (Array& a : arrays)
+			glDeleteTextures(1, &a.tex);
+	}
+
+	void TextureArrayPool::init()
+	{
+		copyImage = GLEW_VERSION_4_3 || GLEW_ARB_copy_image;
+	}
+
+	// copies one level of depth layers from src to dst, starting at dst layer dstLayer
+	static void copy_level(bool copyImage, GLuint src, GLenum srcTarget, GLuint dst, int level, int width, int height,
+	                       int depth, int dstLayer, GLenum format)
+	{
+		if (copyImage) {
+			glCopyImageSubData(src, srcTarget, level, 0, 0, 0, dst, GL_TEXTURE_2D_ARRAY, level, 0, 0, dstLayer, width, height, depth);
+			return;
+		}
+		// GL 3.3 has no GPU side copy between textures, so the level makes a round trip
+		vector<sf::Uint8> data;
+		glBindTexture(srcTarget, src);
+		if (format == GL_RGBA8) {
+			data.resize((size_t)width * height * 4 * depth);
+			glPixelStorei(GL_PACK_ALIGNMENT, 4);
+			glGetTexImage(srcTarget, level, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+		}
+		else {
+			GLint size = 0;
+			glGetTexLevelParameteriv(srcTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+			data.resize(size);
+			glGetCompressedTexImage(srcTarget, level, data.data());
+		}
+		glBindTexture(srcTarget, 0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, dst);
+		if (format == GL_RGBA8)
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, dstLayer, width, height, depth, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+		else
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, dstLayer, width, height, depth, format,
+			                          (GLsizei)data.size(), data.data());
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+
+	TextureArrayPool::Slot TextureArrayPool::get(const Texture2D* texture)
+	{
+		auto it = slots.find(texture);
+		if (it != slots.end())
+			return it->second;
+
+		Slot slot = { -1, 0 };
+		if (!texture->handle() || texture->streaming())
+			return slots[texture] = slot;
+
+		size_t index = 0;
+		for (; index < arrays.size(); ++index) {
+			const Array& a = arrays[index];
+			if (a.width == texture->width() && a.height == texture->height() &&
+				a.levels == texture->levels() && a.format == texture->format())
+				break;
+		}
+		if (index == arrays.size())
+			arrays.push_back({ 0, texture->width(), texture->height(), texture->levels(),
+			                   texture->format(), texture->internalFormat(), 0, 0 });
+		Array& a = arrays[index];
+		if (a.count == a.capacity)
+			allocate(a, max(4, a.capacity * 2));
+
+		for (int level = 0; level < a.levels; ++level)
+			copy_level(copyImage, texture->handle(), GL_TEXTURE_2D, a.tex, level,
+			           max(a.width >> level, 1), max(a.height >> level, 1), 1, a.count, a.glFormat);
+		slot.array = (int)index;
+		slot.layer = a.count++;
+		return slots[texture] = slot;
+	}
+
+	void TextureArrayPool::allocate(Array& a, int capacity)
+	{
+		GLuint tex;
+		glGenTextures(1, &tex);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, tex);
+		for (int level = 0; level < a.levels; ++level)
+		{
+			int w = max(a.width >> level, 1), h = max(a.height >> level, 1);
+			if (a.format == TexRGBA8)
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, w, h, capacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			else
+				glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, a.glFormat, w, h, capacity, 0,
+				                       (GLsizei)(texture_level_size(a.format, w, h) * capacity), nullptr);
+		}
+		// same sampling as Texture2D
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, a.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, a.levels - 1);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		if (a.tex) { // keep the layers filled so far
+			for (int level = 0; level < a.levels; ++level)
+				copy_level(copyImage, a.tex, GL_TEXTURE_2D_ARRAY, tex, level,
+				           max(a.width >> level, 1), max(a.height >> level, 1), a.count, 0, a.glFormat);
+			glDeleteTextures(1, &a.tex);
+		}
+		a.tex      = tex;
+		a.capacity = capacity;
+		printf("TextureArrayPool: %dx%d %s array, %d layers%s\n", a.width, a.height, texture_format_name(a.format),
+			capacity, copyImage ? "" : " (copied through the CPU)");
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	RenderQueue::~RenderQueue()
+	{
+		if (indirectBuf) glDeleteBuffers(1, &indirectBuf);
+	}
+
+	void RenderQueue::init(bool allowIndirect, bool allowArrays)
+	{
+		indirect = allowIndirect && (GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance));
+		if (indirect)
+			glGenBuffers(1, &indirectBuf);
+		arrays = allowArrays; // core since GL 3.0
+		if (arrays)
+			textureArrays.init();
+		printf("RenderQueue: %s, %s\n", indirect ? "glMultiDrawElementsIndirect" : "instanced draws (GL 3.3 fallback)",
+			arrays ? "texture arrays" : "one bind per texture");
+	}
+
+	void RenderQueue::build(const FramePacket& frame, bool useArrays)
+	{
+		sorted.clear();
+		for (const DrawItem& item : frame.draws)
+			if (item.mesh) sorted.push_back({ &item, useArrays ? textureArrays.get(item.texture) : TextureArrayPool::Slot{ -1, 0 } });
+
+		// same array or texture -> same bucket, same mesh -> same command
+		sort(sorted.begin(), sorted.end(), [](const SortedDraw& a, const SortedDraw& b) {
+			if (a.slot.array != b.slot.array) return a.slot.array < b.slot.array;
+			if (a.slot.array < 0 && a.item->texture != b.item->texture) return a.item->texture < b.item->texture;
+			const MeshLod* la = a.item->mesh->Lods[a.item->lod].get();
+			const MeshLod* lb = b.item->mesh->Lods[b.item->lod].get();
+			if (la != lb) return la < lb;
+			return a.item->numRanges < b.item->numRanges; // whole mesh draws first
+		});
+
+		instances.clear();
+		layers.clear();
+		commands.clear();
+		buckets.clear();
+		const MeshLod* lastWhole = nullptr;
+		for (const SortedDraw& draw : sorted)
+		{
+			const DrawItem* item = draw.item;
+			const Texture2D* texture = draw.slot.array < 0 ? item->texture : nullptr;
+			if (buckets.empty() || buckets.back().array != draw.slot.array || buckets.back().texture != texture) {
+				buckets.push_back({ texture, draw.slot.array, (int)commands.size(), 0 });
+				lastWhole = nullptr;
+			}
+			Bucket& bucket = buckets.back();
+			const MeshLod& lod = *item->mesh->Lods[item->lod];
+			const PooledMesh& pm = pool.get(lod);
+			GLuint instance = (GLuint)instances.size();
+			instances.push_back(item->transform);
+			layers.push_back(draw.slot.layer);
+
+			if (item->numRanges < 0)
+			{
+				if (lastWhole == &lod) { // another instance of the previous command
+					++commands.back().instanceCount;
+					continue;
+				}
+				commands.push_back({ pm.indexCount, 1, pm.firstIndex, pm.baseVertex, instance });
+				++bucket.numCommands;
+				lastWhole = &lod;
+				continue;
+			}
+
+			lastWhole = nullptr;
+			const MeshletDrawList& list = frame.meshletLists[item->drawList];
+			for (int r = item->firstRange; r < item->firstRange + item->numRanges; ++r) {
+				GLuint first = pm.firstIndex + (GLuint)((size_t)list.offsets[r] / sizeof(index_t));
+				commands.push_back({ (GLuint)list.counts[r], 1, first, pm.baseVertex, instance });
+				++bucket.numCommands;
+			}
+		}
+	}
+
+	void RenderQueue::submit(const FramePacket& frame, Shader& shader, Shader* arrayShader)
+	{
+		PROFILE_SCOPE("RenderQueue::submit");
+		build(frame, arrays && arrayShader);
+		if (commands.empty())
+			return;
+
+		pool.upload();
+		glBindBuffer(GL_ARRAY_BUFFER, pool.instanceBuf);
+		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(mat4), instances.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, pool.layerBuf);
+		glBufferData(GL_ARRAY_BUFFER, layers.size() * sizeof(GLint), layers.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		for (const DrawElementsIndirectCommand& cmd : commands)
+			DrawStats.triangles += cmd.count / 3 * cmd.instanceCount;
+
+		glBindVertexArray(pool.arrayObj);
+		if (indirect) drawIndirect(shader, arrayShader);
+		else          drawInstanced(shader, arrayShader);
+		glBindVertexArray(0);
+	}
+
+	void RenderQueue::bindBucket(const Bucket& b, Shader& shader, Shader* arrayShader, Shader*& current)
+	{
+		Shader* wanted = b.array >= 0 ? arrayShader : &shader;
+		if (wanted != current) {
+			wanted->bind();
+			current = wanted;
+		}
+		if (b.array >= 0) wanted->bind(u_DiffuseTex, textureArrays.handle(b.array), GL_TEXTURE_2D_ARRAY);
+		else              wanted->bind(u_DiffuseTex, b.texture->handle());
+	}
+
+	void RenderQueue::drawIndirect(Shader& shader, Shader* arrayShader)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuf);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand),
+		             commands.data(), GL_STREAM_DRAW);
+		pool.setInstanceOffset(0); // baseInstance picks the transform and layer
+		Shader* current = &shader;
+		for (const Bucket& b : buckets)
+		{
+			bindBucket(b, shader, arrayShader, current);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+				(const void*)(b.firstCommand * sizeof(DrawElementsIndirectCommand)), b.numCommands, 0);
+			++DrawStats.drawCalls;
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	void RenderQueue::drawInstanced(Shader& shader, Shader* arrayShader)
+	{
+		// no baseInstance before GL 4.2, so the transform attribute is re-pointed per draw
+		vector<GLsizei> counts;
+		vector<const GLvoid*> offsets;
+		vector<GLint> baseVertices;
+		Shader* current = &shader;
+		for (const Bucket& b : buckets)
+		{
+			bindBucket(b, shader, arrayShader, current);
+			const DrawElementsIndirectCommand* cmd = &commands[b.firstCommand];
+			const DrawElementsIndirectCommand* end = cmd + b.numCommands;
+			while (cmd < end)
+			{
+				pool.setInstanceOffset(cmd->baseInstance);
+				if (cmd->instanceCount > 1 || cmd + 1 == end || cmd[1].baseInstance != cmd->baseInstance)
+				{
+					glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cmd->count, GL_UNSIGNED_INT,
+						(const void*)(cmd->firstIndex * sizeof(index_t)), cmd->instanceCount, cmd->baseVertex);
+					++cmd;
+				}
+				else // meshlet ranges of one instance
+				{
+					counts.clear(), offsets.clear(), baseVertices.clear();
+					GLuint instance = cmd->baseInstance;
+					for (; cmd < end && cmd->baseInstance == instance; ++cmd) {
+						counts.push_back(cmd->count);
+						offsets.push_back((const GLvoid*)(cmd->firstIndex * sizeof(index_t)));
+						baseVertices.push_back(cmd->baseVertex);
+					}
+					glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT,
+						offsets.data(), (GLsizei)counts.size(), baseVertices.data());
+				}
+				++DrawStats.drawCalls;
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,181 @@
+#pragma once
+#include "RenderThread.hpp"
+#include <unordered_map>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/** @brief Layout of one glMultiDrawElementsIndirect record, defined by the GL spec */
+	struct DrawElementsIndirectCommand
+	{
+		GLuint count;         // index count
+		GLuint instanceCount;
+		GLuint firstIndex;    // into the pooled index buffer
+		GLint  baseVertex;    // added to every index
+		GLuint baseInstance;  // first per-instance transform
+	};
+
+	/** @brief Where a mesh LOD lives inside the shared MeshPool buffers */
+	struct PooledMesh
+	{
+		GLint  baseVertex;
+		GLuint firstIndex;
+		GLuint indexCount;
+	};
+
+	/**
+	 * All static mesh LODs packed into one vertex and one index buffer, so any
+	 * mix of meshes can be drawn with a single VAO bind. Meshes are added the first
+	 * time they are drawn; the GL buffers are re-uploaded when the pool grows.
+	 */
+	class MeshPool
+	{
+	public:
+		GLuint arrayObj    = 0; // vertex array object with pooled and per-instance attributes
+		GLuint vertexBuf   = 0;
+		GLuint indexBuf    = 0;
+		GLuint instanceBuf = 0; // one mat4 per instance, read with attribute divisor 1
+		GLuint layerBuf    = 0; // one texture array layer per instance
+
+	private:
+		vector<vertex3d> vertices;
+		vector<index_t>  indices;
+		unordered_map<const MeshLod*, PooledMesh> meshes;
+		bool dirty = false;
+
+	public:
+		MeshPool() {}
+		~MeshPool();
+		MeshPool(const MeshPool&) = delete;
+		MeshPool& operator=(const MeshPool&) = delete;
+
+		/** @return The mesh's location in the pool, adding it if needed */
+		const PooledMesh& get(const MeshLod& lod);
+
+		/** @brief Uploads pending meshes, call before drawing */
+		void upload();
+
+		/** @brief Points the per-instance transform and layer attributes at instance firstInstance */
+		void setInstanceOffset(int firstInstance);
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Copies same sized textures into the layers of GL_TEXTURE_2D_ARRAYs, so draws
+	 * with different textures can share one bind and the shader picks the layer per
+	 * instance. Textures join the first time they are drawn; an array that runs out
+	 * of layers is reallocated at twice the size. Streamed textures keep their own
+	 * bind, since their levels still change after the copy.
+	 */
+	class TextureArrayPool
+	{
+	public:
+		struct Slot
+		{
+			int array; // -1 if the texture can't be in an array
+			int layer;
+		};
+
+	private:
+		struct Array
+		{
+			GLuint tex;
+			int    width, height, levels;
+			TextureFormat format;
+			GLenum glFormat;
+			int    count, capacity; // layers
+		};
+		vector<Array> arrays;
+		unordered_map<const Texture2D*, Slot> slots;
+		bool copyImage = false; // glCopyImageSubData, otherwise levels go through a CPU readback
+
+	public:
+		TextureArrayPool() {}
+		~TextureArrayPool();
+		TextureArrayPool(const TextureArrayPool&) = delete;
+		TextureArrayPool& operator=(const TextureArrayPool&) = delete;
+
+		void init();
+
+		/** @return Where texture lives, copying it into an array if it isn't in one yet */
+		Slot get(const Texture2D* texture);
+
+		GLuint handle(int array) const { return arrays[array].tex; }
+
+	private:
+		/** @brief Creates the array, or moves its first count layers into a bigger one */
+		void allocate(Array& a, int capacity);
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Submits all 3D draws of a frame with as few GL calls as possible:
+	 *  - draws are bucketed by texture, and draws of the same mesh share one command
+	 *  - with GL 4.3 (or ARB_multi_draw_indirect + ARB_base_instance) every bucket is
+	 *    one glMultiDrawElementsIndirect and transforms are fetched through baseInstance
+	 *  - on GL 3.3 every mesh in a bucket is one glDrawElementsInstancedBaseVertex
+	 *  - with texture arrays, textures of the same size and format share a bucket
+	 *    and every instance carries its layer
+	 * Meshlet culled draws become one command per surviving range.
+	 */
+	class RenderQueue
+	{
+		MeshPool pool;
+		TextureArrayPool textureArrays;
+		GLuint indirectBuf = 0;
+		bool   indirect = false;
+		bool   arrays   = false;
+
+		struct Bucket
+		{
+			const Texture2D* texture; // null for an array bucket
+			int array;                // TextureArrayPool array, -1 for a plain texture
+			int firstCommand;
+			int numCommands;
+		};
+		struct SortedDraw
+		{
+			const DrawItem* item;
+			TextureArrayPool::Slot slot;
+		};
+		vector<SortedDraw> sorted;
+		vector<mat4>   instances;
+		vector<GLint>  layers; // per instance
+		vector<DrawElementsIndirectCommand> commands;
+		vector<Bucket> buckets;
+
+	public:
+		RenderQueue() {}
+		~RenderQueue();
+
+		/**
+		 * @brief Creates GL buffers and picks the indirect or instanced path, allowIndirect=false forces the GL 3.3 path
+		 * @param allowArrays Merge same sized textures into texture arrays, see TextureArrayPool
+		 */
+		void init(bool allowIndirect = true, bool allowArrays = true);
+
+		bool indirectEnabled() const { return indirect; }
+		bool arraysEnabled() const { return arrays; }
+
+		/**
+		 * @brief Draws all visible DrawItems of the frame with a shader that reads the instTransform attribute
+		 * @param arrayShader Same, but samples diffuseTex as a sampler2DArray at the instLayer attribute;
+		 *                    without it no texture arrays are used
+		 */
+		void submit(const FramePacket& frame, Shader& shader, Shader* arrayShader = nullptr);
+
+	private:
+		void build(const FramePacket& frame, bool useArrays);
+		/** @brief Binds the shader and texture of a bucket, switching programs only when needed */
+		void bindBucket(const Bucket& b, Shader& shader, Shader* arrayShader, Shader*& current);
+		void drawIndirect(Shader& shader, Shader* arrayShader);
+		void drawInstanced(Shader& shader, Shader* arrayShader);
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,125 @@
+#include "RenderThread.hpp"
+#include "Profiler.hpp"
+#include <stdio.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	RenderThread::RenderThread(sf::RenderWindow& window, RenderFunc render, bool threaded)
+		: window(window), render(render), threaded(threaded),
+		  writeSlot(0), pending(-1), rendering(-1), running(false), nextFrameId(0)
+	{
+	}
+
+	RenderThread::~RenderThread()
+	{
+		stop();
+	}
+
+	void RenderThread::start()
+	{
+		latency = FrameLatencyStats();
+		latency.startTime = time_ms();
+		if (!threaded || running)
+			return;
+		running = true;
+		window.setActive(false); // GL context can only be current on one thread
+		worker = thread(&RenderThread::renderLoop, this);
+	}
+
+	void RenderThread::stop()
+	{
+		if (threaded && running)
+		{
+			{
+				unique_lock<mutex> lock(m);
+				cv.wait(lock, [this] { return pending == -1; }); // let the last frame through
+				running = false;
+			}
+			cv.notify_all();
+			worker.join();
+			window.setActive(true);
+		}
+		latency.endTime = time_ms();
+	}
+
+	FramePacket& RenderThread::beginFrame()
+	{
+		FramePacket* packet = &packets[writeSlot];
+		if (threaded)
+		{
+			unique_lock<mutex> lock(m);
+			cv.wait(lock, [this] { return pending != writeSlot && rendering != writeSlot; });
+		}
+		packet->clear();
+		packet->showProfiler = false;
+		packet->frameId   = nextFrameId++;
+		packet->buildTime = time_ms();
+		return *packet;
+	}
+
+	void RenderThread::submitFrame()
+	{
+		if (!threaded) {
+			present(packets[writeSlot]);
+			return;
+		}
+		{
+			unique_lock<mutex> lock(m);
+			cv.wait(lock, [this] { return pending == -1; });
+			pending = writeSlot;
+		}
+		cv.notify_all();
+		writeSlot ^= 1;
+	}
+
+	void RenderThread::renderLoop()
+	{
+		Profiler::setThreadName("Render");
+		window.setActive(true);
+		for (;;)
+		{
+			{
+				unique_lock<mutex> lock(m);
+				cv.wait(lock, [this] { return pending != -1 || !running; });
+				if (pending == -1) break; // stopped and drained
+				rendering = pending;
+				pending   = -1;
+			}
+			cv.notify_all(); // simulation may submit the next frame now
+
+			present(packets[rendering]);
+
+			{
+				lock_guard<mutex> lock(m);
+				rendering = -1;
+			}
+			cv.notify_all();
+		}
+		window.setActive(false);
+	}
+
+	void RenderThread::present(const FramePacket& packet)
+	{
+		render(packet);
+		{
+			PROFILE_SCOPE("display");
+			window.display();
+		}
+
+		double lat = time_ms() - packet.buildTime;
+		latency.totalLatency += lat;
+		if (lat > latency.maxLatency) latency.maxLatency = lat;
+		++latency.frames;
+	}
+
+	void RenderThread::printStats() const
+	{
+		printf("RenderThread (%s): %llu frames, %.1f fps, latency avg %.2fms max %.2fms\n",
+			threaded ? "threaded" : "inline", latency.frames, latency.fps(),
+			latency.avgLatency(), latency.maxLatency);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
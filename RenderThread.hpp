@@ -0,0 +1,139 @@
+#pragma once
+#include "StaticMesh.hpp"
+#include "Texture2D.hpp"
+#include "FrameTiming.hpp"
+#include <SFML/Graphics.hpp>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/** @brief A single 3D mesh draw, fully resolved by the simulation thread */
+	struct DrawItem
+	{
+		const StaticMesh*  mesh;
+		int                lod;     // index into mesh->Lods
+		const Texture2D*   texture;
+		int drawList;   // FramePacket::meshletLists index of the culled meshlet ranges
+		int firstRange; // first range in that list
+		int numRanges;  // -1 draws the whole mesh
+		mat4 transform; // model-view-projection
+	};
+
+	class ShadowText;
+	class SdfText;
+
+	/** @brief A single 2D GUI primitive */
+	struct GuiItem
+	{
+		enum Type { Sprite, ShadowText, SdfText, LineStrip, Trail } type;
+		const sf::Sprite*      sprite;  // Sprite
+		const itc::ShadowText* text;    // ShadowText, owned by the render side
+		const itc::SdfText*    sdfText; // SdfText, owned by the render side; transform includes the size
+		sf::Transform          transform;
+		int first, count;             // LineStrip range in FramePacket::guiVerts, or the vertices Trail appends
+		int keep;                     // Trail vertices kept from the previous frame, the rest is replaced
+	};
+
+	/**
+	 * Everything the render thread needs to draw one frame. Once submitted,
+	 * the simulation thread doesn't touch it until the render thread is done.
+	 */
+	struct FramePacket
+	{
+		unsigned long long frameId;
+		double  buildTime;     // when the simulation started building this frame (ms)
+		sf::Color clearColor;
+		bool    showProfiler;  // draw the profiler summary overlay
+		mat4 viewProj;
+		vector<DrawItem>   draws;
+		vector<MeshletDrawList> meshletLists; // one per JobSystem worker
+		vector<GuiItem>    gui;
+		vector<sf::Vertex> guiVerts;
+		vector<sf::Uint8>  occlusionPixels; // OcclusionBuffer overlay as RGBA, empty if hidden
+
+		void clear() {
+			draws.clear(); gui.clear(); guiVerts.clear(); occlusionPixels.clear();
+			for (MeshletDrawList& list : meshletLists) list.clear();
+		}
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/** @brief Latency and throughput of the simulation -> present pipeline */
+	struct FrameLatencyStats
+	{
+		unsigned long long frames = 0;
+		double totalLatency = 0.0; // sum of buildTime -> display() latencies (ms)
+		double maxLatency   = 0.0;
+		double startTime    = 0.0;
+		double endTime      = 0.0;
+
+		double avgLatency() const { return frames ? totalLatency / frames : 0.0; }
+		double fps()        const { return endTime > startTime ? frames * 1000.0 / (endTime - startTime) : 0.0; }
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Double buffered frame submission. The simulation thread fills one FramePacket
+	 * while the render thread, which owns the window's GL context, draws the other one.
+	 * Simulation runs at most one frame ahead of the GPU submission.
+	 *
+	 * With threaded = false, submitFrame() renders inline on the calling thread,
+	 * which is handy for measuring what the extra frame of latency buys us.
+	 */
+	class RenderThread
+	{
+	public:
+		typedef function<void(const FramePacket&)> RenderFunc;
+
+	private:
+		sf::RenderWindow& window;
+		RenderFunc render;
+		bool threaded;
+
+		FramePacket packets[2];
+		int writeSlot;  // slot the simulation fills next
+		int pending;    // slot ready for rendering, -1 if none
+		int rendering;  // slot currently being rendered, -1 if none
+		bool running;
+		unsigned long long nextFrameId;
+
+		mutex m;
+		condition_variable cv;
+		thread worker;
+		FrameLatencyStats latency;
+
+	public:
+		RenderThread(sf::RenderWindow& window, RenderFunc render, bool threaded = true);
+		~RenderThread();
+
+		/** @brief Releases the GL context from this thread and starts rendering */
+		void start();
+		/** @brief Finishes the pending frame and gives the GL context back to the calling thread */
+		void stop();
+
+		/** @brief Waits until a packet is free and returns it, cleared */
+		FramePacket& beginFrame();
+		/** @brief Publishes the packet from beginFrame() to the render thread */
+		void submitFrame();
+
+		bool isThreaded() const { return threaded; }
+		const FrameLatencyStats& stats() const { return latency; }
+		void printStats() const;
+
+	private:
+		void renderLoop();
+		void present(const FramePacket& packet);
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
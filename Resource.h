@@ -1,6 +1,7 @@
 #pragma once
 #include <unordered_map>
 #include <memory>
+#include <string>
 
 namespace itc
 {
@@ -18,14 +19,14 @@ namespace itc
 			T   obj;
 			int refs;
 			ResType() : refs(1) {}
-			template<class T, class...U> ResType(U&&...args) : refs(1), obj(forward<U>(args)...) {}
+			template<class...U> ResType(U&&...args) : obj(forward<U>(args)...), refs(1) {}
 		};
 		ResType* ref;
 		Resource()           : ref(nullptr) {}
 		Resource(ResType* r) : ref(r) {}
 		~Resource() { decref(); }
 		Resource(Resource&& fwd)      : ref(fwd.ref) { fwd.ref = nullptr; }
-		Resource(const Resource& rhs) : ref(fwd.ref) { addref(); }
+		Resource(const Resource& rhs) : ref(rhs.ref) { addref(); }
 		Resource& operator=(Resource&& fwd)      { swap(ref, fwd.ref); return *this; }
 		Resource& operator=(const Resource& rhs) { set(rhs.ref);       return *this; }
 		void set(ResType* r) { decref(); ref=r; addref(); }
@@ -65,28 +66,31 @@ namespace itc
 		/** @brief Frees all unused resources */
 		void freeUnused()
 		{
-			for (auto it = Resources.begin(); it != Resources.end(); ++it)
+			for (auto it = Resources.begin(); it != Resources.end(); )
 			{
 				if (!it->second)
 				{
 					it = Resources.erase(it);
 				}
-				else if (it->second.refcount() == 0) 
+				else if (it->second.numrefs() == 0) 
 				{
 					delete it->second.ref;
+					it->second.ref = nullptr;
 					it = Resources.erase(it);
 				}
+				else ++it;
 			}
 		}
 
 		/** @brief Destroys all resources, regardless of refcounts */
 		void destroyAll()
 		{
-			for (auto it = Resources.begin(); it != Resources.end(); ++it)
+			for (auto& it : Resources)
 			{
-				delete it->second.ref;
-				it = Resources.erase(it);
+				delete it.second.ref;
+				it.second.ref = nullptr; // so ~Resource doesn't touch freed memory
 			}
+			Resources.clear();
 		}
 		
 	};
@@ -0,0 +1,413 @@
+#include "SdfFont.hpp"
+#include "JobSystem.hpp"
+#include "SkylinePacker.hpp"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	// offset from a pixel to the nearest seed pixel
+	struct SeedOffset
+	{
+		short dx, dy;
+		int dist2() const { return dx * dx + dy * dy; }
+	};
+
+	static const SeedOffset NoSeed = { 16384, 16384 };
+
+	static const int SdfMaxSize = 16384; // largest atlas width or height build() makes
+
+	/**
+	 * 8-point sequential Euclidean distance transform: two raster sweeps that
+	 * propagate each pixel's nearest seed to its neighbours. Not exact, but the
+	 * error is a fraction of a pixel, which the downsampling hides anyway.
+	 */
+	static void distance_transform(SeedOffset* grid, int width, int height)
+	{
+		auto compare = [=](SeedOffset& p, int x, int y, int ox, int oy) {
+			x += ox, y += oy;
+			if (x < 0 || y < 0 || x >= width || y >= height)
+				return;
+			SeedOffset o = grid[y * width + x];
+			o.dx += (short)ox, o.dy += (short)oy;
+			if (o.dist2() < p.dist2()) p = o;
+		};
+		for (int y = 0; y < height; ++y)
+		{
+			SeedOffset* row = grid + y * width;
+			for (int x = 0; x < width; ++x) {
+				compare(row[x], x, y, -1,  0);
+				compare(row[x], x, y,  0, -1);
+				compare(row[x], x, y, -1, -1);
+				compare(row[x], x, y,  1, -1);
+			}
+			for (int x = width - 1; x >= 0; --x)
+				compare(row[x], x, y, 1, 0);
+		}
+		for (int y = height - 1; y >= 0; --y)
+		{
+			SeedOffset* row = grid + y * width;
+			for (int x = width - 1; x >= 0; --x) {
+				compare(row[x], x, y,  1, 0);
+				compare(row[x], x, y,  0, 1);
+				compare(row[x], x, y, -1, 1);
+				compare(row[x], x, y,  1, 1);
+			}
+			for (int x = 0; x < width; ++x)
+				compare(row[x], x, y, -1, 0);
+		}
+	}
+
+	/**
+	 * Distance field of a rasterized glyph. The coverage bitmap is placed inside a
+	 * Spread texel border, distances are measured at full resolution and sampled
+	 * once per field texel, then mapped so 0.5 is the outline and 0 / 1 are
+	 * Spread texels outside / inside of it.
+	 */
+	static void glyph_field(const sf::Uint8* rgba, int stride, const sf::IntRect& rect,
+	                        sf::Uint8* out, int outStride, int fieldWidth, int fieldHeight)
+	{
+		const int pad = SdfFont::Spread * SdfFont::Downsample;
+		const int width = fieldWidth * SdfFont::Downsample, height = fieldHeight * SdfFont::Downsample;
+		vector<SeedOffset> toInk(width * height), toEmpty(width * height);
+		vector<bool> ink(width * height);
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				int gx = x - pad, gy = y - pad, i = y * width + x;
+				bool inside = gx >= 0 && gy >= 0 && gx < rect.width && gy < rect.height
+				           && rgba[((rect.top + gy) * stride + rect.left + gx) * 4 + 3] >= 128;
+				ink[i]     = inside;
+				toInk[i]   = inside ? SeedOffset{ 0, 0 } : NoSeed;
+				toEmpty[i] = inside ? NoSeed : SeedOffset{ 0, 0 };
+			}
+		}
+		distance_transform(toInk.data(),   width, height);
+		distance_transform(toEmpty.data(), width, height);
+
+		const int center = SdfFont::Downsample / 2;
+		for (int fy = 0; fy < fieldHeight; ++fy)
+		{
+			for (int fx = 0; fx < fieldWidth; ++fx)
+			{
+				int i = (fy * SdfFont::Downsample + center) * width + fx * SdfFont::Downsample + center;
+				// pixel centers are half a pixel from the outline they border
+				float dist = ink[i] ? 0.5f - sqrtf((float)toEmpty[i].dist2())
+				                    : sqrtf((float)toInk[i].dist2()) - 0.5f;
+				float value = 0.5f - dist / (2.0f * pad);
+				out[fy * outStride + fx] = (sf::Uint8)(max(0.0f, min(1.0f, value)) * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	static unsigned long long fnv1a(const char* data, size_t size)
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; ++i)
+			hash = (hash ^ (unsigned char)data[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	string SdfFont::cacheFile(const string& ttfFile)
+	{
+		return ttfFile.substr(0, ttfFile.rfind('.')) + ".sdf";
+	}
+
+	bool SdfFont::loadFromFile(const string& ttfFile, JobSystem* jobs, sf::Uint32 firstChar, sf::Uint32 lastChar)
+	{
+		FILE* f = fopen(ttfFile.c_str(), "rb");
+		if (!f) {
+			fprintf(stderr, "SdfFont::loadFromFile(): fopen failed %s\n", ttfFile.c_str());
+			return false;
+		}
+		fseek(f, 0, SEEK_END);
+		fontData.resize(ftell(f));
+		fseek(f, 0, SEEK_SET);
+		bool ok = fontData.empty() || fread(fontData.data(), fontData.size(), 1, f) == 1;
+		fclose(f);
+		if (!ok || !font.loadFromMemory(fontData.data(), fontData.size())) {
+			fprintf(stderr, "SdfFont::loadFromFile(): invalid font %s\n", ttfFile.c_str());
+			return false;
+		}
+
+		first = firstChar;
+		glyphs.assign(lastChar - firstChar + 1, Glyph());
+		spacing = font.getLineSpacing(RenderSize) / (float)RenderSize;
+
+		unsigned long long hash = fnv1a(fontData.data(), fontData.size());
+		string cache = cacheFile(ttfFile);
+		vector<sf::Uint8> field;
+		int width, height;
+		if (!loadCache(cache, hash, field, width, height))
+		{
+			if (!build(jobs, field, width, height))
+				return false;
+			saveCache(cache, hash, field, width, height);
+			printf("SdfFont: built %s, %d glyphs in %dx%d\n", cache.c_str(), (int)glyphs.size(), width, height);
+		}
+
+		vector<sf::Uint8> rgba(width * height * 4, 255);
+		for (int i = 0; i < width * height; ++i)
+			rgba[i * 4 + 3] = field[i];
+		sf::Image image;
+		image.create(width, height, rgba.data());
+		if (!atlas.loadFromImage(image)) {
+			fprintf(stderr, "SdfFont::loadFromFile(): failed to create %dx%d texture\n", width, height);
+			return false;
+		}
+		atlas.setSmooth(true); // the shader relies on bilinear filtering between field texels
+		return true;
+	}
+
+	bool SdfFont::build(JobSystem* jobs, vector<sf::Uint8>& field, int& width, int& height)
+	{
+		// FreeType isn't thread safe: rasterize every glyph into one SFML page here, read it back once
+		struct Source { int glyph; sf::IntRect rect; int fieldWidth, fieldHeight; };
+		vector<Source> sources;
+		const float em = 1.0f / RenderSize;
+		const int pad = Spread * Downsample;
+		for (size_t g = 0; g < glyphs.size(); ++g)
+		{
+			const sf::Glyph& glyph = font.getGlyph(first + (sf::Uint32)g, RenderSize, false);
+			const sf::IntRect& r = glyph.textureRect;
+			glyphs[g].advance = glyph.advance * em;
+			glyphs[g].texRect = sf::IntRect();
+			if (r.width <= 0 || r.height <= 0)
+				continue;
+			int fw = (r.width  + Downsample - 1) / Downsample + 2 * Spread;
+			int fh = (r.height + Downsample - 1) / Downsample + 2 * Spread;
+			glyphs[g].bounds = sf::FloatRect((glyph.bounds.left - pad) * em, (glyph.bounds.top - pad) * em,
+			                                 fw * Downsample * em, fh * Downsample * em);
+			sources.push_back({ (int)g, r, fw, fh });
+		}
+		sf::Image page = font.getTexture(RenderSize).copyToImage();
+
+		// skyline packing, tallest glyphs first
+		sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) {
+			return a.fieldHeight > b.fieldHeight;
+		});
+		const int padding = 1;
+		width = 512;
+		for (const Source& s : sources)
+			while (width < s.fieldWidth + padding && width < SdfMaxSize) width *= 2;
+		SkylinePacker packer { width, SdfMaxSize };
+		for (const Source& s : sources)
+		{
+			sf::IntRect r;
+			if (!packer.insert(s.fieldWidth + padding, s.fieldHeight + padding, r)) {
+				fprintf(stderr, "SdfFont::build(): %d glyph fields don't fit in a %dx%d atlas\n",
+					(int)sources.size(), width, SdfMaxSize);
+				return false;
+			}
+			glyphs[s.glyph].texRect = sf::IntRect(r.left, r.top, s.fieldWidth, s.fieldHeight);
+		}
+		height = 64;
+		while (height < packer.usedHeight()) height *= 2;
+
+		// each glyph writes its own rectangle of the atlas, so they can all be built at once
+		field.assign(width * height, 0);
+		const sf::Uint8* pixels = page.getPixelsPtr();
+		int stride = (int)page.getSize().x;
+		auto buildGlyphs = [&](int begin, int end) {
+			for (int i = begin; i < end; ++i) {
+				const Source& s = sources[i];
+				const sf::IntRect& dst = glyphs[s.glyph].texRect;
+				glyph_field(pixels, stride, s.rect, &field[dst.top * width + dst.left], width, dst.width, dst.height);
+			}
+		};
+		if (jobs) jobs->parallel_for((int)sources.size(), 1, buildGlyphs);
+		else      buildGlyphs(0, (int)sources.size());
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	static const char SdfMagic[4] = { 'S','D','F','1' };
+
+	struct SdfCacheHeader
+	{
+		char magic[4];
+		int  renderSize, downsample, spread;
+		unsigned long long fontHash;
+		sf::Uint32 first, count;
+		int  width, height;
+	};
+
+	bool SdfFont::loadCache(const string& file, unsigned long long fontHash, vector<sf::Uint8>& field, int& width, int& height)
+	{
+		FILE* f = fopen(file.c_str(), "rb");
+		if (!f)
+			return false;
+		fseek(f, 0, SEEK_END);
+		long size = ftell(f);
+		fseek(f, 0, SEEK_SET);
+
+		SdfCacheHeader h;
+		bool ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, SdfMagic, 4) == 0
+		       && h.renderSize == RenderSize && h.downsample == Downsample && h.spread == Spread
+		       && h.fontHash == fontHash && h.first == first && h.count == glyphs.size()
+		       && h.width > 0 && h.width <= SdfMaxSize && h.height > 0 && h.height <= SdfMaxSize
+		       && (long long)size == (long long)(sizeof(h) + glyphs.size() * sizeof(Glyph)) + (long long)h.width * h.height;
+		if (ok) {
+			field.resize(h.width * h.height);
+			ok = fread(glyphs.data(), sizeof(Glyph), glyphs.size(), f) == glyphs.size()
+			  && fread(field.data(), field.size(), 1, f) == 1;
+		}
+		fclose(f);
+
+		for (size_t i = 0; ok && i < glyphs.size(); ++i) {
+			const sf::IntRect& r = glyphs[i].texRect;
+			ok = r.left >= 0 && r.top >= 0 && r.width >= 0 && r.height >= 0
+			  && r.left <= h.width - r.width && r.top <= h.height - r.height;
+		}
+
+		if (!ok) { // stale caches are expected after a font or setting change
+			printf("SdfFont: %s is out of date, rebuilding\n", file.c_str());
+			glyphs.assign(glyphs.size(), Glyph());
+			return false;
+		}
+		width  = h.width;
+		height = h.height;
+		return true;
+	}
+
+	bool SdfFont::saveCache(const string& file, unsigned long long fontHash, const vector<sf::Uint8>& field, int width, int height) const
+	{
+		FILE* f = fopen(file.c_str(), "wb");
+		if (!f) {
+			fprintf(stderr, "SdfFont::saveCache(): fopen failed %s\n", file.c_str());
+			return false;
+		}
+		SdfCacheHeader h;
+		memcpy(h.magic, SdfMagic, 4);
+		h.renderSize = RenderSize, h.downsample = Downsample, h.spread = Spread;
+		h.fontHash = fontHash;
+		h.first    = first;
+		h.count    = (sf::Uint32)glyphs.size();
+		h.width    = width, h.height = height;
+		bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+		       && fwrite(glyphs.data(), sizeof(Glyph), glyphs.size(), f) == glyphs.size()
+		       && fwrite(field.data(), field.size(), 1, f) == 1;
+		fclose(f);
+		if (!ok) fprintf(stderr, "SdfFont::saveCache(): fwrite failed %s\n", file.c_str());
+		return ok;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	float SdfFont::kerning(sf::Uint32 prev, sf::Uint32 codePoint) const
+	{
+		return font.getKerning(prev, codePoint, RenderSize) / (float)RenderSize;
+	}
+
+	const SdfFont::Glyph* SdfFont::glyph(sf::Uint32 codePoint) const
+	{
+		if (codePoint < first || codePoint - first >= glyphs.size())
+			return nullptr;
+		return &glyphs[codePoint - first];
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	void layout_sdf_text(vector<sf::Vertex>& out, const sf::String& str, const SdfFont& font, const sf::Color& color)
+	{
+		// same rules as layout_text(), with a character size of 1
+		const SdfFont::Glyph* space = font.glyph(' ');
+		float spaceAdvance = space ? space->advance : 0.25f;
+		float x = 0.0f, y = 1.0f;
+		sf::Uint32 prev = 0;
+		for (size_t i = 0; i < str.getSize(); ++i)
+		{
+			sf::Uint32 c = str[i];
+			x += font.kerning(prev, c);
+			prev = c;
+			if (c == ' ')  { x += spaceAdvance; continue; }
+			if (c == '\t') { x += spaceAdvance * 4; continue; }
+			if (c == '\n') { x = 0.0f; y += font.lineSpacing(); continue; }
+
+			const SdfFont::Glyph* g = font.glyph(c);
+			if (!g) continue;
+			if (g->texRect.width > 0)
+			{
+				float l = x + g->bounds.left, t = y + g->bounds.top;
+				float r = l + g->bounds.width, b = t + g->bounds.height;
+				float u0 = (float)g->texRect.left, v0 = (float)g->texRect.top;
+				float u1 = u0 + g->texRect.width,  v1 = v0 + g->texRect.height;
+				sf::Vertex tl(sf::Vector2f(l, t), color, sf::Vector2f(u0, v0));
+				sf::Vertex tr(sf::Vector2f(r, t), color, sf::Vector2f(u1, v0));
+				sf::Vertex bl(sf::Vector2f(l, b), color, sf::Vector2f(u0, v1));
+				sf::Vertex br(sf::Vector2f(r, b), color, sf::Vector2f(u1, v1));
+				out.push_back(tl); out.push_back(tr); out.push_back(bl);
+				out.push_back(bl); out.push_back(tr); out.push_back(br);
+			}
+			x += g->advance;
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	SdfText::SdfText(const sf::String& str, const SdfFont& font, const sf::Color& color)
+		: str(str), font(&font), color(color)
+	{
+	}
+
+	void SdfText::setString(const sf::String& s)
+	{
+		if (str == s) return;
+		str   = s;
+		dirty = true;
+	}
+
+	void SdfText::setFont(const SdfFont& f)
+	{
+		if (font == &f) return;
+		font  = &f;
+		dirty = true;
+	}
+
+	void SdfText::setColor(const sf::Color& c)
+	{
+		color = c;
+		for (sf::Vertex& v : mesh) v.color = color;
+	}
+
+	sf::FloatRect SdfText::getLocalBounds() const
+	{
+		ensureGeometry();
+		return bounds;
+	}
+
+	const vector<sf::Vertex>& SdfText::geometry() const
+	{
+		ensureGeometry();
+		return mesh;
+	}
+
+	void SdfText::ensureGeometry() const
+	{
+		if (!dirty || !font)
+			return;
+		dirty = false;
+		mesh.clear();
+		layout_sdf_text(mesh, str, *font, color);
+		if (mesh.empty()) {
+			bounds = sf::FloatRect();
+			return;
+		}
+		float l = mesh[0].position.x, t = mesh[0].position.y, r = l, b = t;
+		for (const sf::Vertex& v : mesh) {
+			l = min(l, v.position.x), r = max(r, v.position.x);
+			t = min(t, v.position.y), b = max(b, v.position.y);
+		}
+		bounds = sf::FloatRect(l, t, r - l, b - t);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+
+namespace itc
+{
+	using namespace std;
+
+	class JobSystem;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Signed distance field glyph atlas for one .ttf file. sf::Text rasterizes a
+	 * glyph page per character size, this rasterizes each glyph once at RenderSize,
+	 * turns it into a distance field at 1/Downsample of that resolution and packs
+	 * the fields into one texture. Text drawn from it with the sdftext shader
+	 * stays sharp at any size, so scaling text only changes a transform.
+	 *
+	 * Building the fields is done on the JobSystem and the result is cached next
+	 * to the font as {font}.sdf, which is rebuilt if the font file changes.
+	 *
+	 * Glyph metrics are in em units: multiply by the character size in pixels.
+	 */
+	class SdfFont
+	{
+	public:
+		static const int RenderSize = 128; // glyph rasterization size in pixels
+		static const int Downsample = 4;   // rasterized pixels per field texel
+		static const int Spread     = 4;   // field range on either side of the outline, in field texels
+
+		struct Glyph
+		{
+			sf::FloatRect bounds;  // quad relative to the pen position on the baseline, in em
+			sf::IntRect   texRect; // in the atlas texture, texRect.width == 0 for glyphs without pixels
+			float advance;         // in em
+		};
+
+	private:
+		vector<char> fontData; // sf::Font reads the .ttf from here
+		sf::Font     font;     // kerning
+		sf::Uint32   first = 32; // code point of glyphs[0]
+		vector<Glyph> glyphs;
+		float        spacing = 1.0f;
+		sf::Texture  atlas;    // field in alpha, 0.5 on the outline
+
+	public:
+		/**
+		 * @brief Loads a .ttf and its distance field atlas, from the .sdf cache if
+		 *        it was built from the same font file, otherwise builds and saves it
+		 * @param jobs Distance fields are built on these workers, null to build on this thread
+		 */
+		bool loadFromFile(const string& ttfFile, JobSystem* jobs = nullptr, sf::Uint32 first = 32, sf::Uint32 last = 126);
+
+		const sf::Texture& texture() const { return atlas; }
+		float lineSpacing() const { return spacing; }
+		/** @return Kerning between two characters in em */
+		float kerning(sf::Uint32 prev, sf::Uint32 codePoint) const;
+		/** @return The glyph, or null if the character isn't in the atlas */
+		const Glyph* glyph(sf::Uint32 codePoint) const;
+
+		/** @return {ttfFile without extension}.sdf */
+		static string cacheFile(const string& ttfFile);
+
+	private:
+		/** @return false if the glyph fields don't fit in the largest atlas */
+		bool build(JobSystem* jobs, vector<sf::Uint8>& field, int& width, int& height);
+		bool loadCache(const string& file, unsigned long long fontHash, vector<sf::Uint8>& field, int& width, int& height);
+		bool saveCache(const string& file, unsigned long long fontHash, const vector<sf::Uint8>& field, int width, int height) const;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * @brief Lays out str like sf::Text would at a character size of 1, i.e. in em,
+	 *        and appends two triangles per glyph; texture coordinates are in atlas texels
+	 */
+	void layout_sdf_text(vector<sf::Vertex>& out, const sf::String& str, const SdfFont& font, const sf::Color& color);
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Text drawn from an SdfFont. The glyph mesh is built once in em units and
+	 * only rebuilt when the string or font change, the character size is just a
+	 * scale in the draw transform. Draw the geometry() with the sdftext shader
+	 * and the font's texture.
+	 */
+	class SdfText
+	{
+		sf::String     str;
+		const SdfFont* font  = nullptr;
+		sf::Color      color = sf::Color::White;
+
+		mutable vector<sf::Vertex> mesh; // em space triangles
+		mutable sf::FloatRect bounds;
+		mutable bool dirty = true;
+
+	public:
+		SdfText() {}
+		SdfText(const sf::String& str, const SdfFont& font, const sf::Color& color = sf::Color::White);
+
+		void setString(const sf::String& str);
+		void setFont(const SdfFont& font);
+		void setColor(const sf::Color& color);
+
+		const sf::String& getString() const { return str; }
+		const SdfFont* getFont() const { return font; }
+		const sf::Color& getColor() const { return color; }
+
+		/** @return Bounds of the glyph quads, with their field border, in em */
+		sf::FloatRect getLocalBounds() const;
+
+		/** @return Cached glyph triangles in em */
+		const vector<sf::Vertex>& geometry() const;
+
+	private:
+		void ensureGeometry() const;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
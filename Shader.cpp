@@ -1,11 +1,14 @@
 #include "Shader.hpp"
 #include <string.h>
 #include <sys/stat.h>
+#include <stddef.h> // offsetof
 
 namespace itc
 {
 	////////////////////////////////////////////////////////////////////////////////
 
+	DrawCounters DrawStats = { 0, 0 };
+
 	Vertex3dBuffer::Vertex3dBuffer() 
 		: arrayObj(0), vertexBuf(0), indexBuf(0), vertexCount(0), indexCount(0)
 	{
@@ -33,21 +36,32 @@ namespace itc
 			glGenBuffers(1, &vertexBuf);
 			glBindBuffer(GL_ARRAY_BUFFER, vertexBuf);
 			glBufferData(GL_ARRAY_BUFFER, numVertices*sizeof(vertex3d), vertices, GL_STATIC_DRAW);
-			// set VAO vertex attributes
-			glVertexAttribPointer(a_Pos, 3, GL_FLOAT, 0, sizeof(vertex3d), &vertices->pos);
+			// set VAO vertex attributes, pointers are offsets into the bound vertex buffer
+			glVertexAttribPointer(a_Pos, 3, GL_FLOAT, 0, sizeof(vertex3d), (void*)offsetof(vertex3d, pos));
 			glEnableVertexAttribArray(a_Pos);
-			glVertexAttribPointer(a_Tex, 2, GL_FLOAT, 0, sizeof(vertex3d), &vertices->tex);
+			glVertexAttribPointer(a_Tex, 2, GL_FLOAT, 0, sizeof(vertex3d), (void*)offsetof(vertex3d, tex));
 			glEnableVertexAttribArray(a_Tex);
-			glVertexAttribPointer(a_Norm, 3, GL_FLOAT, 0, sizeof(vertex3d), &vertices->norm);
+			glVertexAttribPointer(a_Norm, 3, GL_FLOAT, 0, sizeof(vertex3d), (void*)offsetof(vertex3d, norm));
 			glEnableVertexAttribArray(a_Norm);
 		}
 		glBindVertexArray(0);
 	}
-	void Vertex3dBuffer::draw()
+	void Vertex3dBuffer::draw() const
 	{
 		glBindVertexArray(arrayObj);
 		glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
 		glBindVertexArray(0);
+		++DrawStats.drawCalls;
+		DrawStats.triangles += indexCount / 3;
+	}
+	void Vertex3dBuffer::drawMulti(const GLsizei* counts, const GLvoid* const* offsets, int numRanges) const
+	{
+		glBindVertexArray(arrayObj);
+		glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, numRanges);
+		glBindVertexArray(0);
+		++DrawStats.drawCalls;
+		for (int i = 0; i < numRanges; ++i)
+			DrawStats.triangles += counts[i] / 3;
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -69,6 +83,8 @@ namespace itc
 		"coord2",        // a_Coord2
 		"vertex",        // a_Vertex
 		"color",         // a_Color
+		"instLayer",     // a_Layer
+		"instTransform", // a_Transform
 	};
 
 	static const char* uniform_name(ShaderUniform uniformSlot) {
@@ -149,8 +165,13 @@ namespace itc
 
 	bool Shader::loadShader(const string & shaderName)
 	{
-		snprintf(vs_path, sizeof(vs_path), "%s.vert", shaderName.data());
-		snprintf(fs_path, sizeof(fs_path), "%s.frag", shaderName.data());
+		return loadShader(shaderName, shaderName);
+	}
+
+	bool Shader::loadShader(const string& vertName, const string& fragName)
+	{
+		snprintf(vs_path, sizeof(vs_path), "%s.vert", vertName.data());
+		snprintf(fs_path, sizeof(fs_path), "%s.frag", fragName.data());
 		vs_mod = 0;
 		fs_mod = 0;
 		memset(uniforms,   -1,    sizeof(uniforms));
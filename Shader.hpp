@@ -46,11 +46,23 @@ namespace itc
 		a_Coord2,        // attribute vec2 coord2;    texture coordinate 1
 		a_Vertex,        // attribute vec4 vertex;    additional generic 4D vertex
 		a_Color,         // attribute vec4 color;     per-vertex coloring
+		a_Layer,         // attribute int instLayer;  per-instance texture array layer
+		a_Transform,     // attribute mat4 instTransform; per-instance model-view-project matrix, uses 4 slots
 		a_MaxAttributes, // attribute counter
 	} ShaderAttr;
 
 	////////////////////////////////////////////////////////////////////////////////
 
+	/** @brief Per-frame draw counters, only touched by the thread that owns the GL context */
+	struct DrawCounters
+	{
+		unsigned drawCalls;
+		unsigned triangles;
+		void reset() { drawCalls = 0, triangles = 0; }
+	};
+
+	extern DrawCounters DrawStats;
+
 	struct Vertex3dBuffer
 	{
 		enum { a_Pos = a_Position, a_Tex = a_Coord, a_Norm = a_Normal, };
@@ -64,7 +76,9 @@ namespace itc
 		~Vertex3dBuffer();
 		void create(const vertex3d* verts, int numVerts,
 					const index_t* indices, int numIndices);
-		void draw();
+		void draw() const;
+		/** @brief Draws several index ranges with one glMultiDrawElements call */
+		void drawMulti(const GLsizei* counts, const GLvoid* const* offsets, int numRanges) const;
 	};
 
 
@@ -86,6 +100,8 @@ namespace itc
 		~Shader();
 		/** @brief Loads shader from {shaderName}.frag and {shaderName}.vert */
 		bool loadShader(const string& shaderName);
+		/** @brief Loads shader from {vertName}.vert and {fragName}.frag */
+		bool loadShader(const string& vertName, const string& fragName);
 		/** @brief Reloads shader if VS or FS are modified. */
 		bool hotload();
 		/** @brief Forces a full recompile of the shaders */
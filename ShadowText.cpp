@@ -0,0 +1,112 @@
+#include "ShadowText.hpp"
+#include "Shader.hpp" // DrawStats
+#include <algorithm>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	ShadowText::ShadowText(const sf::String& str, const sf::Font& font, const sf::Font& shadowFont, unsigned characterSize)
+		: str(str), font(&font), shadowFont(&shadowFont), size(characterSize)
+	{
+	}
+
+	void ShadowText::setString(const sf::String& s)
+	{
+		if (str == s) return;
+		str   = s;
+		dirty = true;
+	}
+
+	void ShadowText::setFonts(const sf::Font& mainFont, const sf::Font& shadow)
+	{
+		if (font == &mainFont && shadowFont == &shadow) return;
+		font       = &mainFont;
+		shadowFont = &shadow;
+		dirty      = true;
+	}
+
+	void ShadowText::setCharacterSize(unsigned characterSize)
+	{
+		if (size == characterSize) return;
+		size  = characterSize;
+		dirty = true;
+	}
+
+	void ShadowText::setColors(const sf::Color& mainColor, const sf::Color& shadow)
+	{
+		color       = mainColor;
+		shadowColor = shadow;
+		for (sf::Vertex& v : mainMesh)   v.color = color;
+		for (sf::Vertex& v : shadowMesh) v.color = shadowColor;
+	}
+
+	void ShadowText::setAtlas(const GlyphAtlas* glyphAtlas)
+	{
+		if (atlas == glyphAtlas) return;
+		atlas = glyphAtlas;
+		dirty = true;
+	}
+
+	sf::FloatRect ShadowText::getLocalBounds() const
+	{
+		ensureGeometry();
+		return bounds;
+	}
+
+	void ShadowText::ensureGeometry() const
+	{
+		if (!dirty || !font || !shadowFont)
+			return;
+		dirty = false;
+		++rebuilds;
+
+		int mainIndex   = atlas ? atlas->find(font, size) : -1;
+		int shadowIndex = atlas ? atlas->find(shadowFont, size) : -1;
+		bool useAtlas   = mainIndex >= 0 && shadowIndex >= 0;
+
+		mainMesh.clear();
+		shadowMesh.clear();
+		layout_text(mainMesh,   str, *font,       size, color,       useAtlas ? atlas : nullptr, mainIndex);
+		layout_text(shadowMesh, str, *shadowFont, size, shadowColor, useAtlas ? atlas : nullptr, shadowIndex);
+		mainTexture   = useAtlas ? &atlas->texture() : &font->getTexture(size);
+		shadowTexture = useAtlas ? &atlas->texture() : &shadowFont->getTexture(size);
+
+		if (mainMesh.empty()) {
+			bounds = sf::FloatRect();
+			return;
+		}
+		float l = mainMesh[0].position.x, t = mainMesh[0].position.y, r = l, b = t;
+		for (const sf::Vertex& v : mainMesh) {
+			l = min(l, v.position.x), r = max(r, v.position.x);
+			t = min(t, v.position.y), b = max(b, v.position.y);
+		}
+		bounds = sf::FloatRect(l, t, r - l, b - t);
+	}
+
+	void ShadowText::draw(SpriteBatch& batch, const sf::Transform& parent) const
+	{
+		ensureGeometry();
+		sf::Transform transform = parent * getTransform();
+		batch.addTriangles(shadowTexture, transform, shadowMesh.data(), (int)shadowMesh.size());
+		batch.addTriangles(mainTexture,   transform, mainMesh.data(),   (int)mainMesh.size());
+	}
+
+	void ShadowText::draw(sf::RenderTarget& target, sf::RenderStates states) const
+	{
+		ensureGeometry();
+		states.transform *= getTransform();
+		states.texture = shadowTexture;
+		if (!shadowMesh.empty()) {
+			target.draw(shadowMesh.data(), shadowMesh.size(), sf::Triangles, states);
+			++DrawStats.drawCalls;
+		}
+		states.texture = mainTexture;
+		if (!mainMesh.empty()) {
+			target.draw(mainMesh.data(), mainMesh.size(), sf::Triangles, states);
+			++DrawStats.drawCalls;
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
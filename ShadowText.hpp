@@ -0,0 +1,69 @@
+#pragma once
+#include "SpriteBatch.hpp"
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Text with a drop shadow drawn in a second font, e.g. neoretro over
+	 * neoretro-shadow. Both glyph meshes are built once in local space and only
+	 * rebuilt when the string, character size, fonts or atlas change. Position,
+	 * rotation and scale come from the Transformable and are applied as a
+	 * transform; color changes only recolor the cached vertices.
+	 *
+	 * With a GlyphAtlas holding both fonts the two meshes share a texture and
+	 * batch into one draw call, otherwise each mesh uses its font's own texture.
+	 */
+	class ShadowText : public sf::Drawable, public sf::Transformable
+	{
+		sf::String      str;
+		const sf::Font* font       = nullptr;
+		const sf::Font* shadowFont = nullptr;
+		unsigned        size       = 30;
+		sf::Color       color      = sf::Color::White;
+		sf::Color       shadowColor = sf::Color(0, 0, 0, 168);
+		const GlyphAtlas* atlas    = nullptr;
+
+		mutable vector<sf::Vertex> mainMesh;   // local space triangles
+		mutable vector<sf::Vertex> shadowMesh;
+		mutable const sf::Texture* mainTexture   = nullptr;
+		mutable const sf::Texture* shadowTexture = nullptr;
+		mutable sf::FloatRect bounds;
+		mutable bool dirty   = true;
+		mutable int rebuilds = 0;
+
+	public:
+		ShadowText() {}
+		ShadowText(const sf::String& str, const sf::Font& font, const sf::Font& shadowFont, unsigned characterSize);
+
+		void setString(const sf::String& str);
+		void setFonts(const sf::Font& font, const sf::Font& shadowFont);
+		void setCharacterSize(unsigned characterSize);
+		void setColors(const sf::Color& color, const sf::Color& shadowColor);
+		/** @brief Takes glyphs from atlas if it has both fonts at this size, null to use the fonts' textures */
+		void setAtlas(const GlyphAtlas* atlas);
+
+		const sf::String& getString() const { return str; }
+		unsigned getCharacterSize() const { return size; }
+		const sf::Color& getColor() const { return color; }
+		const sf::Color& getShadowColor() const { return shadowColor; }
+
+		/** @return Bounds of the main text, without the transform */
+		sf::FloatRect getLocalBounds() const;
+
+		/** @brief Adds the shadow, then the main text to a batch */
+		void draw(SpriteBatch& batch, const sf::Transform& parent = sf::Transform::Identity) const;
+
+		/** @return How many times the glyph meshes were built, for benchmarks */
+		int rebuildCount() const { return rebuilds; }
+
+	private:
+		void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+		void ensureGeometry() const;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,78 @@
+#include "SkylinePacker.hpp"
+#include <algorithm>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	void SkylinePacker::reset(int width, int maxHeight)
+	{
+		w    = width;
+		h    = maxHeight;
+		used = 0;
+		skyline.clear();
+		skyline.push_back({ 0, 0, width });
+	}
+
+	int SkylinePacker::fit(size_t i, int width, int height) const
+	{
+		int x = skyline[i].x;
+		if (x + width > w)
+			return -1;
+		int y = 0;
+		for (int left = width; left > 0; ++i) {
+			y = max(y, skyline[i].y);
+			left -= skyline[i].width;
+		}
+		return y + height <= h ? y : -1;
+	}
+
+	bool SkylinePacker::insert(int width, int height, sf::IntRect& outRect)
+	{
+		if (width <= 0 || height <= 0)
+			return false;
+		int bestY = -1, bestWidth = 0;
+		size_t best = 0;
+		for (size_t i = 0; i < skyline.size(); ++i)
+		{
+			int y = fit(i, width, height);
+			if (y < 0) continue;
+			if (bestY < 0 || y < bestY || (y == bestY && skyline[i].width < bestWidth))
+				bestY = y, bestWidth = skyline[i].width, best = i;
+		}
+		if (bestY < 0)
+			return false;
+
+		Segment top = { skyline[best].x, bestY + height, width };
+		skyline.insert(skyline.begin() + best, top);
+
+		// the segments under the new one shrink or disappear
+		for (size_t i = best + 1; i < skyline.size(); )
+		{
+			Segment& s = skyline[i];
+			int covered = top.x + top.width - s.x;
+			if (covered <= 0) break;
+			if (covered < s.width) {
+				s.x     += covered;
+				s.width -= covered;
+				break;
+			}
+			skyline.erase(skyline.begin() + i);
+		}
+		// neighbours at the same height become one segment
+		for (size_t i = 0; i + 1 < skyline.size(); )
+		{
+			if (skyline[i].y == skyline[i + 1].y) {
+				skyline[i].width += skyline[i + 1].width;
+				skyline.erase(skyline.begin() + i + 1);
+			}
+			else ++i;
+		}
+
+		outRect = sf::IntRect(top.x, bestY, width, height);
+		used = max(used, bestY + height);
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
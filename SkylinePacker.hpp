@@ -0,0 +1,51 @@
+#pragma once
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Rectangle packer for texture atlases. Keeps the top edge of the packed area
+	 * as a skyline of horizontal segments and puts every rectangle where its bottom
+	 * ends up highest, ties going to the narrowest segment. Unlike shelf packing,
+	 * short rectangles fill the gaps next to tall ones instead of wasting them.
+	 * Works best with rectangles inserted tallest first.
+	 */
+	class SkylinePacker
+	{
+		struct Segment
+		{
+			int x, y, width; // y is the top of the free space above x ... x + width
+		};
+		vector<Segment> skyline;
+		int w = 0, h = 0;
+		int used = 0;
+
+	public:
+		SkylinePacker() {}
+		SkylinePacker(int width, int height) { reset(width, height); }
+
+		/** @brief Empties the packer, maxHeight can be generous if the texture is sized from usedHeight() */
+		void reset(int width, int maxHeight);
+
+		/**
+		 * @brief Finds room for a width x height rectangle
+		 * @return false if it doesn't fit anywhere
+		 */
+		bool insert(int width, int height, sf::IntRect& outRect);
+
+		int width()  const { return w; }
+		/** @return Bottom of the lowest rectangle so far */
+		int usedHeight() const { return used; }
+
+	private:
+		/** @return Top y of a width wide rectangle placed at segment i, -1 if it doesn't fit */
+		int fit(size_t i, int width, int height) const;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
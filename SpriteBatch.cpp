@@ -0,0 +1,247 @@
+#include "SpriteBatch.hpp"
+#include "SkylinePacker.hpp"
+#include "Shader.hpp" // DrawStats
+#include <algorithm>
+#include <stdio.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	int GlyphAtlas::addFont(const sf::Font& font, unsigned characterSize, sf::Uint32 first, sf::Uint32 last)
+	{
+		FontGlyphs f;
+		f.font  = &font;
+		f.size  = characterSize;
+		f.first = first;
+		f.glyphs.resize(last - first + 1);
+		f.lineSpacing = font.getLineSpacing(characterSize);
+		fonts.push_back(f);
+		return (int)fonts.size() - 1;
+	}
+
+	int GlyphAtlas::addImage(const sf::Image& image)
+	{
+		images.push_back(image);
+		imageRects.push_back(sf::IntRect());
+		return (int)images.size() - 1;
+	}
+
+	void GlyphAtlas::setSprite(sf::Sprite& sprite, int imageIndex) const
+	{
+		sprite.setTexture(atlas);
+		sprite.setTextureRect(imageRects[imageIndex]);
+	}
+
+	// copies image to x, y and repeats its outermost pixels one further, so filtering
+	// at the edges doesn't pick up whatever was packed next to it
+	static void copy_extruded(sf::Image& dst, const sf::Image& image, int x, int y)
+	{
+		int w = (int)image.getSize().x, h = (int)image.getSize().y;
+		dst.copy(image, x, y);
+		dst.copy(image, x, y - 1, sf::IntRect(0, 0, w, 1));
+		dst.copy(image, x, y + h, sf::IntRect(0, h - 1, w, 1));
+		dst.copy(image, x - 1, y, sf::IntRect(0, 0, 1, h));
+		dst.copy(image, x + w, y, sf::IntRect(w - 1, 0, 1, h));
+		dst.setPixel(x - 1, y - 1, image.getPixel(0, 0));
+		dst.setPixel(x + w, y - 1, image.getPixel(w - 1, 0));
+		dst.setPixel(x - 1, y + h, image.getPixel(0, h - 1));
+		dst.setPixel(x + w, y + h, image.getPixel(w - 1, h - 1));
+	}
+
+	int GlyphAtlas::find(const sf::Font* font, unsigned characterSize) const
+	{
+		for (size_t i = 0; i < fonts.size(); ++i)
+			if (fonts[i].font == font && fonts[i].size == characterSize)
+				return (int)i;
+		return -1;
+	}
+
+	const GlyphAtlas::Glyph* GlyphAtlas::glyph(int fontIndex, sf::Uint32 codePoint) const
+	{
+		const FontGlyphs& f = fonts[fontIndex];
+		if (codePoint < f.first || codePoint - f.first >= f.glyphs.size())
+			return nullptr;
+		return &f.glyphs[codePoint - f.first];
+	}
+
+	bool GlyphAtlas::build()
+	{
+		// rasterize every glyph into SFML's per-font pages, then read each page back once
+		struct Source { int font; int glyph; sf::IntRect rect; }; // font -1 is images[glyph]
+		vector<Source> sources;
+		vector<sf::Image> pages(fonts.size());
+		for (size_t fi = 0; fi < fonts.size(); ++fi)
+		{
+			FontGlyphs& f = fonts[fi];
+			for (size_t g = 0; g < f.glyphs.size(); ++g)
+			{
+				const sf::Glyph& glyph = f.font->getGlyph(f.first + (sf::Uint32)g, f.size, false);
+				f.glyphs[g].bounds  = glyph.bounds;
+				f.glyphs[g].advance = glyph.advance;
+				f.glyphs[g].texRect = sf::IntRect();
+				if (glyph.textureRect.width > 0 && glyph.textureRect.height > 0)
+					sources.push_back({ (int)fi, (int)g, glyph.textureRect });
+			}
+			pages[fi] = f.font->getTexture(f.size).copyToImage();
+		}
+		int width = 1024;
+		for (size_t i = 0; i < images.size(); ++i) {
+			sf::Vector2u size = images[i].getSize();
+			if (!size.x || !size.y) continue;
+			sources.push_back({ -1, (int)i, sf::IntRect(0, 0, size.x, size.y) });
+			while (width < (int)size.x + 2) width *= 2;
+		}
+
+		// skyline packing, tallest first; images get a 1px border of their own edge pixels
+		sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) {
+			return a.rect.height > b.rect.height;
+		});
+		const int padding = 1;
+		SkylinePacker packer { width, 16384 };
+		long long area = 0;
+		for (Source& s : sources)
+		{
+			area += (long long)s.rect.width * s.rect.height;
+			int border = s.font < 0 ? 1 : 0;
+			sf::IntRect r;
+			if (!packer.insert(s.rect.width + padding + 2 * border, s.rect.height + padding + 2 * border, r)) {
+				fprintf(stderr, "GlyphAtlas::build(): %d glyphs and images don't fit in %d wide texture\n",
+					(int)sources.size(), width);
+				return false;
+			}
+			r = sf::IntRect(r.left + border, r.top + border, s.rect.width, s.rect.height);
+			if (s.font < 0) imageRects[s.glyph] = r;
+			else            fonts[s.font].glyphs[s.glyph].texRect = r;
+		}
+		int height = 64;
+		while (height < packer.usedHeight()) height *= 2;
+
+		sf::Image image;
+		image.create(width, height, sf::Color(255, 255, 255, 0));
+		for (const Source& s : sources) {
+			if (s.font < 0) {
+				copy_extruded(image, images[s.glyph], imageRects[s.glyph].left, imageRects[s.glyph].top);
+				continue;
+			}
+			const sf::IntRect& dst = fonts[s.font].glyphs[s.glyph].texRect;
+			image.copy(pages[s.font], dst.left, dst.top, s.rect);
+		}
+		if (!atlas.loadFromImage(image)) {
+			fprintf(stderr, "GlyphAtlas::build(): failed to create %dx%d texture\n", width, height);
+			return false;
+		}
+		atlas.setSmooth(true);
+		printf("GlyphAtlas: %d fonts, %d glyphs and images in %dx%d, %d%% used\n", (int)fonts.size(),
+			(int)sources.size(), width, height, (int)(area * 100 / ((long long)width * height)));
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	void layout_text(vector<sf::Vertex>& out, const sf::String& str, const sf::Font& font, unsigned size,
+	                 const sf::Color& color, const GlyphAtlas* atlas, int atlasFont)
+	{
+		// same rules as sf::Text: first baseline at characterSize, kerning between pairs
+		const sf::Glyph& space = font.getGlyph(' ', size, false);
+		float x = 0.0f, y = (float)size;
+		sf::Uint32 prev = 0;
+		for (size_t i = 0; i < str.getSize(); ++i)
+		{
+			sf::Uint32 c = str[i];
+			x += font.getKerning(prev, c, size);
+			prev = c;
+			if (c == ' ')  { x += space.advance; continue; }
+			if (c == '\t') { x += space.advance * 4; continue; }
+			if (c == '\n') { x = 0.0f; y += font.getLineSpacing(size); continue; }
+
+			sf::FloatRect bounds;
+			sf::IntRect tex;
+			float advance;
+			if (atlas) {
+				const GlyphAtlas::Glyph* g = atlas->glyph(atlasFont, c);
+				if (!g) continue;
+				bounds = g->bounds, tex = g->texRect, advance = g->advance;
+			}
+			else {
+				const sf::Glyph& g = font.getGlyph(c, size, false);
+				bounds = g.bounds, tex = g.textureRect, advance = g.advance;
+			}
+			if (tex.width > 0)
+			{
+				float l = x + bounds.left, t = y + bounds.top, r = l + bounds.width, b = t + bounds.height;
+				float u0 = (float)tex.left, v0 = (float)tex.top;
+				float u1 = u0 + tex.width,  v1 = v0 + tex.height;
+				sf::Vertex tl(sf::Vector2f(l, t), color, sf::Vector2f(u0, v0));
+				sf::Vertex tr(sf::Vector2f(r, t), color, sf::Vector2f(u1, v0));
+				sf::Vertex bl(sf::Vector2f(l, b), color, sf::Vector2f(u0, v1));
+				sf::Vertex br(sf::Vector2f(r, b), color, sf::Vector2f(u1, v1));
+				out.push_back(tl); out.push_back(tr); out.push_back(bl);
+				out.push_back(bl); out.push_back(tr); out.push_back(br);
+			}
+			x += advance;
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	void SpriteBatch::addQuad(const sf::Texture* texture, const sf::Transform& transform, const sf::FloatRect& rect,
+	                          const sf::FloatRect& texRect, const sf::Color& color)
+	{
+		if (runs.empty() || runs.back().texture != texture)
+			runs.push_back({ texture, (int)vertices.size(), 0 });
+
+		float l = rect.left, t = rect.top, r = rect.left + rect.width, b = rect.top + rect.height;
+		float u0 = texRect.left, v0 = texRect.top, u1 = u0 + texRect.width, v1 = v0 + texRect.height;
+		sf::Vertex tl(transform.transformPoint(l, t), color, sf::Vector2f(u0, v0));
+		sf::Vertex tr(transform.transformPoint(r, t), color, sf::Vector2f(u1, v0));
+		sf::Vertex bl(transform.transformPoint(l, b), color, sf::Vector2f(u0, v1));
+		sf::Vertex br(transform.transformPoint(r, b), color, sf::Vector2f(u1, v1));
+		vertices.push_back(tl); vertices.push_back(tr); vertices.push_back(bl);
+		vertices.push_back(bl); vertices.push_back(tr); vertices.push_back(br);
+		runs.back().count += 6;
+	}
+
+	void SpriteBatch::addSprite(const sf::Sprite& sprite, const sf::Transform& transform)
+	{
+		sf::Transform t = transform * sprite.getTransform();
+		sf::IntRect tex = sprite.getTextureRect();
+		addQuad(sprite.getTexture(), t, sprite.getLocalBounds(),
+			sf::FloatRect((float)tex.left, (float)tex.top, (float)tex.width, (float)tex.height), sprite.getColor());
+	}
+
+	void SpriteBatch::addTriangles(const sf::Texture* texture, const sf::Transform& transform,
+	                               const sf::Vertex* triangles, int count)
+	{
+		if (!count) return;
+		if (runs.empty() || runs.back().texture != texture)
+			runs.push_back({ texture, (int)vertices.size(), 0 });
+		size_t first = vertices.size();
+		vertices.insert(vertices.end(), triangles, triangles + count);
+		for (size_t i = first; i < vertices.size(); ++i)
+			vertices[i].position = transform.transformPoint(vertices[i].position);
+		runs.back().count += count;
+	}
+
+	void SpriteBatch::addText(const GlyphAtlas& atlas, int fontIndex, const sf::String& str,
+	                          const sf::Transform& transform, const sf::Color& color)
+	{
+		scratch.clear();
+		layout_text(scratch, str, atlas.font(fontIndex), atlas.characterSize(fontIndex), color, &atlas, fontIndex);
+		addTriangles(&atlas.texture(), transform, scratch.data(), (int)scratch.size());
+	}
+
+	void SpriteBatch::flush(sf::RenderTarget& target)
+	{
+		for (const Run& run : runs)
+		{
+			if (!run.count) continue;
+			target.draw(&vertices[run.first], run.count, sf::Triangles, sf::RenderStates(run.texture));
+			++DrawStats.drawCalls;
+		}
+		vertices.clear();
+		runs.clear();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Glyphs of several fonts and character sizes packed into one texture, so text
+	 * in different fonts, e.g. a title and its shadow, can be drawn in one batch.
+	 * Small GUI images can go in as well, so sprites batch with the text too.
+	 * Fonts and images are registered with addFont() and addImage() and packed
+	 * once by build().
+	 */
+	class GlyphAtlas
+	{
+	public:
+		struct Glyph
+		{
+			sf::FloatRect bounds;  // relative to the pen position on the baseline
+			sf::IntRect   texRect; // in the atlas texture
+			float advance;
+		};
+
+	private:
+		struct FontGlyphs
+		{
+			const sf::Font* font;
+			unsigned size;
+			sf::Uint32 first;     // code point of glyphs[0]
+			vector<Glyph> glyphs; // texRect.width == 0 for glyphs without pixels
+			float lineSpacing;
+		};
+		vector<FontGlyphs> fonts;
+		vector<sf::Image>   images;
+		vector<sf::IntRect> imageRects;
+		sf::Texture atlas;
+
+	public:
+		/** @return Index of the font for glyph(), the atlas must be rebuilt after this */
+		int addFont(const sf::Font& font, unsigned characterSize, sf::Uint32 first = 32, sf::Uint32 last = 126);
+
+		/** @return Index of the image for imageRect(), the atlas must be rebuilt after this */
+		int addImage(const sf::Image& image);
+
+		/** @brief Packs all added fonts and images into the atlas texture */
+		bool build();
+
+		/** @return Font index for glyph(), -1 if that font and size aren't in the atlas */
+		int find(const sf::Font* font, unsigned characterSize) const;
+
+		const sf::Texture& texture() const { return atlas; }
+		const sf::Font& font(int fontIndex) const { return *fonts[fontIndex].font; }
+		unsigned characterSize(int fontIndex) const { return fonts[fontIndex].size; }
+		float lineSpacing(int fontIndex) const { return fonts[fontIndex].lineSpacing; }
+
+		/** @return The glyph, or null if the character isn't in the atlas */
+		const Glyph* glyph(int fontIndex, sf::Uint32 codePoint) const;
+
+		/** @return Where image imageIndex ended up in the atlas texture */
+		const sf::IntRect& imageRect(int imageIndex) const { return imageRects[imageIndex]; }
+
+		/** @brief Points sprite at image imageIndex in the atlas, replacing its texture and rect */
+		void setSprite(sf::Sprite& sprite, int imageIndex) const;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * @brief Lays out str like sf::Text would and appends two triangles per glyph, in local space
+	 * @param atlas Takes glyphs from atlas font atlasFont if set, otherwise from font's own texture
+	 */
+	void layout_text(vector<sf::Vertex>& out, const sf::String& str, const sf::Font& font, unsigned characterSize,
+	                 const sf::Color& color, const GlyphAtlas* atlas = nullptr, int atlasFont = -1);
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Collects textured quads for a frame and draws each run of quads that share
+	 * a texture with a single draw call. Sprites, and text from a GlyphAtlas,
+	 * can be mixed freely; quads are drawn in the order they were added.
+	 */
+	class SpriteBatch
+	{
+		struct Run
+		{
+			const sf::Texture* texture;
+			int first, count; // vertices
+		};
+		vector<sf::Vertex> vertices; // two triangles per quad
+		vector<Run> runs;
+		vector<sf::Vertex> scratch;
+
+	public:
+		void addQuad(const sf::Texture* texture, const sf::Transform& transform, const sf::FloatRect& rect,
+		             const sf::FloatRect& texRect, const sf::Color& color);
+
+		void addSprite(const sf::Sprite& sprite, const sf::Transform& transform);
+
+		/** @brief Adds prebuilt triangles, e.g. a cached text mesh, moved by transform */
+		void addTriangles(const sf::Texture* texture, const sf::Transform& transform,
+		                  const sf::Vertex* triangles, int count);
+
+		/** @brief Lays out str like sf::Text would, using glyphs from the atlas */
+		void addText(const GlyphAtlas& atlas, int fontIndex, const sf::String& str,
+		             const sf::Transform& transform, const sf::Color& color);
+
+		/** @brief Draws and clears everything added so far */
+		void flush(sf::RenderTarget& target);
+
+		/** @brief Drops everything added so far without drawing it */
+		void clear() { vertices.clear(); runs.clear(); }
+
+		bool empty() const { return runs.empty(); }
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
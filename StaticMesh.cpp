@@ -2,6 +2,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <algorithm>
+#include <string.h>
+#include "MeshSimplify.hpp"
 
 
 namespace itc
@@ -44,14 +47,237 @@ namespace itc
 		return unique_ptr<BMDModel>(m);
 	}
 
+	unique_ptr<BMDModel> BMDModel::create(const char* name, const char* texName,
+	                                      const vertex3d* verts, int numVerts,
+	                                      const index_t* indices, int numIndices)
+	{
+		int size = sizeof(BMDModel) + numVerts * sizeof(vertex3d) + numIndices * sizeof(index_t);
+		BMDModel* m = (BMDModel*)malloc(size); // same allocation as loadFromFile
+		if (!m) {
+			fprintf(stderr, "BMDModel::create(): malloc %dKB failed %s\n", size/1024, name);
+			return nullptr;
+		}
+		memset((void*)m, 0, sizeof(BMDModel));
+		strncpy(m->name, name, sizeof(m->name) - 1);
+		strncpy(m->tex_name, texName, sizeof(m->tex_name) - 1);
+		m->num_verts   = numVerts;
+		m->num_indices = numIndices;
+		m->off_verts   = sizeof(BMDModel);
+		m->off_indices = m->off_verts + numVerts * sizeof(vertex3d);
+		memcpy(m->vertices(), verts, numVerts * sizeof(vertex3d));
+		memcpy(m->indices(), indices, numIndices * sizeof(index_t));
+		return unique_ptr<BMDModel>(m);
+	}
+
+	bool BMDModel::saveToFile(const string& file) const
+	{
+		FILE* f = fopen(file.data(), "wb");
+		if (!f) {
+			fprintf(stderr, "BMDModel::saveToFile(): fopen failed %s\n", file.data());
+			return false;
+		}
+		BMDModel header = *this;
+		header.off_verts   = sizeof(BMDModel);
+		header.off_indices = header.off_verts + num_verts * sizeof(vertex3d);
+		bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+		       && fwrite(vertices(), sizeof(vertex3d), num_verts, f) == (size_t)num_verts
+		       && fwrite(indices(), sizeof(index_t), num_indices, f) == (size_t)num_indices;
+		fclose(f);
+		if (!ok) fprintf(stderr, "BMDModel::saveToFile(): fwrite failed %s\n", file.data());
+		return ok;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	LodView::LodView(const vec3& eye, const vec3& center, float fovY)
+		: eye(eye), forward((center - eye).normalized()), projScale(1.0f / tanf(radf(fovY) * 0.5f))
+	{
+	}
+
+	float LodView::screenSize(const vec3& center, float radius) const
+	{
+		vec3 toCenter = center - eye;
+		float depth = toCenter.dot(forward);
+		if (depth < -radius)
+			return 0.0f; // entirely behind the camera
+		float dist = sqrtf(toCenter.dot(toCenter));
+		if (dist <= radius)
+			return 1.0f; // camera is inside the bounds
+		return radius * projScale / dist;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	static bool file_exists(const string& file)
+	{
+		struct stat s;
+		return stat(file.c_str(), &s) == 0;
+	}
+
+	// splits "path/name_lod1.bmd" into "path/name" and 1; returns -1 if there is no _lodN suffix
+	static int parse_lod_name(const string& path, string& outBase)
+	{
+		outBase = path.substr(0, path.rfind('.'));
+		size_t pos = outBase.rfind("_lod");
+		if (pos == string::npos || pos + 4 == outBase.size())
+			return -1;
+		for (size_t i = pos + 4; i < outBase.size(); ++i)
+			if (outBase[i] < '0' || outBase[i] > '9') return -1;
+		int lod = atoi(outBase.c_str() + pos + 4);
+		outBase.erase(pos);
+		return lod;
+	}
+
+	string StaticMesh::lodFile(const string& resourcePath, int level)
+	{
+		string base;
+		int lod = max(parse_lod_name(resourcePath, base), 0) + level;
+		char file[512];
+		snprintf(file, sizeof(file), "%s_lod%d.bmd", base.c_str(), lod);
+		return file;
+	}
+
 	StaticMesh::StaticMesh(const string & resourcePath)
 	{
+		unique_ptr<BMDModel> model = BMDModel::loadFromFile(resourcePath);
+		if (!model)
+			return;
+		addLod(move(model), resourcePath);
+
+		// resourcePath is the finest level, probe for coarser ones next to it
+		for (int level = 1; ; ++level)
+		{
+			string file = lodFile(resourcePath, level);
+			if (!file_exists(file) || !(model = BMDModel::loadFromFile(file)))
+				break;
+			if (model->num_indices > Lods.back()->MeshData->num_indices * MaxLodTriangleRatio) {
+				fprintf(stderr, "StaticMesh::StaticMesh(): %s isn't coarser than the previous level, ignoring it and any coarser ones\n",
+					file.c_str());
+				break;
+			}
+			addLod(move(model), file);
+		}
+		setupLodSizes();
+		computeBounds();
 	}
 
 	StaticMesh::~StaticMesh()
 	{
 	}
 
+	int StaticMesh::generateLods(JobSystem* jobs, const float* ratios, int numRatios)
+	{
+		if (Lods.size() != 1)
+			return 0;
+		if (!ratios) {
+			ratios    = DefaultLodRatios;
+			numRatios = sizeof(DefaultLodRatios) / sizeof(DefaultLodRatios[0]);
+		}
+
+		const BMDModel* m = Lods[0]->MeshData.get();
+		printf("Generating %d LODs for %s (%d tris)\n", numRatios, m->name, m->num_indices / 3);
+		vector<SimplifiedMesh> chain = generate_lod_chain(m->vertices(), m->num_verts,
+			m->indices(), m->num_indices, ratios, numRatios, jobs);
+		for (const SimplifiedMesh& lod : chain)
+		{
+			unique_ptr<BMDModel> model = BMDModel::create(m->name, m->tex_name,
+				lod.vertices.data(), (int)lod.vertices.size(), lod.indices.data(), (int)lod.indices.size());
+			if (!model) break;
+			addLod(move(model));
+		}
+		setupLodSizes();
+		return numLods() - 1;
+	}
+
+	string StaticMesh::meshletFile(const string& resourcePath)
+	{
+		return resourcePath.substr(0, resourcePath.rfind('.')) + ".meshlets";
+	}
+
+	void StaticMesh::addLod(unique_ptr<BMDModel> model, const string& file)
+	{
+		MeshLod* lod = new MeshLod();
+		lod->MeshData = move(model);
+		BMDModel* m = lod->MeshData.get();
+		Lods.emplace_back(lod);
+
+		// dense levels are split into meshlets, from the offline sidecar if there is one
+		const index_t* indices = m->indices();
+		if (m->num_indices / 3 >= MeshletMinTris)
+		{
+			lod->Meshlets.reset(new MeshletMesh());
+			string sidecar = file.empty() ? file : meshletFile(file);
+			if (sidecar.empty() || !file_exists(sidecar)
+				|| !lod->Meshlets->loadFromFile(sidecar, MeshletMesh::sourceHash(m->vertices(), m->num_verts,
+				                                indices, m->num_indices), m->num_verts)
+				|| (int)lod->Meshlets->indices.size() != m->num_indices)
+				lod->Meshlets->build(m->vertices(), m->num_verts, indices, m->num_indices);
+			indices = lod->Meshlets->indices.data();
+		}
+		lod->Vertex3dBuff.create(m->vertices(), m->num_verts, indices, m->num_indices);
+	}
+
+	void StaticMesh::setupLodSizes()
+	{
+		// each level covers half the screen size of the previous one
+		LodScreenSizes.clear();
+		float size = 0.5f;
+		for (int i = 1; i < numLods(); ++i, size *= 0.5f)
+			LodScreenSizes.push_back(size);
+	}
+
+	void StaticMesh::computeBounds()
+	{
+		const BMDModel* m = Lods[0]->MeshData.get();
+		const vertex3d* v = m->vertices();
+		if (!m->num_verts) {
+			BoundsCenter = BoundsMin = BoundsMax = vec3(0.0f, 0.0f, 0.0f), BoundsRadius = 0.0f;
+			UvDensity = 0.0f;
+			return;
+		}
+		vec3 lo = v[0].pos, hi = v[0].pos;
+		for (int i = 1; i < m->num_verts; ++i)
+		{
+			const vec3& p = v[i].pos;
+			lo = vec3(min(lo.x, p.x), min(lo.y, p.y), min(lo.z, p.z));
+			hi = vec3(max(hi.x, p.x), max(hi.y, p.y), max(hi.z, p.z));
+		}
+		BoundsMin    = lo;
+		BoundsMax    = hi;
+		BoundsCenter = (lo + hi) * 0.5f;
+		float sqRadius = 0.0f;
+		for (int i = 0; i < m->num_verts; ++i)
+		{
+			vec3 d = v[i].pos - BoundsCenter;
+			sqRadius = max(sqRadius, d.dot(d));
+		}
+		BoundsRadius = sqrtf(sqRadius);
+
+		// texels per model unit is UvDensity * texture size, averaged over the surface
+		double uvArea = 0.0, area = 0.0;
+		const index_t* idx = m->indices();
+		for (int i = 0; i + 2 < m->num_indices; i += 3)
+		{
+			const vertex3d& a = v[idx[i]], &b = v[idx[i + 1]], &c = v[idx[i + 2]];
+			vec3 n = (b.pos - a.pos).cross(c.pos - a.pos);
+			area   += sqrtf(n.dot(n));
+			uvArea += fabsf((b.tex.x - a.tex.x) * (c.tex.y - a.tex.y) - (c.tex.x - a.tex.x) * (b.tex.y - a.tex.y));
+		}
+		UvDensity = area > 0.0 ? (float)sqrt(uvArea / area) : 0.0f;
+	}
+
+	int StaticMesh::selectLod(float screenSize, int currentLod) const
+	{
+		if (screenSize < MinScreenSize)
+			return -1;
+		int lod = currentLod < 0 ? 0 : min(currentLod, numLods() - 1);
+		while (lod + 1 < numLods() && screenSize < LodScreenSizes[lod] * (1.0f - LodHysteresis))
+			++lod;
+		while (lod > 0 && screenSize > LodScreenSizes[lod - 1] * (1.0f + LodHysteresis))
+			--lod;
+		return lod;
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 }
 
@@ -1,6 +1,10 @@
 #pragma once
 #include "Shader.hpp"
+#include "Meshlet.hpp"
 #include <memory> // unique_ptr
+#include <vector>
+
+namespace itc { class JobSystem; }
 
 namespace itc
 {
@@ -22,20 +26,96 @@ namespace itc
 		index_t*  indices()  const;
 
 		static unique_ptr<BMDModel> loadFromFile(const string& file);
+
+		/** @brief Creates a new model with vertex and index data packed after the header */
+		static unique_ptr<BMDModel> create(const char* name, const char* texName,
+		                                   const vertex3d* verts, int numVerts,
+		                                   const index_t* indices, int numIndices);
+
+		/** @return true if the model was written to file */
+		bool saveToFile(const string& file) const;
 	private:
 		BMDModel() {}
 	};
 
-	struct StaticMesh
+	/** @brief One level of detail of a StaticMesh */
+	struct MeshLod
 	{
 		unique_ptr<BMDModel> MeshData;     // 
 		Vertex3dBuffer       Vertex3dBuff; // buffer of vertex3d elements
+		unique_ptr<MeshletMesh> Meshlets;  // null for small meshes; if set, Vertex3dBuff indices are in meshlet order
+	};
+
+	/** @brief Camera parameters needed for LOD selection */
+	struct LodView
+	{
+		vec3  eye;       // camera position
+		vec3  forward;   // normalized view direction
+		float projScale; // 1 / tan(fovY / 2)
+
+		LodView() {}
+		LodView(const vec3& eye, const vec3& center, float fovY);
+
+		/** @return Fraction of the screen height covered by a world space sphere, 0 if behind the camera */
+		float screenSize(const vec3& center, float radius) const;
+	};
+
+	/**
+	 * A static mesh with an optional LOD chain. Lods[0] is the full detail mesh,
+	 * coarser levels are loaded from {name}_lod1.bmd, {name}_lod2.bmd, ... next to it.
+	 */
+	struct StaticMesh
+	{
+		vector<unique_ptr<MeshLod>> Lods;
+
+		static const int MeshletMinTris = 2048; // smaller levels are drawn whole
+
+		// LOD i+1 is used when the screen size drops below LodScreenSizes[i]
+		vector<float> LodScreenSizes;
+		float LodHysteresis = 0.15f;   // relative band around each threshold to avoid popping
+		float MinScreenSize = 0.004f;  // below this the mesh isn't drawn at all
+
+		vec3  BoundsCenter; // model space bounding sphere of Lods[0]
+		float BoundsRadius;
+		vec3  BoundsMin;    // model space bounding box of Lods[0]
+		vec3  BoundsMax;
+		float UvDensity;    // texture coordinate units per model unit on Lods[0], for picking texture mips
 
 		StaticMesh(const string& resourcePath);
 		~StaticMesh();
 
-		operator bool() const { return MeshData && Vertex3dBuff.vertexCount; }
+		operator bool() const { return !Lods.empty() && Lods[0]->Vertex3dBuff.vertexCount; }
+
+		/**
+		 * @brief Simplifies Lods[0] into a LOD chain if no LOD files were found
+		 * @param ratios Triangle ratios of the generated levels, DefaultLodRatios if null
+		 * @return Number of LODs generated
+		 */
+		int generateLods(JobSystem* jobs, const float* ratios = nullptr, int numRatios = 0);
 
+		/** @return File name of the LOD that is level steps coarser than resourcePath */
+		static string lodFile(const string& resourcePath, int level);
+
+		/** @return File name of the meshlet sidecar written next to a BMD file */
+		static string meshletFile(const string& resourcePath);
+
+		int numLods() const { return (int)Lods.size(); }
+		const Vertex3dBuffer& buffer(int lod) const { return Lods[lod]->Vertex3dBuff; }
+		const MeshletMesh* meshlets(int lod) const { return Lods[lod]->Meshlets.get(); }
+		/** @return The coarsest LOD, for software occlusion rendering */
+		const BMDModel* occluderMesh() const { return Lods.back()->MeshData.get(); }
+
+		/**
+		 * @brief Picks a LOD for the given screen size, only leaving currentLod once
+		 *        the size has moved past the threshold by more than LodHysteresis
+		 * @return LOD index, or -1 if the mesh is too small to draw
+		 */
+		int selectLod(float screenSize, int currentLod) const;
+
+	private:
+		void addLod(unique_ptr<BMDModel> model, const string& file = string());
+		void setupLodSizes();
+		void computeBounds();
 	};
 
 	////////////////////////////////////////////////////////////////////////////////
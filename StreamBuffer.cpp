@@ -0,0 +1,215 @@
+#include "StreamBuffer.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <stddef.h> // offsetof
+#include <string.h>
+#include <stdio.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	StreamBuffer::~StreamBuffer()
+	{
+		for (GLsync fence : fences)
+			if (fence) glDeleteSync(fence);
+		if (buffer)
+		{
+			if (persistentPtr || mapped) {
+				glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+				glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			}
+			glDeleteBuffers(1, &buffer);
+		}
+	}
+
+	bool StreamBuffer::create(size_t regionBytes, bool allowPersistent)
+	{
+		regionSize = regionBytes;
+		const GLsizeiptr total = regionBytes * NumRegions;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		if (allowPersistent && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage))
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_COPY_WRITE_BUFFER, total, nullptr, flags);
+			persistentPtr = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+			if (!persistentPtr) { // buffer storage is immutable, so start over with a plain buffer
+				fprintf(stderr, "StreamBuffer::create(): persistent mapping failed\n");
+				glDeleteBuffers(1, &buffer);
+				glGenBuffers(1, &buffer);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			}
+		}
+		if (!persistentPtr)
+			glBufferData(GL_COPY_WRITE_BUFFER, total, nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		printf("StreamBuffer: %d x %dKB, %s\n", (int)NumRegions, (int)(regionBytes / 1024),
+			persistentPtr ? "persistent mapped" : "unsynchronized glMapBufferRange (GL 3.3 fallback)");
+		return glGetError() == GL_NO_ERROR;
+	}
+
+	void StreamBuffer::beginFrame()
+	{
+		GLsync fence = fences[region];
+		if (!fence)
+			return;
+		PROFILE_SCOPE("StreamBuffer::wait");
+		GLenum result;
+		do result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1ms
+		while (result == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(fence);
+		fences[region] = nullptr;
+	}
+
+	void* StreamBuffer::allocate(size_t bytes, size_t alignment, GLintptr& outOffset)
+	{
+		size_t start = (used + alignment - 1) / alignment * alignment;
+		if (start + bytes > regionSize)
+			return nullptr;
+		used = start + bytes;
+		outOffset = (GLintptr)(region * regionSize + start);
+		if (persistentPtr)
+			return persistentPtr + outOffset;
+
+		// the fences already guarantee the GPU is done with this range
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		void* ptr = glMapBufferRange(GL_COPY_WRITE_BUFFER, outOffset, bytes,
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		mapped = ptr != nullptr;
+		return ptr;
+	}
+
+	void StreamBuffer::commit()
+	{
+		if (!mapped) return;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		mapped = false;
+	}
+
+	void StreamBuffer::endFrame()
+	{
+		commit();
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		region = (region + 1) % NumRegions;
+		used   = 0;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	AppendBuffer::~AppendBuffer()
+	{
+		if (buffer) glDeleteBuffers(1, &buffer);
+	}
+
+	void AppendBuffer::append(StreamBuffer& stream, const void* data, size_t bytes)
+	{
+		if (!bytes) return;
+		if (used + bytes > capacity)
+			grow(max(used + bytes, max(capacity * 2, (size_t)4096)));
+
+		GLintptr src;
+		void* dst = stream.allocate(bytes, 4, src);
+		if (!dst) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, used, bytes, data);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			used += bytes;
+			return;
+		}
+		memcpy(dst, data, bytes);
+		stream.commit();
+
+		glBindBuffer(GL_COPY_READ_BUFFER,  stream.buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, src, used, bytes);
+		glBindBuffer(GL_COPY_READ_BUFFER,  0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		used += bytes;
+	}
+
+	void AppendBuffer::grow(size_t minCapacity)
+	{
+		GLuint newBuffer;
+		glGenBuffers(1, &newBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, minCapacity, nullptr, GL_DYNAMIC_DRAW);
+		if (used) { // GPU side copy, nothing comes back to the CPU
+			glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		if (buffer) glDeleteBuffers(1, &buffer);
+		buffer   = newBuffer;
+		capacity = minCapacity;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	StreamRenderer2D::~StreamRenderer2D()
+	{
+		if (arrayObj) glDeleteVertexArrays(1, &arrayObj);
+	}
+
+	bool StreamRenderer2D::create()
+	{
+		glGenVertexArrays(1, &arrayObj);
+		glBindVertexArray(arrayObj);
+		glEnableVertexAttribArray(a_Position);
+		glEnableVertexAttribArray(a_Color);
+		glEnableVertexAttribArray(a_Coord);
+		glBindVertexArray(0);
+		return shader.loadShader("stream2d");
+	}
+
+	void StreamRenderer2D::draw(sf::RenderTarget& target, GLuint buffer, GLintptr offset, int count,
+	                            GLenum primitive, const sf::Transform& transform)
+	{
+		draw(shader, nullptr, target, buffer, offset, count, primitive, transform);
+	}
+
+	void StreamRenderer2D::draw(sf::RenderTarget& target, GLuint buffer, GLintptr offset, int count,
+	                            GLenum primitive, const sf::Transform& transform, Shader& customShader,
+	                            const sf::Texture& texture)
+	{
+		draw(customShader, &texture, target, buffer, offset, count, primitive, transform);
+	}
+
+	void StreamRenderer2D::draw(Shader& shader, const sf::Texture* texture, sf::RenderTarget& target, GLuint buffer,
+	                            GLintptr offset, int count, GLenum primitive, const sf::Transform& transform)
+	{
+		if (!count || !buffer)
+			return;
+
+		// same pixel space as SFML: origin top left, y down
+		sf::Vector2u size = target.getSize();
+		mat4 gui, proj;
+		memcpy(gui.m, transform.getMatrix(), sizeof(gui.m));
+		proj.ortho(0.0f, (float)size.x, (float)size.y, 0.0f).multiply(gui);
+
+		shader.bind();
+		shader.bind(u_Transform, proj);
+		if (texture)
+			shader.bind(u_DiffuseTex, *texture);
+		glBindVertexArray(arrayObj);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glVertexAttribPointer(a_Position, 2, GL_FLOAT, GL_FALSE, sizeof(sf::Vertex),
+			(void*)(offset + offsetof(sf::Vertex, position)));
+		glVertexAttribPointer(a_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(sf::Vertex),
+			(void*)(offset + offsetof(sf::Vertex, color)));
+		glVertexAttribPointer(a_Coord, 2, GL_FLOAT, GL_FALSE, sizeof(sf::Vertex),
+			(void*)(offset + offsetof(sf::Vertex, texCoords)));
+		glDrawArrays(primitive, 0, count);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+		shader.unbind();
+		++DrawStats.drawCalls;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "Shader.hpp"
+#include <SFML/Graphics.hpp>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Ring buffer for geometry that changes every frame: debug lines, GUI,
+	 * particles. It is split into NumRegions regions, one per frame in flight.
+	 * The CPU writes into one region while the GPU still reads the other two.
+	 * Each region is fenced when its frame ends, and it is only reused after
+	 * the GPU has passed that fence.
+	 *
+	 * With GL 4.4 or ARB_buffer_storage the whole buffer is mapped once,
+	 * persistently and coherently. On GL 3.3 each allocation is mapped
+	 * unsynchronized instead; the fences make that safe, so it doesn't stall.
+	 */
+	class StreamBuffer
+	{
+	public:
+		enum { NumRegions = 3 };
+		GLuint buffer = 0;
+
+	private:
+		size_t regionSize = 0;
+		int    region     = 0; // region written this frame
+		size_t used       = 0; // bytes allocated from it
+		char*  persistentPtr = nullptr;
+		bool   mapped = false; // non-persistent path: an allocation is mapped
+		GLsync fences[NumRegions] = {};
+
+	public:
+		StreamBuffer() {}
+		~StreamBuffer();
+		StreamBuffer(const StreamBuffer&) = delete;
+		StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+		/** @brief Creates the buffer with regionBytes per frame, allowPersistent=false forces the GL 3.3 path */
+		bool create(size_t regionBytes, bool allowPersistent = true);
+
+		bool isPersistent() const { return persistentPtr != nullptr; }
+		size_t capacity() const { return regionSize; }
+
+		/** @brief Waits until the GPU is done with the region this frame writes into */
+		void beginFrame();
+
+		/**
+		 * @brief Reserves bytes in this frame's region; call commit() once they are written
+		 * @param outOffset Byte offset of the allocation in buffer
+		 * @return Write pointer, or null if the region is full
+		 */
+		void* allocate(size_t bytes, size_t alignment, GLintptr& outOffset);
+
+		/** @brief Finishes the last allocate(), which unmaps it on the GL 3.3 path */
+		void commit();
+
+		/** @brief Fences this frame's region and moves on to the next one */
+		void endFrame();
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * A GPU buffer that only ever grows at the end, for long lived dynamic data
+	 * such as the mouse trail. New data goes through a StreamBuffer and is copied
+	 * into place on the GPU, so each append uploads only the new bytes.
+	 */
+	class AppendBuffer
+	{
+	public:
+		GLuint buffer = 0; // changes when the buffer grows
+
+	private:
+		size_t used     = 0;
+		size_t capacity = 0;
+
+	public:
+		AppendBuffer() {}
+		~AppendBuffer();
+		AppendBuffer(const AppendBuffer&) = delete;
+		AppendBuffer& operator=(const AppendBuffer&) = delete;
+
+		/** @brief Appends bytes through the stream, or with glBufferSubData if this frame's region is full */
+		void append(StreamBuffer& stream, const void* data, size_t bytes);
+
+		void clear() { used = 0; }
+		/** @brief Drops everything after the first bytes, the next append() overwrites it */
+		void truncate(size_t bytes) { used = min(used, bytes); }
+		size_t size() const { return used; }
+
+	private:
+		void grow(size_t minCapacity);
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * Draws sf::Vertex ranges straight from GL buffers, so that geometry stored
+	 * in a StreamBuffer or an AppendBuffer is not uploaded again through SFML's
+	 * client side arrays. It uses the stream2d shader and ignores texture coords.
+	 */
+	class StreamRenderer2D
+	{
+		GLuint arrayObj = 0;
+		Shader shader;
+
+	public:
+		StreamRenderer2D() {}
+		~StreamRenderer2D();
+
+		bool create();
+
+		/**
+		 * @brief Draws count vertices starting at byte offset in buffer
+		 * @param transform GUI transform, applied before the pixel -> NDC projection
+		 */
+		void draw(sf::RenderTarget& target, GLuint buffer, GLintptr offset, int count,
+		          GLenum primitive, const sf::Transform& transform);
+
+		/**
+		 * @brief Like draw(), but samples texture through a shader with the same
+		 *        inputs plus texCoords in texels, e.g. sdftext
+		 */
+		void draw(sf::RenderTarget& target, GLuint buffer, GLintptr offset, int count,
+		          GLenum primitive, const sf::Transform& transform, Shader& shader, const sf::Texture& texture);
+
+	private:
+		void draw(Shader& shader, const sf::Texture* texture, sf::RenderTarget& target, GLuint buffer,
+		          GLintptr offset, int count, GLenum primitive, const sf::Transform& transform);
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,161 @@
+#include "Texture2D.hpp"
+#include <algorithm>
+#include <stdio.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	static GLenum gl_internal_format(TextureFormat format)
+	{
+		switch (format) {
+			case TexBC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			case TexBC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			case TexBC7: return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+			default:     return GL_RGBA8;
+		}
+	}
+
+	Texture2D::~Texture2D()
+	{
+		if (tex) glDeleteTextures(1, &tex);
+	}
+
+	bool Texture2D::supported(TextureFormat format)
+	{
+		switch (format) {
+			case TexBC1:
+			case TexBC3: return GLEW_EXT_texture_compression_s3tc != 0;
+			case TexBC7: return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+			default:     return true;
+		}
+	}
+
+	GLenum Texture2D::internalFormat() const
+	{
+		return gl_internal_format(fmt);
+	}
+
+	bool Texture2D::create(const TextureFile& file, int firstLevel)
+	{
+		if (firstLevel < 0 || firstLevel >= (int)file.levels.size()) {
+			fprintf(stderr, "Texture2D::create(): no level %d\n", firstLevel);
+			return false;
+		}
+		if (!tex) glGenTextures(1, &tex);
+		glBindTexture(GL_TEXTURE_2D, tex);
+		w = file.levels[0].width;
+		h = file.levels[0].height;
+		numLevels = (int)file.levels.size();
+		base  = firstLevel;
+		streamed = firstLevel > 0;
+		fmt   = supported(file.format) ? file.format : TexRGBA8;
+		bytes = 0;
+
+		vector<sf::Uint8> decoded;
+		for (int i = firstLevel; i < numLevels; ++i)
+			upload(i, file.format, file.levels[i], decoded);
+		setSampling();
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return true;
+	}
+
+	bool Texture2D::uploadLevel(int level, TextureFormat format, const TextureLevel& data)
+	{
+		if (!tex || level != base - 1 || data.data.size() != texture_level_size(format, data.width, data.height)) {
+			fprintf(stderr, "Texture2D::uploadLevel(): level %d doesn't fit above base level %d\n", level, base);
+			return false;
+		}
+		vector<sf::Uint8> decoded;
+		glBindTexture(GL_TEXTURE_2D, tex);
+		upload(level, format, data, decoded);
+		base = level;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return true;
+	}
+
+	void Texture2D::dropLevels(int newBase)
+	{
+		newBase = min(newBase, numLevels - 1);
+		if (!tex || newBase <= base)
+			return;
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, newBase);
+		for (int i = base; i < newBase; ++i) {
+			// a 0x0 image frees the level; it's outside the sampled range so the texture stays complete
+			glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			bytes -= texture_level_size(fmt, max(w >> i, 1), max(h >> i, 1));
+		}
+		base = newBase;
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	bool Texture2D::create(const sf::Image& image, bool mipmaps, JobSystem* jobs)
+	{
+		sf::Vector2u size = image.getSize();
+		if (!size.x || !size.y) {
+			fprintf(stderr, "Texture2D::create(): empty image\n");
+			return false;
+		}
+		if (!tex) glGenTextures(1, &tex);
+		glBindTexture(GL_TEXTURE_2D, tex);
+		w = (int)size.x;
+		h = (int)size.y;
+		base  = 0;
+		streamed = false;
+		fmt   = TexRGBA8;
+		bytes = 0;
+		if (!mipmaps) {
+			numLevels = 1;
+			upload(0, TexRGBA8, w, h, image.getPixelsPtr());
+		}
+		else {
+			vector<TextureLevel> chain;
+			generate_mips(chain, image.getPixelsPtr(), w, h, MipKaiser, true, jobs);
+			numLevels = (int)chain.size();
+			for (int i = 0; i < numLevels; ++i)
+				upload(i, TexRGBA8, chain[i].width, chain[i].height, chain[i].data.data());
+		}
+		setSampling();
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return true;
+	}
+
+	void Texture2D::upload(int level, TextureFormat format, int width, int height, const sf::Uint8* data)
+	{
+		GLsizei size = (GLsizei)texture_level_size(format, width, height);
+		if (format == TexRGBA8) {
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		}
+		else {
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, gl_internal_format(format), width, height, 0, size, data);
+		}
+		bytes += size;
+	}
+
+	void Texture2D::upload(int level, TextureFormat format, const TextureLevel& data, vector<sf::Uint8>& decoded)
+	{
+		if (fmt == format) {
+			upload(level, fmt, data.width, data.height, data.data.data());
+			return;
+		}
+		decoded.resize(texture_level_size(TexRGBA8, data.width, data.height));
+		decompress_image(format, data.data.data(), data.width, data.height, decoded.data());
+		upload(level, TexRGBA8, data.width, data.height, decoded.data());
+	}
+
+	void Texture2D::setSampling()
+	{
+		// same edge handling as sf::Texture, so baked and plain textures look alike
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "Shader.hpp"
+#include "MipChain.hpp"
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * GL texture for 3D meshes. Unlike sf::Texture it can hold block compressed
+	 * formats and a prebuilt mip chain, uploaded level by level straight from a
+	 * baked TextureFile. If the GL can't sample a format, the levels are decoded
+	 * to RGBA8 on the CPU and uploaded uncompressed instead.
+	 *
+	 * Streamed textures only hold levels baseLevel() and coarser, finer levels
+	 * are added one at a time with uploadLevel() and released with dropLevels().
+	 */
+	class Texture2D
+	{
+		GLuint tex = 0;
+		int    w = 0, h = 0;
+		int    numLevels = 0;
+		int    base = 0;              // finest level in VRAM
+		bool   streamed = false;      // created without its finest levels, so they may still change
+		TextureFormat fmt = TexRGBA8; // format in VRAM
+		size_t bytes = 0;             // VRAM used by all resident levels
+
+	public:
+		Texture2D() {}
+		~Texture2D();
+		Texture2D(const Texture2D&) = delete;
+		Texture2D& operator=(const Texture2D&) = delete;
+
+		/**
+		 * @brief Uploads levels firstLevel and coarser of a baked texture, trilinear if it has mips.
+		 *        Finer levels may be empty in file and can be streamed in later with uploadLevel()
+		 */
+		bool create(const TextureFile& file, int firstLevel = 0);
+
+		/** @brief Adds level baseLevel() - 1 and starts sampling from it */
+		bool uploadLevel(int level, TextureFormat format, const TextureLevel& data);
+
+		/** @brief Samples from newBase onwards and releases the VRAM of every finer level */
+		void dropLevels(int newBase);
+
+		/**
+		 * @brief Uploads an RGBA8 image, with mipmaps also its sRGB correct mip chain
+		 *        from generate_mips(), filtered on jobs if set
+		 */
+		bool create(const sf::Image& image, bool mipmaps = true, JobSystem* jobs = nullptr);
+
+		/** @return true if the GL can sample format without a CPU decode */
+		static bool supported(TextureFormat format);
+
+		GLuint handle() const { return tex; }
+		int width()  const { return w; }
+		int height() const { return h; }
+		int levels() const { return numLevels; }
+		int baseLevel() const { return base; }
+		bool streaming() const { return streamed; }
+		/** @return GL internal format of the levels in VRAM */
+		GLenum internalFormat() const;
+		TextureFormat format() const { return fmt; }
+		size_t gpuBytes() const { return bytes; }
+
+	private:
+		void upload(int level, TextureFormat format, int width, int height, const sf::Uint8* data);
+		void upload(int level, TextureFormat format, const TextureLevel& data, vector<sf::Uint8>& decoded);
+		void setSampling();
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
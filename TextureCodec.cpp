@@ -0,0 +1,608 @@
+#include "TextureCodec.hpp"
+#include "MipChain.hpp"
+#include "JobSystem.hpp"
+#include <emmintrin.h> // SSE2
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	const char* texture_format_name(TextureFormat format)
+	{
+		switch (format) {
+			case TexRGBA8: return "RGBA8";
+			case TexBC1:   return "BC1";
+			case TexBC3:   return "BC3";
+			case TexBC7:   return "BC7";
+		}
+		return "?";
+	}
+
+	size_t texture_level_size(TextureFormat format, int width, int height)
+	{
+		if (format == TexRGBA8)
+			return (size_t)width * height * 4;
+		size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+		return blocks * (format == TexBC1 ? 8 : 16);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	// channel major, so four pixels of a channel load as one SSE register
+	struct BlockPixels
+	{
+		float c[4][16];
+	};
+
+	static void load_block(const sf::Uint8* rgba, BlockPixels& px)
+	{
+		for (int i = 0; i < 16; ++i)
+			for (int c = 0; c < 4; ++c)
+				px.c[c][i] = rgba[i * 4 + c];
+	}
+
+	static float clamp255(float v) { return v < 0.0f ? 0.0f : v > 255.0f ? 255.0f : v; }
+
+	/**
+	 * @brief Nearest palette entry of every pixel, measured over the first channels
+	 * @return Sum of the squared errors
+	 */
+	static float nearest_entries(const BlockPixels& px, const float (*palette)[4], int count, int channels, int* indices)
+	{
+		float total = 0.0f;
+		for (int g = 0; g < 16; g += 4)
+		{
+			__m128 p[4];
+			for (int c = 0; c < channels; ++c)
+				p[c] = _mm_loadu_ps(&px.c[c][g]);
+
+			__m128 best    = _mm_set1_ps(FLT_MAX);
+			__m128 bestIdx = _mm_setzero_ps();
+			for (int e = 0; e < count; ++e)
+			{
+				__m128 dist = _mm_setzero_ps();
+				for (int c = 0; c < channels; ++c) {
+					__m128 d = _mm_sub_ps(p[c], _mm_set1_ps(palette[e][c]));
+					dist = _mm_add_ps(dist, _mm_mul_ps(d, d));
+				}
+				__m128 closer = _mm_cmplt_ps(dist, best);
+				best    = _mm_min_ps(dist, best);
+				bestIdx = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)e)), _mm_andnot_ps(closer, bestIdx));
+			}
+			float err[4], idx[4];
+			_mm_storeu_ps(err, best);
+			_mm_storeu_ps(idx, bestIdx);
+			for (int i = 0; i < 4; ++i) {
+				indices[g + i] = (int)idx[i];
+				total += err[i];
+			}
+		}
+		return total;
+	}
+
+	/** @brief Endpoints at both ends of the block's principal axis, found by power iteration */
+	static void axis_endpoints(const BlockPixels& px, int channels, float* e0, float* e1)
+	{
+		float mean[4] = {}, cov[4][4] = {};
+		for (int c = 0; c < channels; ++c) {
+			for (int i = 0; i < 16; ++i) mean[c] += px.c[c][i];
+			mean[c] *= 1.0f / 16.0f;
+		}
+		for (int i = 0; i < 16; ++i)
+			for (int a = 0; a < channels; ++a)
+				for (int b = 0; b < channels; ++b)
+					cov[a][b] += (px.c[a][i] - mean[a]) * (px.c[b][i] - mean[b]);
+
+		// start from the row of the channel that varies most, it can't be orthogonal to the axis
+		int start = 0;
+		for (int c = 1; c < channels; ++c)
+			if (cov[c][c] > cov[start][start]) start = c;
+		float axis[4] = {};
+		for (int c = 0; c < channels; ++c) axis[c] = cov[start][c];
+		for (int iter = 0; iter < 8; ++iter)
+		{
+			float next[4] = {}, scale = 0.0f;
+			for (int a = 0; a < channels; ++a) {
+				for (int b = 0; b < channels; ++b) next[a] += cov[a][b] * axis[b];
+				scale = max(scale, fabsf(next[a]));
+			}
+			if (scale < 1e-6f) break;
+			for (int c = 0; c < channels; ++c) axis[c] = next[c] / scale;
+		}
+		float len = 0.0f;
+		for (int c = 0; c < channels; ++c) len += axis[c] * axis[c];
+		len = len > 1e-12f ? 1.0f / sqrtf(len) : 0.0f;
+
+		float tmin = 0.0f, tmax = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			float t = 0.0f;
+			for (int c = 0; c < channels; ++c) t += (px.c[c][i] - mean[c]) * axis[c] * len;
+			tmin = min(tmin, t), tmax = max(tmax, t);
+		}
+		for (int c = 0; c < channels; ++c) {
+			e0[c] = clamp255(mean[c] + axis[c] * len * tmin);
+			e1[c] = clamp255(mean[c] + axis[c] * len * tmax);
+		}
+	}
+
+	/** @brief Least squares endpoints for fixed per-pixel weights, pixel = e0 + (e1 - e0) * weight */
+	static void fit_endpoints(const BlockPixels& px, int channels, const float* weights, float* e0, float* e1)
+	{
+		float a = 0.0f, b = 0.0f, c = 0.0f, x0[4] = {}, x1[4] = {};
+		for (int i = 0; i < 16; ++i) {
+			float w = weights[i], u = 1.0f - w;
+			a += u * u, b += u * w, c += w * w;
+			for (int ch = 0; ch < channels; ++ch) {
+				x0[ch] += u * px.c[ch][i];
+				x1[ch] += w * px.c[ch][i];
+			}
+		}
+		float det = a * c - b * b;
+		if (fabsf(det) < 1e-6f) // every pixel uses the same weight
+			return;
+		for (int ch = 0; ch < channels; ++ch) {
+			e0[ch] = clamp255((c * x0[ch] - b * x1[ch]) / det);
+			e1[ch] = clamp255((a * x1[ch] - b * x0[ch]) / det);
+		}
+	}
+
+	// LSB first, like the BC7 spec numbers its bits
+	struct BlockBits
+	{
+		sf::Uint8* data;
+		int pos = 0;
+		explicit BlockBits(sf::Uint8* data) : data(data) {}
+		void write(unsigned value, int bits) {
+			for (int i = 0; i < bits; ++i, ++pos)
+				if (value >> i & 1) data[pos >> 3] |= (sf::Uint8)(1 << (pos & 7));
+		}
+		unsigned read(int bits) {
+			unsigned value = 0;
+			for (int i = 0; i < bits; ++i, ++pos)
+				value |= (unsigned)(data[pos >> 3] >> (pos & 7) & 1) << i;
+			return value;
+		}
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	static sf::Uint16 pack565(const float* c)
+	{
+		int r = min(31, max(0, (int)(c[0] * (31.0f / 255.0f) + 0.5f)));
+		int g = min(63, max(0, (int)(c[1] * (63.0f / 255.0f) + 0.5f)));
+		int b = min(31, max(0, (int)(c[2] * (31.0f / 255.0f) + 0.5f)));
+		return (sf::Uint16)(r << 11 | g << 5 | b);
+	}
+
+	static void unpack565(sf::Uint16 v, int* c)
+	{
+		int r = v >> 11 & 31, g = v >> 5 & 63, b = v & 31;
+		c[0] = r << 3 | r >> 2;
+		c[1] = g << 2 | g >> 4;
+		c[2] = b << 3 | b >> 2;
+		c[3] = 255;
+	}
+
+	// fourColor is c0 > c1 in BC1, and always in BC3
+	static void bc1_palette(sf::Uint16 c0, sf::Uint16 c1, bool fourColor, int (*pal)[4])
+	{
+		unpack565(c0, pal[0]);
+		unpack565(c1, pal[1]);
+		for (int c = 0; c < 4; ++c) {
+			if (fourColor) {
+				pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+				pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+			}
+			else {
+				pal[2][c] = (pal[0][c] + pal[1][c]) / 2;
+				pal[3][c] = 0; // transparent black
+			}
+		}
+	}
+
+	static void encode_color_block(const BlockPixels& px, sf::Uint8* out)
+	{
+		static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		float e0[4], e1[4];
+		axis_endpoints(px, 3, e0, e1);
+
+		float bestErr = FLT_MAX;
+		sf::Uint16 best0 = 0, best1 = 0;
+		int bestIdx[16] = {};
+		for (int iter = 0; iter < 3; ++iter)
+		{
+			sf::Uint16 c0 = pack565(e1), c1 = pack565(e0);
+			bool swapped = c0 < c1;
+			if (swapped) swap(c0, c1); // c0 > c1 selects the four color mode
+
+			int ipal[4][4];
+			float pal[4][4];
+			bc1_palette(c0, c1, true, ipal);
+			for (int i = 0; i < 4; ++i)
+				for (int c = 0; c < 4; ++c) pal[i][c] = (float)ipal[i][c];
+			int idx[16];
+			float err = nearest_entries(px, pal, c0 == c1 ? 1 : 4, 3, idx);
+			if (err < bestErr) {
+				bestErr = err, best0 = c0, best1 = c1;
+				memcpy(bestIdx, idx, sizeof(idx));
+			}
+			if (c0 == c1 || err == 0.0f)
+				break;
+
+			// refit the endpoints to the chosen indices, e1 maps to c0
+			float w[16];
+			for (int i = 0; i < 16; ++i) w[i] = 1.0f - weights[idx[i]];
+			if (swapped) for (int i = 0; i < 16; ++i) w[i] = 1.0f - w[i];
+			fit_endpoints(px, 3, w, e0, e1);
+		}
+
+		unsigned bits = 0;
+		for (int i = 0; i < 16; ++i)
+			bits |= (unsigned)bestIdx[i] << (i * 2);
+		out[0] = (sf::Uint8)best0, out[1] = (sf::Uint8)(best0 >> 8);
+		out[2] = (sf::Uint8)best1, out[3] = (sf::Uint8)(best1 >> 8);
+		out[4] = (sf::Uint8)bits,  out[5] = (sf::Uint8)(bits >> 8);
+		out[6] = (sf::Uint8)(bits >> 16), out[7] = (sf::Uint8)(bits >> 24);
+	}
+
+	static void alpha_palette(int a0, int a1, int* pal)
+	{
+		pal[0] = a0, pal[1] = a1;
+		if (a0 > a1) {
+			for (int i = 2; i < 8; ++i) pal[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+		}
+		else {
+			for (int i = 2; i < 6; ++i) pal[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+			pal[6] = 0, pal[7] = 255;
+		}
+	}
+
+	static void encode_alpha_block(const sf::Uint8* rgba, sf::Uint8* out)
+	{
+		int a0 = 0, a1 = 255;
+		for (int i = 0; i < 16; ++i)
+			a0 = max(a0, (int)rgba[i * 4 + 3]), a1 = min(a1, (int)rgba[i * 4 + 3]);
+		int pal[8];
+		alpha_palette(a0, a1, pal); // a0 > a1: eight interpolated values, or one if they're equal
+		unsigned long long bits = 0;
+		for (int i = 0; i < 16 && a0 > a1; ++i)
+		{
+			int a = rgba[i * 4 + 3], best = 0;
+			for (int e = 1; e < 8; ++e)
+				if (abs(pal[e] - a) < abs(pal[best] - a)) best = e;
+			bits |= (unsigned long long)best << (i * 3);
+		}
+		out[0] = (sf::Uint8)a0, out[1] = (sf::Uint8)a1;
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = (sf::Uint8)(bits >> (i * 8));
+	}
+
+	void encode_bc1_block(const sf::Uint8* rgba, sf::Uint8* out)
+	{
+		BlockPixels px;
+		load_block(rgba, px);
+		encode_color_block(px, out);
+	}
+
+	void encode_bc3_block(const sf::Uint8* rgba, sf::Uint8* out)
+	{
+		BlockPixels px;
+		load_block(rgba, px);
+		encode_alpha_block(rgba, out);
+		encode_color_block(px, out + 8);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	// BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a p-bit each, 4 bit indices
+	static const int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	static void bc7_quantize(const float* e, int* q, int& pbit)
+	{
+		float bestErr = FLT_MAX;
+		for (int p = 0; p < 2; ++p)
+		{
+			int t[4];
+			float err = 0.0f;
+			for (int c = 0; c < 4; ++c) {
+				t[c] = min(127, max(0, (int)floorf((e[c] - p) * 0.5f + 0.5f)));
+				float d = (float)(t[c] << 1 | p) - e[c];
+				err += d * d;
+			}
+			if (err < bestErr) {
+				bestErr = err, pbit = p;
+				memcpy(q, t, sizeof(t));
+			}
+		}
+	}
+
+	static void bc7_palette(const int* q0, int p0, const int* q1, int p1, int (*pal)[4])
+	{
+		for (int c = 0; c < 4; ++c) {
+			int a = q0[c] << 1 | p0, b = q1[c] << 1 | p1;
+			for (int i = 0; i < 16; ++i)
+				pal[i][c] = ((64 - Bc7Weights[i]) * a + Bc7Weights[i] * b + 32) >> 6;
+		}
+	}
+
+	void encode_bc7_block(const sf::Uint8* rgba, sf::Uint8* out)
+	{
+		BlockPixels px;
+		load_block(rgba, px);
+		float e0[4], e1[4];
+		axis_endpoints(px, 4, e0, e1);
+
+		float bestErr = FLT_MAX;
+		int best0[4] = {}, best1[4] = {}, bestP0 = 0, bestP1 = 0, bestIdx[16] = {};
+		for (int iter = 0; iter < 3; ++iter)
+		{
+			int q0[4], q1[4], p0, p1, ipal[16][4], idx[16];
+			bc7_quantize(e0, q0, p0);
+			bc7_quantize(e1, q1, p1);
+			bc7_palette(q0, p0, q1, p1, ipal);
+			float pal[16][4];
+			for (int i = 0; i < 16; ++i)
+				for (int c = 0; c < 4; ++c) pal[i][c] = (float)ipal[i][c];
+			float err = nearest_entries(px, pal, 16, 4, idx);
+			if (err < bestErr) {
+				bestErr = err, bestP0 = p0, bestP1 = p1;
+				memcpy(best0, q0, sizeof(q0));
+				memcpy(best1, q1, sizeof(q1));
+				memcpy(bestIdx, idx, sizeof(idx));
+			}
+			if (err == 0.0f)
+				break;
+			float w[16];
+			for (int i = 0; i < 16; ++i) w[i] = Bc7Weights[idx[i]] / 64.0f;
+			fit_endpoints(px, 4, w, e0, e1);
+		}
+
+		// the anchor index is stored without its top bit, so it must be < 8
+		if (bestIdx[0] >= 8) {
+			swap(best0, best1);
+			swap(bestP0, bestP1);
+			for (int i = 0; i < 16; ++i) bestIdx[i] = 15 - bestIdx[i];
+		}
+
+		memset(out, 0, 16);
+		BlockBits bits(out);
+		bits.write(1 << 6, 7); // mode 6
+		for (int c = 0; c < 4; ++c) {
+			bits.write(best0[c], 7);
+			bits.write(best1[c], 7);
+		}
+		bits.write(bestP0, 1);
+		bits.write(bestP1, 1);
+		bits.write(bestIdx[0], 3);
+		for (int i = 1; i < 16; ++i)
+			bits.write(bestIdx[i], 4);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	static void decode_color_block(const sf::Uint8* block, bool alwaysFourColor, sf::Uint8* rgba)
+	{
+		sf::Uint16 c0 = (sf::Uint16)(block[0] | block[1] << 8);
+		sf::Uint16 c1 = (sf::Uint16)(block[2] | block[3] << 8);
+		unsigned bits = block[4] | block[5] << 8 | block[6] << 16 | (unsigned)block[7] << 24;
+		int pal[4][4];
+		bc1_palette(c0, c1, alwaysFourColor || c0 > c1, pal);
+		for (int i = 0; i < 16; ++i)
+		{
+			const int* p = pal[bits >> (i * 2) & 3];
+			for (int c = 0; c < 4; ++c) rgba[i * 4 + c] = (sf::Uint8)p[c];
+		}
+	}
+
+	void decode_block(TextureFormat format, const sf::Uint8* block, sf::Uint8* rgba)
+	{
+		if (format == TexBC1) {
+			decode_color_block(block, false, rgba);
+		}
+		else if (format == TexBC3) {
+			decode_color_block(block + 8, true, rgba);
+			int pal[8];
+			alpha_palette(block[0], block[1], pal);
+			unsigned long long bits = 0;
+			for (int i = 0; i < 6; ++i)
+				bits |= (unsigned long long)block[2 + i] << (i * 8);
+			for (int i = 0; i < 16; ++i)
+				rgba[i * 4 + 3] = (sf::Uint8)pal[bits >> (i * 3) & 7];
+		}
+		else if (format == TexBC7) {
+			BlockBits bits((sf::Uint8*)block);
+			if (bits.read(7) != 1 << 6) { // only mode 6 is ever written
+				for (int i = 0; i < 16; ++i) {
+					rgba[i * 4 + 0] = 255, rgba[i * 4 + 1] = 0;
+					rgba[i * 4 + 2] = 255, rgba[i * 4 + 3] = 255;
+				}
+				return;
+			}
+			int q0[4], q1[4], pal[16][4];
+			for (int c = 0; c < 4; ++c) {
+				q0[c] = bits.read(7);
+				q1[c] = bits.read(7);
+			}
+			int p0 = bits.read(1), p1 = bits.read(1);
+			bc7_palette(q0, p0, q1, p1, pal);
+			for (int i = 0; i < 16; ++i)
+			{
+				const int* p = pal[bits.read(i == 0 ? 3 : 4)];
+				for (int c = 0; c < 4; ++c) rgba[i * 4 + c] = (sf::Uint8)p[c];
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	void compress_image(TextureFormat format, const sf::Uint8* rgba, int width, int height,
+	                    sf::Uint8* out, JobSystem* jobs)
+	{
+		if (format == TexRGBA8) {
+			memcpy(out, rgba, texture_level_size(format, width, height));
+			return;
+		}
+		const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		const int blockBytes = format == TexBC1 ? 8 : 16;
+		auto encodeRows = [&](int begin, int end) {
+			sf::Uint8 block[64];
+			for (int by = begin; by < end; ++by)
+			{
+				for (int bx = 0; bx < blocksX; ++bx)
+				{
+					for (int i = 0; i < 16; ++i) {
+						int x = min(bx * 4 + (i & 3), width - 1);
+						int y = min(by * 4 + (i >> 2), height - 1);
+						memcpy(&block[i * 4], &rgba[(y * width + x) * 4], 4);
+					}
+					sf::Uint8* dst = out + (by * blocksX + bx) * blockBytes;
+					switch (format) {
+						case TexBC1: encode_bc1_block(block, dst); break;
+						case TexBC3: encode_bc3_block(block, dst); break;
+						default:     encode_bc7_block(block, dst); break;
+					}
+				}
+			}
+		};
+		if (jobs) jobs->parallel_for(blocksY, 1, encodeRows);
+		else      encodeRows(0, blocksY);
+	}
+
+	void decompress_image(TextureFormat format, const sf::Uint8* data, int width, int height,
+	                      sf::Uint8* rgba, JobSystem* jobs)
+	{
+		if (format == TexRGBA8) {
+			memcpy(rgba, data, texture_level_size(format, width, height));
+			return;
+		}
+		const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		const int blockBytes = format == TexBC1 ? 8 : 16;
+		auto decodeRows = [&](int begin, int end) {
+			sf::Uint8 block[64];
+			for (int by = begin; by < end; ++by)
+			{
+				for (int bx = 0; bx < blocksX; ++bx)
+				{
+					decode_block(format, data + (by * blocksX + bx) * blockBytes, block);
+					for (int i = 0; i < 16; ++i) {
+						int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+						if (x < width && y < height)
+							memcpy(&rgba[(y * width + x) * 4], &block[i * 4], 4);
+					}
+				}
+			}
+		};
+		if (jobs) jobs->parallel_for(blocksY, 1, decodeRows);
+		else      decodeRows(0, blocksY);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	void TextureFile::build(const sf::Uint8* rgba, int width, int height, TextureFormat fmt, bool mipmaps,
+	                        JobSystem* jobs, MipFilter filter, bool srgb)
+	{
+		format = fmt;
+		if (mipmaps) {
+			generate_mips(levels, rgba, width, height, filter, srgb, jobs);
+		}
+		else {
+			levels.resize(1);
+			levels[0].width  = width;
+			levels[0].height = height;
+			levels[0].data.assign(rgba, rgba + width * height * 4);
+		}
+		if (format == TexRGBA8)
+			return;
+		vector<sf::Uint8> encoded;
+		for (TextureLevel& level : levels)
+		{
+			encoded.resize(texture_level_size(format, level.width, level.height));
+			compress_image(format, level.data.data(), level.width, level.height, encoded.data(), jobs);
+			level.data.swap(encoded);
+		}
+	}
+
+	size_t TextureFile::byteSize() const
+	{
+		size_t bytes = 0;
+		for (const TextureLevel& level : levels)
+			bytes += level.data.size();
+		return bytes;
+	}
+
+	string TextureFile::bakedFile(const string& imageFile)
+	{
+		return imageFile.substr(0, imageFile.rfind('.')) + ".itx";
+	}
+
+	static const char TextureMagic[4] = { 'I','T','X','1' };
+
+	bool TextureFile::loadFromFile(const string& file, int firstLevel, int lastLevel)
+	{
+		FILE* f = fopen(file.c_str(), "rb");
+		if (!f)
+			return false;
+		char magic[4];
+		int header[2]; // format, numLevels
+		bool ok = fread(magic, 4, 1, f) == 1 && memcmp(magic, TextureMagic, 4) == 0
+		       && fread(header, sizeof(header), 1, f) == 1
+		       && header[0] >= TexRGBA8 && header[0] <= TexBC7 && header[1] > 0 && header[1] <= 16;
+		if (ok) {
+			format = (TextureFormat)header[0];
+			levels.resize(header[1]);
+			if (lastLevel < 0) lastLevel = header[1] - 1;
+		}
+		for (size_t i = 0; ok && i < levels.size(); ++i)
+		{
+			TextureLevel& level = levels[i];
+			int size[2];
+			ok = fread(size, sizeof(size), 1, f) == 1 && size[0] > 0 && size[1] > 0 && size[0] <= 16384 && size[1] <= 16384;
+			if (!ok) break;
+			level.width  = size[0];
+			level.height = size[1];
+			size_t bytes = texture_level_size(format, level.width, level.height);
+			if ((int)i < firstLevel || (int)i > lastLevel) { // size only, skip the data
+				level.data.clear();
+				ok = fseek(f, (long)bytes, SEEK_CUR) == 0;
+				continue;
+			}
+			level.data.resize(bytes);
+			ok = fread(level.data.data(), level.data.size(), 1, f) == 1;
+		}
+		fclose(f);
+		if (!ok) {
+			fprintf(stderr, "TextureFile::loadFromFile(): invalid file %s\n", file.c_str());
+			levels.clear();
+		}
+		return ok;
+	}
+
+	bool TextureFile::saveToFile(const string& file) const
+	{
+		FILE* f = fopen(file.c_str(), "wb");
+		if (!f) {
+			fprintf(stderr, "TextureFile::saveToFile(): fopen failed %s\n", file.c_str());
+			return false;
+		}
+		int header[2] = { (int)format, (int)levels.size() };
+		bool ok = fwrite(TextureMagic, 4, 1, f) == 1
+		       && fwrite(header, sizeof(header), 1, f) == 1;
+		for (size_t i = 0; ok && i < levels.size(); ++i)
+		{
+			int size[2] = { levels[i].width, levels[i].height };
+			ok = fwrite(size, sizeof(size), 1, f) == 1
+			  && fwrite(levels[i].data.data(), levels[i].data.size(), 1, f) == 1;
+		}
+		fclose(f);
+		if (!ok) fprintf(stderr, "TextureFile::saveToFile(): fwrite failed %s\n", file.c_str());
+		return ok;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <SFML/Config.hpp>
+#include <vector>
+#include <string>
+
+namespace itc
+{
+	using namespace std;
+
+	class JobSystem;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/** @brief Pixel formats of baked textures */
+	enum TextureFormat
+	{
+		TexRGBA8, // uncompressed, 4 bytes per pixel
+		TexBC1,   // DXT1: opaque RGB, 8 bytes per 4x4 block
+		TexBC3,   // DXT5: BC1 color plus interpolated alpha, 16 bytes per 4x4 block
+		TexBC7,   // BPTC: RGBA, 16 bytes per 4x4 block; the encoder only writes mode 6
+	};
+
+	/** @brief Downsampling filter between mip levels, see generate_mips() */
+	enum MipFilter
+	{
+		MipBox,    // 2x2 average, fast but lets some aliasing through
+		MipKaiser, // 8 tap Kaiser windowed sinc, sharper and alias free, slight ringing
+	};
+
+	const char* texture_format_name(TextureFormat format);
+
+	/** @return Bytes of one width x height level, compressed formats round up to whole 4x4 blocks */
+	size_t texture_level_size(TextureFormat format, int width, int height);
+
+	/**
+	 * @brief Encodes one 4x4 block of RGBA8 pixels, rows top to bottom
+	 * @param out 8 bytes for BC1, 16 for BC3 and BC7
+	 */
+	void encode_bc1_block(const sf::Uint8* rgba, sf::Uint8* out);
+	void encode_bc3_block(const sf::Uint8* rgba, sf::Uint8* out);
+	void encode_bc7_block(const sf::Uint8* rgba, sf::Uint8* out);
+
+	/** @brief Decodes one block into 4x4 RGBA8 pixels; BC7 blocks in modes other than 6 decode as magenta */
+	void decode_block(TextureFormat format, const sf::Uint8* block, sf::Uint8* rgba);
+
+	/**
+	 * @brief Encodes a whole RGBA8 image, one row of blocks per job. Blocks that
+	 *        hang over the right or bottom edge repeat the last column or row.
+	 * @param out texture_level_size(format, width, height) bytes
+	 * @param jobs Null encodes on this thread only
+	 */
+	void compress_image(TextureFormat format, const sf::Uint8* rgba, int width, int height,
+	                    sf::Uint8* out, JobSystem* jobs = nullptr);
+
+	/** @brief Decodes a whole level back to RGBA8, for GLs without the format and for error reports */
+	void decompress_image(TextureFormat format, const sf::Uint8* data, int width, int height,
+	                      sf::Uint8* rgba, JobSystem* jobs = nullptr);
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	struct TextureLevel
+	{
+		int width, height;
+		vector<sf::Uint8> data; // texture_level_size() bytes
+	};
+
+	/**
+	 * Baked texture, stored as .itx: a small header followed by every mip level,
+	 * already in the GPU format so it can go to glCompressedTexImage2D as is.
+	 * TextureBakeTool writes these, see README.
+	 */
+	class TextureFile
+	{
+	public:
+		TextureFormat format = TexRGBA8;
+		vector<TextureLevel> levels; // levels[0] is the full size image
+
+		/**
+		 * @brief Encodes an RGBA8 image, and with mipmaps every level down to 1x1
+		 * @param srgb Mips are filtered in linear space, false for non-color data
+		 */
+		void build(const sf::Uint8* rgba, int width, int height, TextureFormat format, bool mipmaps = true,
+		           JobSystem* jobs = nullptr, MipFilter filter = MipKaiser, bool srgb = true);
+
+		/**
+		 * @brief Loads levels firstLevel ... lastLevel, the others only get their size
+		 *        so a streamer can read the header, the coarse tail or a single level
+		 * @param lastLevel -1 for the coarsest level
+		 * @return false if the file doesn't exist or isn't a valid .itx
+		 */
+		bool loadFromFile(const string& file, int firstLevel = 0, int lastLevel = -1);
+		bool saveToFile(const string& file) const;
+
+		/** @return Total bytes of all levels */
+		size_t byteSize() const;
+
+		/** @return {imageFile without extension}.itx */
+		static string bakedFile(const string& imageFile);
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,239 @@
+#include "TextureStreamer.hpp"
+#include "FrameTiming.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <stdio.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	TextureStreamer::TextureStreamer()
+	{
+		loader = thread(&TextureStreamer::loaderLoop, this);
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		{
+			lock_guard<mutex> lock(m);
+			running = false;
+		}
+		cv.notify_all();
+		loader.join();
+	}
+
+	shared_ptr<Texture2D> TextureStreamer::load(const string& itxFile)
+	{
+		TextureFile file;
+		if (!file.loadFromFile(itxFile, 16)) // level sizes only
+			return nullptr;
+
+		unique_ptr<Entry> e { new Entry() };
+		e->file   = itxFile;
+		e->format = file.format;
+		e->tail   = (int)file.levels.size() - 1;
+		while (e->tail > 0 && max(file.levels[e->tail - 1].width, file.levels[e->tail - 1].height) <= TailSize)
+			--e->tail;
+
+		if (!file.loadFromFile(itxFile, e->tail))
+			return nullptr;
+		e->texture = make_shared<Texture2D>();
+		if (!e->texture->create(file, e->tail))
+			return nullptr;
+
+		for (const TextureLevel& level : file.levels) // uncompressed if the GL can't sample the format
+			e->levelBytes.push_back(texture_level_size(e->texture->format(), level.width, level.height));
+		e->wanted     = e->texture->levels();
+		e->target     = e->tail;
+		e->resident   = e->tail;
+		e->loading    = false;
+		e->lastWanted = 0.0;
+		{
+			lock_guard<mutex> lock(m);
+			counters.residentBytes += e->texture->gpuBytes();
+		}
+		shared_ptr<Texture2D> texture = e->texture;
+		entries.push_back(move(e));
+		return texture;
+	}
+
+	void TextureStreamer::beginFrame()
+	{
+		for (unique_ptr<Entry>& e : entries)
+			e->wanted = e->texture->levels();
+	}
+
+	void TextureStreamer::request(const Texture2D* texture, int mip)
+	{
+		if (mip < 0)
+			return;
+		for (unique_ptr<Entry>& e : entries)
+			if (e->texture.get() == texture) {
+				e->wanted = min(e->wanted, mip);
+				return;
+			}
+	}
+
+	// VRAM of levels first and coarser
+	static size_t chain_bytes(const vector<size_t>& levelBytes, int first)
+	{
+		size_t bytes = 0;
+		for (int i = first; i < (int)levelBytes.size(); ++i)
+			bytes += levelBytes[i];
+		return bytes;
+	}
+
+	void TextureStreamer::update()
+	{
+		PROFILE_SCOPE("streamTextures");
+		{
+			lock_guard<mutex> lock(m);
+			for (const Finished& f : finished) {
+				if (f.base == f.entry->resident) // the level never made it, stop streaming this texture
+					f.entry->tail = f.entry->resident;
+				f.entry->resident = f.base;
+				f.entry->loading  = false;
+			}
+			finished.clear();
+		}
+
+		// everything wanted, then coarsen the biggest levels until it fits the budget
+		size_t targetBytes = 0, residentBytes = 0;
+		for (unique_ptr<Entry>& e : entries) {
+			e->target = min(e->wanted, e->tail);
+			targetBytes   += chain_bytes(e->levelBytes, e->target);
+			residentBytes += chain_bytes(e->levelBytes, e->resident);
+		}
+		while (targetBytes > Budget)
+		{
+			Entry* biggest = nullptr;
+			for (unique_ptr<Entry>& e : entries)
+				if (e->target < e->tail && (!biggest || e->levelBytes[e->target] > biggest->levelBytes[biggest->target]))
+					biggest = e.get();
+			if (!biggest) break; // the tails alone are over budget
+			targetBytes -= biggest->levelBytes[biggest->target++];
+		}
+
+		bool needRoom = false; // a wanted level doesn't fit next to what's resident
+		for (unique_ptr<Entry>& e : entries)
+			if (e->target < e->resident && !e->loading && residentBytes + e->levelBytes[e->resident - 1] > Budget)
+				needRoom = true;
+
+		double now = time_ms();
+		for (unique_ptr<Entry>& e : entries)
+		{
+			if (e->target <= e->resident)
+				e->lastWanted = now;
+			// drop after a while, or right away if a finer level elsewhere needs the room
+			if (e->target > e->resident && !e->loading && (now - e->lastWanted > DropDelayMs || needRoom))
+			{
+				residentBytes -= chain_bytes(e->levelBytes, e->resident) - chain_bytes(e->levelBytes, e->target);
+				lock_guard<mutex> lock(m);
+				Command drop;
+				drop.entry = e.get();
+				drop.level = e->target;
+				drop.drop  = true;
+				drop.requestTime = now;
+				uploads.push_back(move(drop));
+				e->resident = e->target;
+				++counters.drops;
+			}
+		}
+
+		// one level at a time per texture, finest last so the texture sharpens gradually
+		for (unique_ptr<Entry>& e : entries)
+		{
+			if (e->target >= e->resident || e->loading)
+				continue;
+			size_t bytes = e->levelBytes[e->resident - 1];
+			if (residentBytes + bytes > Budget)
+				continue; // wait for the drops above to land
+			residentBytes += bytes;
+			e->loading = true;
+			{
+				lock_guard<mutex> lock(m);
+				Command load;
+				load.entry = e.get();
+				load.level = e->resident - 1;
+				load.drop  = false;
+				load.requestTime = now;
+				loads.push_back(move(load));
+				++counters.pendingLoads;
+			}
+			cv.notify_one();
+		}
+	}
+
+	void TextureStreamer::uploadPending()
+	{
+		deque<Command> work;
+		{
+			lock_guard<mutex> lock(m);
+			if (uploads.empty())
+				return;
+			work.swap(uploads);
+		}
+		PROFILE_SCOPE("uploadTextures");
+		for (Command& cmd : work)
+		{
+			Texture2D& texture = *cmd.entry->texture;
+			size_t before = texture.gpuBytes();
+			bool uploaded = false;
+			if (cmd.drop) texture.dropLevels(cmd.level);
+			else          uploaded = texture.uploadLevel(cmd.level, cmd.entry->format, cmd.data);
+			double latency = time_ms() - cmd.requestTime;
+
+			lock_guard<mutex> lock(m);
+			counters.residentBytes += texture.gpuBytes();
+			counters.residentBytes -= before;
+			if (cmd.drop)
+				continue;
+			finished.push_back({ cmd.entry, texture.baseLevel() });
+			--counters.pendingLoads;
+			if (uploaded) {
+				++counters.loadsDone;
+				totalLatency += latency;
+				counters.maxLatencyMs = max(counters.maxLatencyMs, latency);
+			}
+		}
+	}
+
+	TextureStreamStats TextureStreamer::stats()
+	{
+		lock_guard<mutex> lock(m);
+		TextureStreamStats s = counters;
+		s.avgLatencyMs = s.loadsDone ? totalLatency / s.loadsDone : 0.0;
+		return s;
+	}
+
+	void TextureStreamer::loaderLoop()
+	{
+		Profiler::setThreadName("TextureLoader");
+		for (;;)
+		{
+			Command cmd;
+			{
+				unique_lock<mutex> lock(m);
+				cv.wait(lock, [this] { return !running || !loads.empty(); });
+				if (!running)
+					return;
+				cmd = move(loads.front());
+				loads.pop_front();
+			}
+			{
+				PROFILE_SCOPE("loadTextureLevel");
+				TextureFile file;
+				if (file.loadFromFile(cmd.entry->file, cmd.level, cmd.level))
+					cmd.data = move(file.levels[cmd.level]);
+				else
+					fprintf(stderr, "TextureStreamer::loaderLoop(): failed to read level %d of %s\n",
+						cmd.level, cmd.entry->file.c_str());
+			}
+			lock_guard<mutex> lock(m);
+			uploads.push_back(move(cmd));
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include "Texture2D.hpp"
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/** @brief Counters of a TextureStreamer, for the profiler overlay and benchmarks */
+	struct TextureStreamStats
+	{
+		size_t residentBytes = 0; // VRAM of every streamed texture
+		int    pendingLoads  = 0; // levels being read or waiting for upload
+		int    loadsDone     = 0; // levels uploaded since start
+		int    drops         = 0; // times fine levels were released
+		double avgLatencyMs  = 0.0; // load request -> level uploaded
+		double maxLatencyMs  = 0.0;
+	};
+
+	/**
+	 * Streams the mip levels of baked .itx textures as the camera needs them.
+	 * load() only uploads the coarse tail of each texture. Every frame the simulation
+	 * thread reports the finest mip each visible actor wants, update() fits those
+	 * into Budget and queues finer levels one at a time on a loader thread, and
+	 * the render thread uploads whatever has arrived in uploadPending(). Levels no
+	 * longer wanted for DropDelayMs are released again.
+	 */
+	class TextureStreamer
+	{
+	public:
+		size_t Budget      = 64 * 1024 * 1024; // VRAM for all streamed textures
+		int    TailSize    = 64;     // levels this size and smaller are always resident
+		double DropDelayMs = 1000.0; // fine levels outlive their last request by this long
+
+	private:
+		struct Entry
+		{
+			shared_ptr<Texture2D> texture;
+			string file;
+			TextureFormat format;      // in the file
+			vector<size_t> levelBytes; // VRAM of each level
+			int tail;            // finest level that is always resident, finer ones are streamed
+			int wanted;          // finest level requested this frame, levels() if none
+			int target;          // wanted, coarsened to fit the budget
+			int resident;        // finest level in VRAM as far as the simulation knows
+			bool loading;        // a level is on its way to the render thread
+			double lastWanted;   // when target was last at or finer than resident (ms)
+		};
+
+		struct Command
+		{
+			Entry* entry;
+			int    level;       // level to upload, or the new base level for a drop
+			bool   drop;
+			double requestTime; // ms
+			TextureLevel data;
+		};
+
+		struct Finished
+		{
+			Entry* entry;
+			int    base; // base level of the texture after the upload
+		};
+
+		vector<unique_ptr<Entry>> entries;
+
+		mutex m;
+		condition_variable cv;
+		deque<Command> loads;     // simulation -> loader thread
+		deque<Command> uploads;   // loader and simulation -> render thread, GL work
+		deque<Finished> finished; // render -> simulation thread, completed loads
+		bool running = true;
+		thread loader;
+
+		TextureStreamStats counters; // guarded by m
+		double totalLatency = 0.0;
+
+	public:
+		TextureStreamer();
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		/**
+		 * @brief Reads the header of a baked texture and uploads its levels up to TailSize.
+		 *        Needs the GL context, like any other texture creation.
+		 * @return Null if the file doesn't exist or isn't a valid .itx
+		 */
+		shared_ptr<Texture2D> load(const string& itxFile);
+
+		/** @brief Simulation thread: forgets the previous frame's requests */
+		void beginFrame();
+
+		/** @brief Simulation thread: an actor needs mip of texture; ignored for textures not from load() */
+		void request(const Texture2D* texture, int mip);
+
+		/** @brief Simulation thread: applies the budget and queues loads and drops */
+		void update();
+
+		/** @brief Render thread: uploads loaded levels and releases dropped ones */
+		void uploadPending();
+
+		TextureStreamStats stats();
+
+	private:
+		void loaderLoop();
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+}
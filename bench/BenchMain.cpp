@@ -0,0 +1,684 @@
+#include "Benchmark.hpp"
+#include "Actor.hpp"
+#include "Resource.h"
+#include "OcclusionBuffer.hpp"
+#include "MeshSimplify.hpp"
+#include "Meshlet.hpp"
+#include "JobSystem.hpp"
+#include "PathRecorder.hpp"
+#include "ShadowText.hpp"
+#include "TextureCodec.hpp"
+#include "MipChain.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+using namespace itc;
+
+////////////////////////////////////////////////////////////////////////////////
+// CPU hot path regression suite. Run from bin/ so the BMD assets and shaders resolve:
+//
+//   ITC2016Bench [-filter name] [-reps 30] [-out results.json]
+//                [-baseline baseline.json] [-threshold 0.10] [-nogl]
+//
+// Exits with 1 if any benchmark regressed against the baseline, if the baseline can't be
+// read or has no benchmark in common with this run, or if the SSE matrix
+// inverses or sincos are less accurate than expected against a double precision reference.
+//
+
+static void add_math_benchmarks(BenchRunner& bench)
+{
+	bench.add("mat4::multiply", [](long long n) {
+		mat4 a = IDENTITY, b;
+		mat4::from_rotation(b, vec3(1.0f, 2.0f, 3.0f)); // orthonormal, so a never blows up
+		for (long long i = 0; i < n; ++i) {
+			a.multiply(b);
+			do_not_optimize(a);
+		}
+	});
+
+	bench.add("mat4::from_rotation", [](long long n) {
+		mat4 m;
+		for (long long i = 0; i < n; ++i) {
+			float f = (float)(i & 1023);
+			mat4::from_rotation(m, vec3(f, f * 0.5f, f * 0.25f));
+			do_not_optimize(m);
+		}
+	});
+
+	bench.add("quat::from_euler", [](long long n) {
+		for (long long i = 0; i < n; ++i) {
+			float f = (float)(i & 1023);
+			quat q = quat::from_euler(vec3(f, f * 0.5f, f * 0.25f));
+			do_not_optimize(q);
+		}
+	});
+
+	// 4096 angles over a few turns either way
+	struct Angles
+	{
+		vector<float> angles, sines, cosines;
+		vector<vec3> eulers;
+		vector<quat> quats;
+		Angles() : angles(4096), sines(4096), cosines(4096), eulers(4096), quats(4096)
+		{
+			for (int i = 0; i < 4096; ++i) {
+				angles[i] = (i - 2048) * 0.01f;
+				eulers[i] = vec3((float)(i * 7 % 720 - 360), (float)(i * 13 % 360), i * 0.37f);
+			}
+		}
+	};
+	bench.add("sinf + cosf libm 4096", [](long long n) {
+		static Angles a;
+		for (long long i = 0; i < n; ++i) {
+			for (int j = 0; j < 4096; ++j) {
+				a.sines[j]   = sinf(a.angles[j]);
+				a.cosines[j] = cosf(a.angles[j]);
+			}
+			do_not_optimize(a.sines.data());
+		}
+	});
+	for (bool precise : { false, true })
+	{
+		bench.add(precise ? "sincos SSE precise 4096" : "sincos SSE 4096", [precise](long long n) {
+			static Angles a;
+			void (*trig)(const float*, float*, float*, int) = sincos;
+			if (precise) trig = sincos_precise;
+			for (long long i = 0; i < n; ++i) {
+				trig(a.angles.data(), a.sines.data(), a.cosines.data(), 4096);
+				do_not_optimize(a.sines.data());
+			}
+		});
+	}
+	bench.add("quat::from_euler 4096", [](long long n) {
+		static Angles a;
+		for (long long i = 0; i < n; ++i) {
+			for (int j = 0; j < 4096; ++j)
+				a.quats[j] = quat::from_euler(a.eulers[j]);
+			do_not_optimize(a.quats.data());
+		}
+	});
+	bench.add("quat::from_euler SSE batch 4096", [](long long n) {
+		static Angles a;
+		for (long long i = 0; i < n; ++i) {
+			quat::from_euler(a.quats.data(), a.eulers.data(), 4096);
+			do_not_optimize(a.quats.data());
+		}
+	});
+
+	bench.add("mat4::from_rotation quat", [](long long n) {
+		mat4 m;
+		quat q = quat::from_euler(vec3(1.0f, 2.0f, 3.0f));
+		for (long long i = 0; i < n; ++i) {
+			q.w = (float)(i & 1023); // only the conversion is measured, so q needn't stay unit length
+			mat4::from_rotation(m, q);
+			do_not_optimize(m);
+		}
+	});
+
+	// interpolating 4096 actor or bone rotations, as render interpolation and animation blending do
+	struct QuatPairs
+	{
+		vector<quat> a, b, out;
+		QuatPairs() : a(4096), b(4096), out(4096)
+		{
+			for (int i = 0; i < 4096; ++i) {
+				a[i] = quat::from_euler(vec3((float)(i * 7 % 360), (float)(i * 13 % 360), (float)(i % 360)));
+				b[i] = quat::from_euler(vec3((float)(i * 11 % 360), (float)(i * 3 % 360), (float)(i * 5 % 360)));
+			}
+		}
+	};
+	bench.add("slerp 4096", [](long long n) {
+		static QuatPairs q;
+		for (long long i = 0; i < n; ++i) {
+			float t = (i & 255) / 255.0f;
+			for (int j = 0; j < 4096; ++j)
+				q.out[j] = slerp(q.a[j], q.b[j], t);
+			do_not_optimize(q.out.data());
+		}
+	});
+	bench.add("nlerp 4096", [](long long n) {
+		static QuatPairs q;
+		for (long long i = 0; i < n; ++i) {
+			float t = (i & 255) / 255.0f;
+			for (int j = 0; j < 4096; ++j)
+				q.out[j] = nlerp(q.a[j], q.b[j], t);
+			do_not_optimize(q.out.data());
+		}
+	});
+	bench.add("nlerp SSE batch 4096", [](long long n) {
+		static QuatPairs q;
+		for (long long i = 0; i < n; ++i) {
+			nlerp(q.out.data(), q.a.data(), q.b.data(), (i & 255) / 255.0f, 4096);
+			do_not_optimize(q.out.data());
+		}
+	});
+	bench.add("slerp SSE batch 4096", [](long long n) {
+		static QuatPairs q;
+		for (long long i = 0; i < n; ++i) {
+			slerp(q.out.data(), q.a.data(), q.b.data(), (i & 255) / 255.0f, 4096);
+			do_not_optimize(q.out.data());
+		}
+	});
+
+	// a modelview and a viewProj, what lighting and picking would invert every frame
+	struct Inverses
+	{
+		mat4 modelView, viewProj;
+		Inverses()
+		{
+			mat4 view, rotation;
+			view.lookat(vec3(3.0f, 4.0f, 12.0f), vec3(0.0f, 2.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+			viewProj.perspective(60.0f, 1280.0f, 720.0f, 0.1f, 1000.0f);
+			viewProj.multiply(view);
+			mat4::from_position(modelView, vec3(1.0f, 2.0f, 3.0f));
+			modelView.scale(vec3(2.0f, 0.5f, 1.0f));
+			modelView.multiply(mat4::from_rotation(rotation, vec3(10.0f, 20.0f, 30.0f)));
+			view.multiply(modelView);
+			modelView = view;
+		}
+	};
+	bench.add("mat4::inverse", [](long long n) {
+		static Inverses m;
+		for (long long i = 0; i < n; ++i) {
+			m.viewProj.m30 = (float)(i & 255); // keeps the loop from being hoisted
+			mat4 inv = m.viewProj.inverse();
+			do_not_optimize(inv);
+		}
+	});
+	bench.add("mat4::affine_inverse", [](long long n) {
+		static Inverses m;
+		for (long long i = 0; i < n; ++i) {
+			m.modelView.m30 = (float)(i & 255);
+			mat4 inv = m.modelView.affine_inverse();
+			do_not_optimize(inv);
+		}
+	});
+	bench.add("mat4::normal_matrix", [](long long n) {
+		static Inverses m;
+		for (long long i = 0; i < n; ++i) {
+			m.modelView.m00 = 2.0f + (i & 255) * 0.001f;
+			mat4 normal = m.modelView.normal_matrix();
+			do_not_optimize(normal);
+		}
+	});
+
+	bench.add("Actor::affineTransform", [](long long n) {
+		Actor actor;
+		actor.Position = vec3(1.0f, 2.0f, 3.0f);
+		actor.Scale    = vec3(2.0f, 2.0f, 2.0f);
+		mat4 viewProj, out;
+		viewProj.perspective(60.0f, 1280.0f, 720.0f, 0.1f, 1000.0f);
+		quat rotations[256];
+		for (int i = 0; i < 256; ++i)
+			rotations[i] = quat::from_angle_axis((float)i, vec3(0.0f, 1.0f, 0.0f));
+		for (long long i = 0; i < n; ++i) {
+			actor.Rotation = rotations[i & 255];
+			actor.affineTransform(out, viewProj);
+			do_not_optimize(out);
+		}
+	});
+}
+
+// double precision Gauss-Jordan reference for the SSE inverses
+static bool inverse_reference(const mat4& m, double out[16])
+{
+	double a[4][8];
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			a[i][j] = m.m[i*4 + j], a[i][4 + j] = i == j ? 1.0 : 0.0;
+	for (int c = 0; c < 4; ++c)
+	{
+		int pivot = c;
+		for (int r = c + 1; r < 4; ++r)
+			if (fabs(a[r][c]) > fabs(a[pivot][c])) pivot = r;
+		if (a[pivot][c] == 0.0)
+			return false;
+		for (int j = 0; j < 8; ++j) swap(a[c][j], a[pivot][j]);
+		double inv = 1.0 / a[c][c];
+		for (int j = 0; j < 8; ++j) a[c][j] *= inv;
+		for (int r = 0; r < 4; ++r)
+			if (r != c) {
+				double f = a[r][c];
+				for (int j = 0; j < 8; ++j) a[r][j] -= f * a[c][j];
+			}
+	}
+	for (int i = 0; i < 16; ++i)
+		out[i] = a[i / 4][4 + i % 4];
+	return true;
+}
+
+// largest difference to the reference, relative to its largest element
+static double inverse_error(const float* m, const double* reference, bool transposed3x3 = false)
+{
+	double largest = 0.0, error = 0.0;
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j) {
+			if (transposed3x3 && (i == 3 || j == 3)) continue;
+			double ref = transposed3x3 ? reference[j*4 + i] : reference[i*4 + j];
+			largest = max(largest, fabs(ref));
+			error   = max(error, fabs(ref - m[i*4 + j]));
+		}
+	return error / largest;
+}
+
+// checks the SSE inverses against inverse_reference on random cameras and transforms
+static bool check_inverse_accuracy()
+{
+	double maxInverse = 0.0, maxAffine = 0.0, maxNormal = 0.0;
+	srand(1234);
+	auto random = [](float lo, float hi) { return lo + (hi - lo) * rand() / (float)RAND_MAX; };
+	for (int i = 0; i < 10000; ++i)
+	{
+		mat4 view, viewProj, model, rotation;
+		vec3 eye = { random(-50.0f, 50.0f), random(1.0f, 50.0f), random(-50.0f, 50.0f) };
+		view.lookat(eye, vec3(random(-5.0f, 5.0f), 0.0f, random(-5.0f, 5.0f)), vec3(0.0f, 1.0f, 0.0f));
+		viewProj.perspective(random(30.0f, 90.0f), 1280.0f, 720.0f, 0.1f, 1000.0f);
+		viewProj.multiply(view);
+		mat4::from_position(model, vec3(random(-100.0f, 100.0f), random(-100.0f, 100.0f), random(-100.0f, 100.0f)));
+		model.scale(vec3(random(0.1f, 10.0f), random(0.1f, 10.0f), random(0.1f, 10.0f)));
+		model.multiply(mat4::from_rotation(rotation, vec3(random(0, 360), random(0, 360), random(0, 360))));
+
+		double reference[16];
+		if (inverse_reference(viewProj, reference))
+			maxInverse = max(maxInverse, inverse_error(viewProj.inverse().m, reference));
+		if (inverse_reference(model, reference)) {
+			maxAffine = max(maxAffine, inverse_error(model.affine_inverse().m, reference));
+			maxNormal = max(maxNormal, inverse_error(model.normal_matrix().m, reference, true));
+		}
+	}
+	printf("inverse accuracy vs double: inverse %.2g, affine_inverse %.2g, normal_matrix %.2g\n",
+		maxInverse, maxAffine, maxNormal);
+	// a 0.1 to 1000 projection is badly conditioned, float Gauss-Jordan is off by 0.5% on these
+	bool ok = maxInverse < 1e-3 && maxAffine < 1e-5 && maxNormal < 1e-5;
+	if (!ok)
+		fprintf(stderr, "inverse accuracy check failed\n");
+	return ok;
+}
+
+// checks the polynomial sincos in both modes against double precision sin and cos
+static bool check_trig_accuracy()
+{
+	const int count = 1 << 20;
+	vector<float> angles(count), sines(count), cosines(count);
+	for (int i = 0; i < count; ++i)
+		angles[i] = -8192.0f + 16384.0f * (i + 0.5f) / count;
+
+	double maxError[2] = { 0.0, 0.0 };
+	for (int precise = 0; precise < 2; ++precise)
+	{
+		if (precise) sincos_precise(angles.data(), sines.data(), cosines.data(), count);
+		else         sincos(angles.data(), sines.data(), cosines.data(), count);
+		for (int i = 0; i < count; ++i) {
+			maxError[precise] = max(maxError[precise], fabs(sines[i]   - sin((double)angles[i])));
+			maxError[precise] = max(maxError[precise], fabs(cosines[i] - cos((double)angles[i])));
+		}
+	}
+	printf("sincos accuracy vs double for |angle| < 8192: fast %.2g, precise %.2g\n", maxError[0], maxError[1]);
+	bool ok = maxError[0] < 1.2e-6 && maxError[1] < 1e-7; // the bounds documented in types3d.hpp
+	if (!ok)
+		fprintf(stderr, "sincos accuracy check failed\n");
+	return ok;
+}
+
+// culls the meshlets of the shipped models one at a time from cameras all around them: every
+// meshlet the backface cone rejects must face away from the eye. A triangle faces the eye if its
+// face normal, flipped to the side of its vertex normals, does; the models' winding is inconsistent
+static bool check_meshlet_culling()
+{
+	Frustum everything; // accepts any sphere, so only the cone test rejects
+	for (vec4& p : everything.planes) p = vec4{ 0.0f, 0.0f, 0.0f, 1.0f };
+
+	bool ok = true;
+	for (const char* file : { "statue_mage.bmd", "starfury_lod1.bmd" })
+	{
+		unique_ptr<BMDModel> model = BMDModel::loadFromFile(file);
+		if (!model) return false;
+		const vertex3d* verts = model->vertices();
+		MeshletMesh mesh;
+		mesh.build(verts, model->num_verts, model->indices(), model->num_indices);
+
+		vec3 lo = verts[0].pos, hi = lo;
+		for (int i = 1; i < model->num_verts; ++i) {
+			const vec3& p = verts[i].pos;
+			lo = vec3(min(lo.x, p.x), min(lo.y, p.y), min(lo.z, p.z));
+			hi = vec3(max(hi.x, p.x), max(hi.y, p.y), max(hi.z, p.z));
+		}
+		vec3 center = (lo + hi) * 0.5f;
+		float distance = 2.0f * sqrtf((hi - lo).dot(hi - lo));
+
+		MeshletMesh one;
+		MeshletDrawList list;
+		int rejected = 0, facing = 0;
+		for (int cam = 0; cam < 16; ++cam)
+		{
+			float yaw = cam * 0.3927f, pitch = (cam % 4 - 1.5f) * 0.5f;
+			vec3 eye = center + vec3(cosf(yaw) * cosf(pitch), sinf(pitch), sinf(yaw) * cosf(pitch)) * distance;
+			for (const Meshlet& m : mesh.meshlets)
+			{
+				one.meshlets.assign(1, m);
+				list.clear();
+				if (one.cull(list, IDENTITY, 1.0f, everything, eye))
+					continue;
+				++rejected;
+				for (unsigned t = 0; t < m.triangleCount; ++t) {
+					const index_t* tri = &mesh.indices[m.firstIndex + t*3];
+					const vec3& p0 = verts[tri[0]].pos;
+					vec3 normal = (verts[tri[1]].pos - p0).cross(verts[tri[2]].pos - p0);
+					if (normal.dot(verts[tri[0]].norm + verts[tri[1]].norm + verts[tri[2]].norm) < 0.0f)
+						normal = normal * -1.0f;
+					if (normal.dot(eye - p0) > 0.0f) ++facing;
+				}
+			}
+		}
+		printf("meshlet backface culling %s: %d meshlets rejected over 16 views, %d triangles facing the eye\n",
+			file, rejected, facing);
+		ok = ok && facing == 0;
+	}
+	if (!ok)
+		fprintf(stderr, "meshlet culling check failed\n");
+	return ok;
+}
+
+static void add_asset_benchmarks(BenchRunner& bench)
+{
+	for (const char* file : { "statue_mage.bmd", "starfury_lod1.bmd" })
+	{
+		bench.add(string("BMDModel::loadFromFile ") + file, [file](long long n) {
+			for (long long i = 0; i < n; ++i) {
+				unique_ptr<BMDModel> model = BMDModel::loadFromFile(file);
+				do_not_optimize(model.get());
+			}
+		});
+	}
+}
+
+static void add_resource_benchmarks(BenchRunner& bench)
+{
+	bench.add("ResourceManager::getResource 1000", [](long long n) {
+		static ResourceManager<string> manager;
+		static vector<string> paths;
+		if (paths.empty()) {
+			char path[64];
+			for (int i = 0; i < 1000; ++i) {
+				snprintf(path, sizeof(path), "data/textures/resource_%04d.bmp", i);
+				paths.push_back(path);
+				manager.getResource(path); // populate
+			}
+		}
+		unsigned rng = 12345;
+		for (long long i = 0; i < n; ++i) {
+			rng = rng * 1664525u + 1013904223u;
+			auto& res = manager.getResource(paths[(rng >> 8) % paths.size()]);
+			do_not_optimize(res.ref);
+		}
+	});
+}
+
+// a long mouse drag: the recorder's cost per point must not grow with the path length
+static void add_gui_benchmarks(BenchRunner& bench)
+{
+	bench.add("PathRecorder::add + collect", [](long long n) {
+		static PathRecorder path;
+		static vector<sf::Vertex> verts;
+		for (long long i = 0; i < n; ++i) {
+			float t = (float)(i & 0xffff) * 0.05f;
+			path.add(sf::Vector2f(640.0f + cosf(t) * (200.0f + t), 360.0f + sinf(t * 1.3f) * 150.0f));
+			verts.clear();
+			int keep = path.collect(verts, sf::Color::White);
+			do_not_optimize(keep);
+		}
+	});
+}
+
+// block compression of the 1024x1024 statue texture, what TextureBakeTool spends per level 0
+static void add_texture_benchmarks(BenchRunner& bench, JobSystem& jobs)
+{
+	struct Source
+	{
+		sf::Image image;
+		vector<sf::Uint8> out;
+	};
+	static Source src;
+	if (!src.image.getSize().x && !src.image.loadFromFile("statue_mage.bmp"))
+		return;
+	src.out.resize(texture_level_size(TexRGBA8, src.image.getSize().x, src.image.getSize().y));
+
+	for (TextureFormat format : { TexBC1, TexBC7 })
+	{
+		bench.add(string("compress_image ") + texture_format_name(format) + " 1024x1024", [format, &jobs](long long n) {
+			for (long long i = 0; i < n; ++i)
+				compress_image(format, src.image.getPixelsPtr(), src.image.getSize().x, src.image.getSize().y,
+					src.out.data(), &jobs);
+		});
+	}
+	bench.add("compress_image BC1 1024x1024 1 thread", [](long long n) {
+		for (long long i = 0; i < n; ++i)
+			compress_image(TexBC1, src.image.getPixelsPtr(), src.image.getSize().x, src.image.getSize().y,
+				src.out.data());
+	});
+
+	for (MipFilter filter : { MipBox, MipKaiser })
+	{
+		bench.add(string("generate_mips ") + (filter == MipBox ? "box" : "Kaiser") + " sRGB 1024x1024", [filter, &jobs](long long n) {
+			vector<TextureLevel> levels;
+			for (long long i = 0; i < n; ++i)
+				generate_mips(levels, src.image.getPixelsPtr(), src.image.getSize().x, src.image.getSize().y,
+					filter, true, &jobs);
+		});
+	}
+}
+
+// a row of simplified statues in front of a 32x32 grid of statue sized boxes
+static void add_occlusion_benchmarks(BenchRunner& bench, JobSystem& jobs)
+{
+	struct Scene
+	{
+		unique_ptr<BMDModel> occluderMesh;
+		vector<Occluder> occluders;
+		vector<mat4> boxTransforms;
+		OcclusionBuffer buffer;
+	};
+	static Scene scene;
+	if (!scene.occluderMesh)
+	{
+		unique_ptr<BMDModel> model = BMDModel::loadFromFile("statue_mage.bmd");
+		if (!model) return;
+		SimplifiedMesh lod;
+		simplify_mesh(lod, model->vertices(), model->num_verts, model->indices(), model->num_indices,
+			model->num_indices / 8, &jobs);
+		scene.occluderMesh = BMDModel::create(model->name, model->tex_name, lod.vertices.data(),
+			(int)lod.vertices.size(), lod.indices.data(), (int)lod.indices.size());
+
+		mat4 viewProj, view;
+		view.lookat(vec3(0.0f, 5.0f, 18.0f), vec3(0.0f, 5.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+		viewProj.perspective(60.0f, 1280.0f, 720.0f, 0.1f, 1000.0f).multiply(view);
+		for (int i = 0; i < 8; ++i) {
+			Occluder o = { scene.occluderMesh.get(), viewProj };
+			mat4 model = IDENTITY;
+			model.m30 = (i - 3.5f) * 3.0f;
+			o.transform.multiply(model);
+			scene.occluders.push_back(o);
+		}
+		for (int i = 0; i < 32 * 32; ++i) {
+			mat4 model = IDENTITY, mvp = viewProj;
+			model.m30 = (i % 32 - 16) * 2.0f;
+			model.m32 = -(i / 32) * 2.0f - 4.0f;
+			scene.boxTransforms.push_back(mvp.multiply(model));
+		}
+	}
+
+	bench.add("OcclusionBuffer::render 8 occluders", [&jobs](long long n) {
+		for (long long i = 0; i < n; ++i)
+			scene.buffer.render(scene.occluders.data(), (int)scene.occluders.size(), &jobs);
+	});
+	bench.add("OcclusionBuffer::render 8 occluders 1 thread", [](long long n) {
+		for (long long i = 0; i < n; ++i)
+			scene.buffer.render(scene.occluders.data(), (int)scene.occluders.size());
+	});
+	bench.add("OcclusionBuffer::boxVisible 1024", [&jobs](long long n) {
+		scene.buffer.render(scene.occluders.data(), (int)scene.occluders.size(), &jobs);
+		vec3 boxMin(-1.0f, 0.0f, -1.0f), boxMax(1.0f, 10.0f, 1.0f);
+		for (long long i = 0; i < n; ++i) {
+			int visible = 0;
+			for (const mat4& transform : scene.boxTransforms)
+				visible += scene.buffer.boxVisible(boxMin, boxMax, transform);
+			do_not_optimize(visible);
+		}
+	});
+}
+
+// needs a GL context; each bind goes all the way to the driver
+static void add_shader_benchmarks(BenchRunner& bench, itc::Shader& shader, sf::Texture& texture)
+{
+	bench.add("Shader::bind mat4", [&shader](long long n) {
+		mat4 m = IDENTITY;
+		shader.bind();
+		for (long long i = 0; i < n; ++i) {
+			m.m30 = (float)(i & 255);
+			shader.bind(u_Transform, m);
+		}
+		shader.unbind();
+	});
+
+	bench.add("Shader::bind texture", [&shader, &texture](long long n) {
+		shader.bind();
+		for (long long i = 0; i < n; ++i)
+			shader.bind(u_DiffuseTex, texture);
+		shader.unbind();
+	});
+}
+
+// 256 rotating shadowed labels: sf::Text swapping fonts like the old drawText did,
+// against cached ShadowText meshes in one SpriteBatch
+static void add_text_benchmarks(BenchRunner& bench, sf::RenderTexture& target,
+                                const sf::Font& font, const sf::Font& shadowFont)
+{
+	const int labels = 256;
+	bench.add("sf::Text font swap 256 labels", [&, labels](long long n) {
+		static vector<sf::Text> texts;
+		for (int i = (int)texts.size(); i < labels; ++i)
+			texts.emplace_back("Label " + to_string(i), font, 24);
+		for (long long i = 0; i < n; ++i) {
+			for (int j = 0; j < labels; ++j) {
+				sf::Text& text = texts[j];
+				text.setRotation((float)((i + j) & 255));
+				text.setFont(shadowFont);
+				text.setColor(sf::Color(64, 64, 64, 168));
+				target.draw(text);
+				text.setFont(font);
+				text.setColor(sf::Color::Yellow);
+				target.draw(text);
+			}
+			glFinish();
+		}
+	});
+
+	bench.add("ShadowText cached 256 labels", [&, labels](long long n) {
+		static GlyphAtlas atlas;
+		static vector<ShadowText> texts;
+		static SpriteBatch batch;
+		if (texts.empty()) {
+			atlas.addFont(font, 24);
+			atlas.addFont(shadowFont, 24);
+			atlas.build();
+			for (int i = 0; i < labels; ++i) {
+				texts.emplace_back("Label " + to_string(i), font, shadowFont, 24);
+				texts.back().setColors(sf::Color::Yellow, sf::Color(64, 64, 64, 168));
+				texts.back().setAtlas(&atlas);
+			}
+		}
+		for (long long i = 0; i < n; ++i) {
+			for (int j = 0; j < labels; ++j) {
+				texts[j].setRotation((float)((i + j) & 255));
+				texts[j].draw(batch);
+			}
+			batch.flush(target);
+			glFinish();
+		}
+	});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	BenchRunner bench;
+	string out = "bench_results.json";
+	string baseline;
+	double threshold = 0.10;
+	bool   withGL    = true;
+	for (int i = 1; i < argc; ++i) {
+		if      (strcmp(argv[i], "-nogl") == 0) withGL = false;
+		else if (i + 1 < argc && strcmp(argv[i], "-filter") == 0)    bench.filter = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "-reps") == 0)      bench.reps = atoi(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "-out") == 0)       out = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "-baseline") == 0)  baseline = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "-threshold") == 0) threshold = atof(argv[++i]);
+	}
+	if (bench.reps < 2) { // the median, stddev and confidence interval need at least 2 samples
+		fprintf(stderr, "usage: ITC2016Bench [-filter name] [-reps N >= 2] [-out results.json]\n"
+		                "                    [-baseline baseline.json] [-threshold 0.10] [-nogl]\n");
+		return 1;
+	}
+
+	bool accurate = check_inverse_accuracy();
+	accurate = check_trig_accuracy() && accurate;
+	accurate = check_meshlet_culling() && accurate;
+
+	JobSystem jobs; // one scheduler for every group, this thread is its worker 0
+	add_math_benchmarks(bench);
+	add_asset_benchmarks(bench);
+	add_resource_benchmarks(bench);
+	add_occlusion_benchmarks(bench, jobs);
+	add_gui_benchmarks(bench);
+	add_texture_benchmarks(bench, jobs);
+
+	// GL objects must outlive bench.run(), so they live here. SFML opens a display
+	// as soon as any GL resource is constructed, so nothing is created with -nogl
+	unique_ptr<sf::Context> context;
+	unique_ptr<itc::Shader> shader;
+	unique_ptr<sf::Texture> texture;
+	unique_ptr<sf::RenderTexture> textTarget;
+	sf::Font font, shadowFont;
+	if (withGL)
+	{
+		context.reset(new sf::Context());
+		shader.reset(new itc::Shader());
+		texture.reset(new sf::Texture());
+		glewExperimental = true;
+		if (glewInit() == GLEW_OK && shader->loadShader("simple") && texture->loadFromFile("itc2016.png"))
+			add_shader_benchmarks(bench, *shader, *texture);
+		else
+			fprintf(stderr, "GL init failed, skipping shader benchmarks\n");
+
+		textTarget.reset(new sf::RenderTexture());
+		if (textTarget->create(1280, 720) && font.loadFromFile("neoretro.ttf")
+		                                  && shadowFont.loadFromFile("neoretro-shadow.ttf"))
+			add_text_benchmarks(bench, *textTarget, font, shadowFont);
+		else
+			fprintf(stderr, "RenderTexture or font init failed, skipping text benchmarks\n");
+	}
+
+	bench.run();
+	bench.writeJson(out);
+
+	if (!baseline.empty())
+	{
+		vector<BenchComparison> comparisons;
+		if (!bench.compare(baseline, threshold, comparisons)) {
+			fprintf(stderr, "baseline comparison failed: %s\n", baseline.c_str());
+			return 1;
+		}
+		int regressions = 0;
+		for (const BenchComparison& c : comparisons)
+			if (c.regressed) ++regressions;
+		if (regressions) {
+			printf("%d benchmark(s) regressed by more than %.0f%%\n", regressions, threshold * 100.0);
+			return 1;
+		}
+	}
+	return accurate ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
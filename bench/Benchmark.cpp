@@ -0,0 +1,163 @@
+#include "Benchmark.hpp"
+#include "FrameTiming.hpp"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace itc
+{
+	////////////////////////////////////////////////////////////////////////////////
+
+	// two-sided 95% critical value of Student's t distribution for n-1 degrees of freedom
+	static double t_critical95(int n)
+	{
+		static const double table[] = { 0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+		                                2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+		                                2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045 };
+		int df = n - 1;
+		if (df < 1)  return 0.0;
+		if (df < 30) return table[df];
+		return 1.96;
+	}
+
+	void BenchRunner::add(const string& name, BenchFunc func)
+	{
+		benches.push_back({ name, func });
+	}
+
+	const vector<BenchResult>& BenchRunner::run()
+	{
+		results.clear();
+		printf("%-40s %12s %12s %10s %10s\n", "benchmark", "mean ns/op", "median", "+-95%", "stddev");
+		for (Entry& b : benches)
+		{
+			if (!filter.empty() && b.name.find(filter) == string::npos)
+				continue;
+
+			// calibrate: double the iteration count until one rep takes long enough
+			long long iterations = 1;
+			for (;;) {
+				double t0 = time_ms();
+				b.func(iterations);
+				double elapsed = time_ms() - t0;
+				if (elapsed >= minRepMs || iterations >= (1LL << 40)) break;
+				iterations *= elapsed > minRepMs / 16 ? 2 : 8;
+			}
+
+			// warmup caches, branch predictors and CPU clocks
+			for (double start = time_ms(); time_ms() - start < warmupMs; )
+				b.func(iterations);
+
+			vector<double> samples;
+			for (int r = 0; r < reps; ++r) {
+				double t0 = time_ms();
+				b.func(iterations);
+				samples.push_back((time_ms() - t0) * 1e6 / iterations);
+			}
+
+			BenchResult res;
+			res.name       = b.name;
+			res.reps       = reps;
+			res.iterations = iterations;
+			double sum = 0.0;
+			for (double s : samples) sum += s;
+			res.mean = sum / samples.size();
+			double var = 0.0;
+			for (double s : samples) var += (s - res.mean) * (s - res.mean);
+			res.stddev = samples.size() > 1 ? sqrt(var / (samples.size() - 1)) : 0.0;
+			res.ci95   = t_critical95((int)samples.size()) * res.stddev / sqrt((double)samples.size());
+			sort(samples.begin(), samples.end());
+			res.median = samples[samples.size() / 2];
+			res.min    = samples.front();
+			results.push_back(res);
+
+			printf("%-40s %12.3f %12.3f %10.3f %10.3f\n", res.name.c_str(),
+				res.mean, res.median, res.ci95, res.stddev);
+		}
+		return results;
+	}
+
+	bool BenchRunner::writeJson(const string& file) const
+	{
+		FILE* f = fopen(file.c_str(), "wb");
+		if (!f) {
+			fprintf(stderr, "BenchRunner::writeJson(): fopen failed %s\n", file.c_str());
+			return false;
+		}
+		fprintf(f, "[\n");
+		for (size_t i = 0; i < results.size(); ++i) {
+			const BenchResult& r = results[i];
+			fprintf(f, "{\"name\": \"%s\", \"mean_ns\": %.4f, \"median_ns\": %.4f, \"ci95_ns\": %.4f, "
+			           "\"stddev_ns\": %.4f, \"min_ns\": %.4f, \"reps\": %d, \"iterations\": %lld}%s\n",
+				r.name.c_str(), r.mean, r.median, r.ci95, r.stddev, r.min, r.reps, r.iterations,
+				i + 1 < results.size() ? "," : "");
+		}
+		fprintf(f, "]\n");
+		fclose(f);
+		return true;
+	}
+
+	bool BenchRunner::compare(const string& baselineFile, double threshold, vector<BenchComparison>& out) const
+	{
+		out.clear();
+		FILE* f = fopen(baselineFile.c_str(), "rb");
+		if (!f) {
+			fprintf(stderr, "BenchRunner::compare(): fopen failed %s\n", baselineFile.c_str());
+			return false;
+		}
+
+		// writeJson() puts every benchmark on its own line, so a line scanner is enough
+		char line[512], name[256];
+		double mean, median, ci95;
+		vector<string> baselineOnly;
+		while (fgets(line, sizeof(line), f))
+		{
+			if (sscanf(line, " {\"name\": \"%255[^\"]\", \"mean_ns\": %lf, \"median_ns\": %lf, \"ci95_ns\": %lf",
+			           name, &mean, &median, &ci95) != 4)
+				continue;
+			bool found = false;
+			for (const BenchResult& r : results)
+			{
+				if (r.name != name) continue;
+				found = true;
+				BenchComparison c;
+				c.result       = &r;
+				c.baselineMean = mean;
+				c.baselineCi95 = ci95;
+				c.change       = mean > 0.0 ? (r.mean - mean) / mean : 0.0;
+				c.regressed    = mean > 0.0 && c.change > threshold && (r.mean - r.ci95) > (mean + ci95);
+				out.push_back(c);
+			}
+			if (!found)
+				baselineOnly.push_back(name);
+		}
+		fclose(f);
+
+		printf("\n%-40s %12s %12s %9s\n", "vs baseline", "base ns/op", "now ns/op", "change");
+		for (const BenchComparison& c : out) {
+			if (c.baselineMean > 0.0)
+				printf("%-40s %12.3f %12.3f %+8.1f%% %s\n", c.result->name.c_str(),
+					c.baselineMean, c.result->mean, c.change * 100.0, c.regressed ? "REGRESSION" : "");
+			else
+				printf("%-40s %12.3f %12.3f %9s\n", c.result->name.c_str(), c.baselineMean, c.result->mean, "n/a");
+		}
+		for (const BenchResult& r : results) {
+			bool compared = false;
+			for (const BenchComparison& c : out)
+				if (c.result == &r) compared = true;
+			if (!compared)
+				printf("%-40s not in baseline\n", r.name.c_str());
+		}
+		for (const string& n : baselineOnly)
+			printf("%-40s only in baseline, not run\n", n.c_str());
+
+		if (out.empty()) {
+			fprintf(stderr, "BenchRunner::compare(): no benchmark of %s matches the results\n", baselineFile.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace itc
+{
+	using namespace std;
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	/** @brief Timing statistics of one benchmark, all times are nanoseconds per operation */
+	struct BenchResult
+	{
+		string name;
+		int    reps;   // number of timed repetitions
+		long long iterations; // operations per repetition
+		double mean;
+		double median;
+		double stddev;
+		double ci95;   // half-width of the 95% confidence interval of the mean
+		double min;
+	};
+
+	/** @brief Outcome of comparing a result against a stored baseline */
+	struct BenchComparison
+	{
+		const BenchResult* result;
+		double baselineMean;
+		double baselineCi95;
+		double change;  // relative change of the mean, +0.1 is 10% slower; 0 and printed as n/a if the baseline mean is 0
+		bool regressed; // slower than threshold and confidence intervals don't overlap
+	};
+
+	/**
+	 * Minimal statistically robust micro-benchmark runner:
+	 *  - each benchmark is calibrated so one repetition runs ~minRepMs
+	 *  - a warmup phase runs before any timing is recorded
+	 *  - reps repetitions are timed; mean, median, stddev and a 95% CI are reported
+	 *
+	 * A benchmark body receives the number of operations to run and must run exactly that many.
+	 */
+	class BenchRunner
+	{
+	public:
+		typedef function<void(long long iterations)> BenchFunc;
+
+		int    reps     = 30;   // timed repetitions per benchmark
+		double warmupMs = 50.0; // untimed warmup per benchmark
+		double minRepMs = 10.0; // calibrated duration of one repetition
+		string filter;          // only run benchmarks whose name contains this
+
+	private:
+		struct Entry { string name; BenchFunc func; };
+		vector<Entry> benches;
+		vector<BenchResult> results;
+
+	public:
+		void add(const string& name, BenchFunc func);
+
+		/** @brief Runs all registered benchmarks and prints a table */
+		const vector<BenchResult>& run();
+
+		/** @brief Writes results as JSON, one benchmark per line */
+		bool writeJson(const string& file) const;
+
+		/**
+		 * @brief Compares results with a baseline written by writeJson(), and lists the
+		 *        benchmarks that are only in one of the two
+		 * @param threshold Relative slowdown that counts as a regression, eg 0.10 for 10%
+		 * @return false if the baseline can't be read or shares no benchmark with the results
+		 */
+		bool compare(const string& baselineFile, double threshold, vector<BenchComparison>& out) const;
+	};
+
+	/** @brief Prevents the optimizer from discarding a computed value */
+	template<class T> inline void do_not_optimize(const T& value)
+	{
+		#if defined(_MSC_VER)
+			static const void* volatile sink; sink = &value;
+		#else
+			asm volatile("" : : "r,m"(value) : "memory");
+		#endif
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,98 @@
+#include "JobSystem.hpp"
+#include "FrameTiming.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+using namespace itc;
+
+////////////////////////////////////////////////////////////////////////////////
+// JobSystem stress benchmark and 1..N core scaling report
+//
+//   JobSystemBench [maxThreads] [iterations]
+//
+
+// some ALU bound work that can't be optimized away
+static float busy_work(int seed, int amount)
+{
+	float x = (float)seed;
+	for (int i = 0; i < amount; ++i)
+		x = sinf(x) * 0.5f + cosf(x * 0.25f);
+	return x;
+}
+
+struct BenchResult { double parallelFor, tinyJobs, dependencyChain; };
+static float sink[65536]; // results are summed at exit so the work isn't optimized away
+
+static BenchResult run_bench(int numThreads, int iterations)
+{
+	JobSystem jobs { numThreads };
+	BenchResult r = { 0, 0, 0 };
+
+	// 1) parallel_for over a big array of medium sized work items
+	double t0 = time_ms();
+	for (int it = 0; it < iterations; ++it) {
+		jobs.parallel_for(65536, 64, [&](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+				sink[i] = busy_work(i, 16);
+		});
+	}
+	r.parallelFor = (time_ms() - t0) / iterations;
+
+	// 2) stress: flood the scheduler with tiny jobs to measure overhead and stealing
+	t0 = time_ms();
+	for (int it = 0; it < iterations; ++it) {
+		JobCounter counter;
+		for (int i = 0; i < 4000; ++i) {
+			jobs.run([](void*, int begin, int) { sink[begin & 65535] = busy_work(begin, 2); },
+			         nullptr, &counter, nullptr, i, i + 1);
+		}
+		jobs.wait(counter);
+	}
+	r.tinyJobs = (time_ms() - t0) / iterations;
+
+	// 3) dependency counters: 8 stages, each stage fans out 64 jobs that depend on the previous stage
+	t0 = time_ms();
+	for (int it = 0; it < iterations; ++it) {
+		JobCounter stages[8];
+		for (int s = 0; s < 8; ++s) {
+			for (int i = 0; i < 64; ++i) {
+				jobs.run([](void*, int begin, int) { sink[begin & 65535] = busy_work(begin, 256); },
+				         nullptr, &stages[s], s ? &stages[s - 1] : nullptr, s * 64 + i, 0);
+			}
+		}
+		jobs.wait(stages[7]);
+		for (JobCounter& c : stages) jobs.wait(c);
+	}
+	r.dependencyChain = (time_ms() - t0) / iterations;
+	return r;
+}
+
+int main(int argc, char** argv)
+{
+	int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+	int iterations = argc > 2 ? atoi(argv[2]) : 20;
+	if (maxThreads <= 0) maxThreads = 1;
+	if (iterations <= 0) iterations = 1;
+
+	printf("JobSystem scaling report (%d iterations per test, times in ms)\n", iterations);
+	printf("threads | parallel_for   speedup | 4000 tiny jobs  speedup | dep chain   speedup\n");
+	printf("--------+------------------------+-------------------------+--------------------\n");
+
+	BenchResult base = {};
+	for (int n = 1; n <= maxThreads; ++n)
+	{
+		BenchResult r = run_bench(n, iterations);
+		if (n == 1) base = r;
+		printf("%7d | %10.3f   %7.2fx | %11.3f   %7.2fx | %8.3f   %7.2fx\n", n,
+			r.parallelFor,     base.parallelFor     / r.parallelFor,
+			r.tinyJobs,        base.tinyJobs        / r.tinyJobs,
+			r.dependencyChain, base.dependencyChain / r.dependencyChain);
+	}
+
+	double checksum = 0.0;
+	for (float f : sink) checksum += f;
+	printf("checksum %g\n", checksum);
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
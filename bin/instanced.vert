@@ -0,0 +1,18 @@
+#version 330 // OpenGL 3.3
+
+in mat4 instTransform; // per-instance model-view-projection matrix
+in int  instLayer;     // per-instance texture array layer, see instancedarray.frag
+
+in vec3 position;    // in vertex position
+in vec2 coord;       // in vertex texture coordinates
+in vec3 normal;      // in vertex normal
+
+out vec2 vCoord;     // out vertex texture coord for frag
+flat out int vLayer; // texture array layer for frag
+
+void main(void)
+{
+	gl_Position = instTransform * vec4(position, 1.0);
+	vCoord = coord;
+	vLayer = instLayer;
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 330 // OpenGL 3.3
+
+uniform sampler2DArray diffuseTex; // same sized diffuse textures, one per layer
+in vec2 vCoord;                    // vertex texture coords
+flat in int vLayer;                // layer of this instance
+
+out vec4 fragColor; // output pixel color
+
+void main(void)
+{
+	fragColor = texture(diffuseTex, vec3(vCoord, vLayer));
+}
\ No newline at end of file
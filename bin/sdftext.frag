@@ -0,0 +1,17 @@
+#version 330 // OpenGL 3.3
+
+uniform sampler2D diffuseTex; // signed distance field in alpha, 0.5 on the outline
+
+in vec2 vCoord;     // texture coordinate
+in vec4 vColor;     // vertex color
+
+out vec4 fragColor; // output pixel color
+
+void main(void)
+{
+	float dist = texture(diffuseTex, vCoord).a;
+	// the field changes by fwidth per screen pixel, so this antialiases over about one pixel at any size
+	float edge  = max(fwidth(dist) * 0.7, 0.001);
+	float alpha = smoothstep(0.5 - edge, 0.5 + edge, dist);
+	fragColor = vec4(vColor.rgb, vColor.a * alpha);
+}
\ No newline at end of file
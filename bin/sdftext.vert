@@ -0,0 +1,18 @@
+#version 330 // OpenGL 3.3
+
+uniform mat4 transform;      // GUI transform and pixel -> NDC projection
+uniform sampler2D diffuseTex; // SdfFont atlas
+
+in vec2 position;    // in vertex position, in pixels
+in vec2 coord;       // in texture coordinate, in atlas texels
+in vec4 color;       // in vertex color
+
+out vec2 vCoord;     // out normalized texture coordinate for frag
+out vec4 vColor;     // out vertex color for frag
+
+void main(void)
+{
+	gl_Position = transform * vec4(position, 0.0, 1.0);
+	vCoord = coord / vec2(textureSize(diffuseTex, 0));
+	vColor = color;
+}
\ No newline at end of file
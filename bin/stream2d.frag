@@ -0,0 +1,10 @@
+#version 330 // OpenGL 3.3
+
+in vec4 vColor;     // vertex color
+
+out vec4 fragColor; // output pixel color
+
+void main(void)
+{
+	fragColor = vColor;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 330 // OpenGL 3.3
+
+uniform mat4 transform; // GUI transform and pixel -> NDC projection
+
+in vec2 position;    // in vertex position, in pixels
+in vec4 color;       // in vertex color
+
+out vec4 vColor;     // out vertex color for frag
+
+void main(void)
+{
+	gl_Position = transform * vec4(position, 0.0, 1.0);
+	vColor = color;
+}
\ No newline at end of file
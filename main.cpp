@@ -1,6 +1,19 @@
 #include <SFML/Graphics.hpp>
+#include <string.h>
+#include <stdlib.h>
 #include "Util.hpp"
 #include "Actor.hpp"
+#include "JobSystem.hpp"
+#include "RenderThread.hpp"
+#include "FrameTiming.hpp"
+#include "Profiler.hpp"
+#include "RenderQueue.hpp"
+#include "OcclusionBuffer.hpp"
+#include "StreamBuffer.hpp"
+#include "PathRecorder.hpp"
+#include "ShadowText.hpp"
+#include "SdfFont.hpp"
+#include "TextureStreamer.hpp"
 using namespace itc;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -8,125 +21,715 @@ using namespace itc;
 struct ITC2016 : public RenderWindow
 {
 	//////// Resources /////////
-	Texture itcTexture;
 	Font    neoretro;
 	Font    neoretroShadow;
 	Font    dejavusans;
+	SdfFont sdfSans; // dejavusans for text drawn at any size
 
 	itc::Shader simple3d;
+	itc::Shader instanced3d; // RenderQueue draws, transform per instance
+	itc::Shader instancedArray3d; // RenderQueue draws from texture arrays, layer per instance
+	itc::Shader sdfShader;   // SdfFont glyphs
+	shared_ptr<StaticMesh>  statueMesh;
+	shared_ptr<Texture2D>   statueTexture;
+
+	JobSystem jobs; // one worker per core
+	TextureStreamer textureStreamer; // fine mips of baked textures, as actors come close
+	RenderQueue renderQueue;
+	bool allowIndirect = true; // false forces the GL 3.3 instanced path
+	bool allowArrays   = true; // false binds every actor texture on its own
 
 	////////// Scene ///////////
 	Sprite  itcSprite;
-	Text    mccTitle;
-	vector<Vertex> path;
+	itc::ShadowText mccTitle; // only touched by the render thread after setup
+	Transformable mccTitleXform; // simulated title position/rotation
+	float   mccTitlePrevRotation = 0.0f;
+	itc::SdfText subtitle; // only touched by the render thread after setup
+	FloatRect subtitleBounds;  // in em
+	float   subtitlePhase = 0.0f, subtitlePrevPhase = 0.0f; // size pulse, radians
+	PathRecorder path;     // mouse trail, bounded and simplified
 
 	Actor statueMage;
+	vector<Actor>  crowd;  // extra actors for benchmarking
+	vector<shared_ptr<Texture2D>> crowdTextures; // tinted statue textures the crowd cycles through
+	vector<Actor*> actors;
+	Vector2u screenSize;
+	mat4 viewProj;
+	LodView lodView;
+	OcclusionBuffer  occlusion;
+	vector<Occluder> occluders;
+
+	bool   showProfiler = false;
+	Text   profilerText;  // render thread only
+	double profilerLastUpdate = 0.0;
+	int    profilerFrames = 0;
+	bool   showOcclusion = false;
+	Texture occlusionTexture; // render thread only
+	Sprite  occlusionSprite;
 
+	StreamBuffer     guiStream;  // per-frame 2D geometry, render thread only
+	AppendBuffer     trailBuffer; // GPU copy of path
+	StreamRenderer2D renderer2d;
+	GlyphAtlas  guiAtlas; // itc2016.png, the title, its shadow and the profiler font
+	int         itcLogo = -1; // itc2016.png in guiAtlas
+	SpriteBatch guiBatch; // render thread only
 
-	ITC2016(ContextSettings& settings) 
-		: RenderWindow(VideoMode(1280, 720), "ITC2016", Style::Close, settings)
+
+	ITC2016(ContextSettings& settings, bool headless = false)
 	{
+		if (!headless) // headless mode renders into a RenderTexture instead
+			create(VideoMode(1280, 720), "ITC2016", Style::Close, settings);
 	}
 
 	void loadResources()
 	{
-		loadTexture(itcTexture, "itc2016.png");
-		neoretro.loadFromFile("neoretro.ttf");
-		neoretroShadow.loadFromFile("neoretro-shadow.ttf");
-		dejavusans.loadFromFile("dejavusans.ttf");
+		PROFILE_SCOPE("loadResources");
+		// statue_mage.itx from TextureBakeTool, if it was baked: coarse mips now, the rest on demand
+		statueTexture = textureStreamer.load("statue_mage.itx");
+
+		// decode images and fonts on all cores; GL uploads stay on this thread
+		Image itcImage, statueImage;
+		jobs.parallel_for(5, 1, [&](int begin, int end) {
+			for (int i = begin; i < end; ++i) switch (i) {
+				case 0: itcImage.loadFromFile("itc2016.png");             break;
+				case 1: neoretro.loadFromFile("neoretro.ttf");              break;
+				case 2: neoretroShadow.loadFromFile("neoretro-shadow.ttf"); break;
+				case 3: dejavusans.loadFromFile("dejavusans.ttf");          break;
+				case 4: if (!statueTexture) statueImage.loadFromFile("statue_mage.bmp"); break;
+			}
+		});
+		itcLogo = guiAtlas.addImage(itcImage); // packed with the GUI glyphs in setupScene
+		sdfSans.loadFromFile("dejavusans.ttf", &jobs); // from dejavusans.sdf after the first run
+
+		if (!statueTexture) {
+			statueTexture = make_shared<Texture2D>();
+			statueTexture->create(statueImage, true, &jobs);
+		}
+		printf("statue_mage: %s %dx%d, %d levels, %d resident, %d KB\n", texture_format_name(statueTexture->format()),
+			statueTexture->width(), statueTexture->height(), statueTexture->levels(),
+			statueTexture->levels() - statueTexture->baseLevel(), (int)(statueTexture->gpuBytes() / 1024));
+		statueMesh = make_shared<StaticMesh>("statue_mage.bmd");
+		statueMesh->generateLods(&jobs); // unless LOD files were authored
+		simple3d.loadShader("simple");
+		instanced3d.loadShader("instanced", "simple");
+		instancedArray3d.loadShader("instanced", "instancedarray");
+		sdfShader.loadShader("sdftext");
+		renderQueue.init(allowIndirect, allowArrays);
+		guiStream.create(256 * 1024);
+		renderer2d.create();
 	}
 
-	void setupScene()
+	void setupScene(Vector2u size)
 	{
-		auto size = getSize();
-		itcSprite.setTexture(itcTexture, true);
+		screenSize = size;
+
+		mccTitle = itc::ShadowText("Mooncascade", neoretro, neoretroShadow, 64);
+		mccTitle.setColors(Color(255,255,0), Color(64,64,64,168));
+
+		createText(profilerText, dejavusans, "", 14);
+		profilerText.setPosition(10.0f, 10.0f);
+
+		guiAtlas.addFont(neoretro, 64);
+		guiAtlas.addFont(neoretroShadow, 64);
+		guiAtlas.addFont(dejavusans, 14);
+		guiAtlas.build();
+		guiAtlas.setSprite(itcSprite, itcLogo); // same texture as the text, so one draw call for all of it
+		mccTitle.setAtlas(&guiAtlas);
 
-		createText(mccTitle, neoretro, "Mooncascade", 64);
 		auto frame = mccTitle.getLocalBounds();
-		mccTitle.setOrigin(frame.width / 2, frame.height / 2);
-		mccTitle.setPosition(size.x / 2.0f, size.y * 0.66f);
+		mccTitleXform.setOrigin(frame.width / 2, frame.height / 2);
+		mccTitleXform.setPosition(size.x / 2.0f, size.y * 0.66f);
+
+		subtitle = itc::SdfText("ITC2016 Hacking", sdfSans, Color(255,255,255,200));
+		subtitleBounds = subtitle.getLocalBounds();
+
+		statueMage.Mesh    = statueMesh;
+		statueMage.Texture = statueTexture;
+		statueMage.Occluder = true; // hides part of the crowd behind it
+		statueMage.Rotation = quat::from_angle_axis(180.0f, vec3(0.0f, 1.0f, 0.0f)); // faces the camera
+		statueMage.saveState();
+		actors.push_back(&statueMage);
+
+		setCamera(vec3(0.0f, 5.0f, 18.0f), vec3(0.0f, 5.0f, 0.0f));
+	}
+
+	void setCamera(const vec3& eye, const vec3& center)
+	{
+		mat4 view;
+		view.lookat(eye, center, vec3(0.0f, 1.0f, 0.0f));
+		viewProj.perspective(60.0f, (float)screenSize.x, (float)screenSize.y, 0.1f, 1000.0f).multiply(view);
+		lodView = LodView(eye, center, 60.0f);
 	}
 
-	void drawText(Text& text, const Font& primary, const Color& mainColor, 
-							  const Font& shadow, const Color& shadowColor)
+	// places count extra statues on a grid around the origin, behind the main one
+	void spawnCrowd(int count)
 	{
-		text.setFont(neoretroShadow); // draw shadow
-		text.setColor(shadowColor);
-		draw(text);
-		text.setFont(neoretro); // then color
-		text.setColor(mainColor);
-		draw(text);
+		crowd.clear();
+		crowd.reserve(count); // actors keeps pointers into crowd
+		int side = (int)ceilf(sqrtf((float)count));
+		vector<vec3> eulers(count);
+		vector<quat> rotations(count);
+		for (int i = 0; i < count; ++i) // 180 faces the camera
+			eulers[i] = vec3(0.0f, 180.0f - (float)(i * 37 % 360), 0.0f);
+		quat::from_euler(rotations.data(), eulers.data(), count);
+		for (int i = 0; i < count; ++i)
+		{
+			crowd.emplace_back();
+			Actor& actor = crowd.back();
+			actor.Mesh     = statueMesh;
+			actor.Texture  = crowdTextures.empty() ? statueTexture : crowdTextures[i % crowdTextures.size()];
+			actor.Position = vec3((i % side - side / 2) * 8.0f, 0.0f, -(i / side) * 8.0f - 10.0f);
+			actor.Rotation = rotations[i];
+			actor.saveState();
+			actors.push_back(&actor);
+		}
+	}
+
+	// count differently tinted copies of the statue texture for the crowd, so the
+	// render queue has that many textures to bind one by one or merge into an array
+	void makeCrowdTextures(int count)
+	{
+		crowdTextures.clear();
+		Image image;
+		if (count <= 1 || !image.loadFromFile("statue_mage.bmp"))
+			return;
+		Vector2u size = image.getSize();
+		for (int i = 0; i < count; ++i)
+		{
+			Image tinted = image;
+			sf::Uint8* p = (sf::Uint8*)tinted.getPixelsPtr();
+			float r = (i & 1) ? 1.0f : 0.6f, g = (i & 2) ? 1.0f : 0.6f, b = (i & 4) ? 1.0f : 0.6f;
+			for (size_t j = 0; j < (size_t)size.x * size.y; ++j, p += 4) {
+				p[0] = (sf::Uint8)(p[0] * r);
+				p[1] = (sf::Uint8)(p[1] * g);
+				p[2] = (sf::Uint8)(p[2] * b);
+			}
+			crowdTextures.push_back(make_shared<Texture2D>());
+			crowdTextures.back()->create(tinted, true, &jobs);
+		}
 	}
 
-	void drawGui(float deltaTime)
+	////////// Simulation thread ///////////
+
+	// runs at a fixed rate, see FixedTimestep
+	void update(float deltaTime)
 	{
-		if (Mouse::isButtonPressed(Mouse::Left))
+		PROFILE_SCOPE("update");
+		for (Actor* actor : actors)
+			actor->saveState();
+		mccTitlePrevRotation = mccTitleXform.getRotation();
+		subtitlePrevPhase    = subtitlePhase;
+
+		if (isOpen() && Mouse::isButtonPressed(Mouse::Left))
 		{
 			Vector2i pos = Mouse::getPosition(*this);
-			path.push_back(Vertex(Vector2f((float)pos.x, (float)pos.y), Color::White));
+			path.add(Vector2f((float)pos.x, (float)pos.y));
 		}
-		draw(itcSprite);
 
 		// update MCC text
-		mccTitle.rotate(10.0f * deltaTime); // 10 deg/s
-		drawText(mccTitle, neoretro, Color(255,255,0), neoretroShadow, Color(64,64,64,168));
+		mccTitleXform.rotate(10.0f * deltaTime); // 10 deg/s
+		subtitlePhase = fmodf(subtitlePhase + 2.0f * deltaTime, 6.2831853f);
+		statueMage.Rotation = (quat::from_angle_axis(-20.0f * deltaTime, vec3(0.0f, 1.0f, 0.0f)) * statueMage.Rotation).normalized();
+	}
+
+	// alpha interpolates between the last two simulation states
+	void buildFrame(FramePacket& frame, float alpha)
+	{
+		PROFILE_SCOPE("buildFrame");
+		frame.clearColor   = Color(64,64,64);
+		frame.showProfiler = showProfiler;
+		frame.viewProj   = viewProj;
+
+		// occluders go first, every other actor is tested against them
+		occluders.clear();
+		for (Actor* actor : actors)
+		{
+			if (!actor->Occluder || !actor->visible()) continue;
+			Occluder o;
+			o.mesh = actor->Mesh->occluderMesh();
+			mat4 model;
+			actor->modelTransform(model, alpha);
+			o.transform = viewProj;
+			o.transform.multiply(model);
+			occluders.push_back(o);
+		}
+		occlusion.render(occluders.data(), (int)occluders.size(), &jobs);
+		if (showOcclusion) {
+			frame.occlusionPixels.resize(OcclusionBuffer::Width * OcclusionBuffer::Height * 4);
+			occlusion.toPixels(frame.occlusionPixels.data());
+		}
+
+		// actor transforms, LODs and culling are independent, so they're computed on all cores
+		Frustum frustum(viewProj);
+		frame.draws.resize(actors.size());
+		frame.meshletLists.resize(jobs.numWorkers());
+		jobs.parallel_for((int)actors.size(), 64, [&](int begin, int end) {
+			MeshletDrawList& list = frame.meshletLists[jobs.workerIndex()];
+			for (int i = begin; i < end; ++i) {
+				Actor& actor = *actors[i];
+				DrawItem& item = frame.draws[i];
+				item.lod       = actor.selectLod(lodView);
+				actor.selectMip(lodView, (float)screenSize.y);
+				item.mesh      = item.lod >= 0 ? actor.Mesh.get() : nullptr;
+				item.texture   = actor.Texture.get();
+				item.numRanges = -1;
+
+				mat4 model;
+				actor.modelTransform(model, alpha);
+				item.transform = viewProj;
+				item.transform.multiply(model);
+
+				if (item.mesh && !actor.Occluder &&
+					!occlusion.boxVisible(item.mesh->BoundsMin, item.mesh->BoundsMax, item.transform))
+					item.mesh = nullptr; // hidden behind occluders
+
+				const MeshletMesh* meshlets = item.mesh ? item.mesh->meshlets(item.lod) : nullptr;
+				if (meshlets)
+				{
+					item.drawList   = jobs.workerIndex();
+					item.firstRange = list.size();
+					float scale = max(actor.Scale.x, max(actor.Scale.y, actor.Scale.z));
+					if (!meshlets->cull(list, model, scale, frustum, lodView.eye))
+						item.mesh = nullptr; // every cluster was culled
+					item.numRanges = list.size() - item.firstRange;
+				}
+			}
+		});
+
+		// finer mips only for the actors that are actually drawn
+		textureStreamer.beginFrame();
+		for (size_t i = 0; i < actors.size(); ++i)
+			if (frame.draws[i].mesh)
+				textureStreamer.request(frame.draws[i].texture, actors[i]->Mip);
+		textureStreamer.update();
+
+		GuiItem sprite = {};
+		sprite.type   = GuiItem::Sprite;
+		sprite.sprite = &itcSprite;
+		frame.gui.push_back(sprite);
+
+		GuiItem title = {};
+		title.type      = GuiItem::ShadowText;
+		title.text      = &mccTitle;
+		title.transform = interpolatedTitle(alpha).getTransform();
+		frame.gui.push_back(title);
+
+		// one SDF atlas serves every size, so the pulse costs no glyph rasterization
+		GuiItem sub = {};
+		sub.type      = GuiItem::SdfText;
+		sub.sdfText   = &subtitle;
+		sub.transform = subtitleTransform(alpha);
+		frame.gui.push_back(sub);
+
+		// only the changed trail vertices, the render thread keeps the rest on the GPU
+		GuiItem trail = {};
+		trail.type  = GuiItem::Trail;
+		trail.first = (int)frame.guiVerts.size();
+		trail.keep  = path.collect(frame.guiVerts, Color::White);
+		trail.count = (int)frame.guiVerts.size() - trail.first;
+		frame.gui.push_back(trail);
+	}
+
+	Transformable interpolatedTitle(float alpha) const
+	{
+		Transformable title = mccTitleXform;
+		float rotation = mccTitleXform.getRotation();
+		float delta    = rotation - mccTitlePrevRotation;
+		if (delta < -180.0f) delta += 360.0f; // getRotation() wraps at 360
+		title.setRotation(mccTitlePrevRotation + delta * alpha);
+		return title;
+	}
+
+	Transform subtitleTransform(float alpha) const
+	{
+		float next = subtitlePhase;
+		if (next < subtitlePrevPhase) next += 6.2831853f; // wrapped at 2pi
+		float phase = subtitlePrevPhase + (next - subtitlePrevPhase) * alpha;
+		float size = 28.0f + 10.0f * sinf(phase); // character size in pixels
+		Transform t;
+		t.translate(screenSize.x / 2.0f, screenSize.y * 0.66f + 70.0f);
+		t.scale(size, size);
+		t.translate(-(subtitleBounds.left + subtitleBounds.width / 2), -(subtitleBounds.top + subtitleBounds.height / 2));
+		return t;
+	}
+
+	////////// Render thread ///////////
+
+	void renderFrame(RenderTarget& target, const FramePacket& frame)
+	{
+		PROFILE_SCOPE("renderFrame");
+		DrawStats.reset();
+		guiStream.beginFrame();
+		target.clear(frame.clearColor);
+		textureStreamer.uploadPending();
+		draw3d(frame);
+		target.resetGLStates(); // hand GL state back to SFML
+		drawGui(target, frame);
+		if (!frame.occlusionPixels.empty())
+			drawOcclusion(target, frame);
+		if (frame.showProfiler)
+			drawProfiler(target);
+		guiStream.endFrame();
+	}
+
+	// the software depth buffer at 2x size in the bottom left corner
+	void drawOcclusion(RenderTarget& target, const FramePacket& frame)
+	{
+		if (occlusionTexture.getSize().x != OcclusionBuffer::Width) {
+			occlusionTexture.create(OcclusionBuffer::Width, OcclusionBuffer::Height);
+			occlusionSprite.setTexture(occlusionTexture, true);
+			occlusionSprite.setScale(2.0f, 2.0f);
+		}
+		occlusionTexture.update(frame.occlusionPixels.data());
+		occlusionSprite.setPosition(10.0f, target.getSize().y - 10.0f - OcclusionBuffer::Height * 2.0f);
+		target.draw(occlusionSprite);
+		++DrawStats.drawCalls;
+	}
+
+	void drawProfiler(RenderTarget& target)
+	{
+		++profilerFrames;
+		double now = time_ms();
+		if (now - profilerLastUpdate >= 500.0) {
+			TextureStreamStats tex = textureStreamer.stats();
+			char line[128];
+			snprintf(line, sizeof(line), "textures %d KB resident, %d loading, latency %.1f ms avg %.1f ms max\n",
+				(int)(tex.residentBytes / 1024), tex.pendingLoads, tex.avgLatencyMs, tex.maxLatencyMs);
+			profilerText.setString(Profiler::summaryText(now - profilerLastUpdate, profilerFrames) + line);
+			profilerLastUpdate = now;
+			profilerFrames     = 0;
+		}
+		int font = guiAtlas.find(profilerText.getFont(), profilerText.getCharacterSize());
+		if (font < 0) {
+			target.draw(profilerText);
+			++DrawStats.drawCalls;
+			return;
+		}
+		guiBatch.addText(guiAtlas, font, profilerText.getString(), profilerText.getTransform(), profilerText.getColor());
+		guiBatch.flush(target);
+	}
 
-		draw(path.data(), path.size(), PrimitiveType::LinesStrip);
+	// transient vertices go through the stream buffer, or SFML's client arrays if it's full
+	// (or for quads, which core GL can't draw); texture coordinates are ignored
+	void drawStreamed(RenderTarget& target, const Vertex* verts, int count, PrimitiveType type, const RenderStates& states)
+	{
+		static const GLenum primitives[] = { GL_POINTS, GL_LINES, GL_LINE_STRIP, GL_TRIANGLES,
+		                                     GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN };
+		GLintptr offset;
+		void* dst = type != PrimitiveType::Quads ? guiStream.allocate(count * sizeof(Vertex), sizeof(Vertex), offset) : nullptr;
+		if (dst) {
+			memcpy(dst, verts, count * sizeof(Vertex));
+			guiStream.commit();
+			renderer2d.draw(target, guiStream.buffer, offset, count, primitives[type], states.transform);
+		}
+		else {
+			target.draw(verts, count, type, states);
+			++DrawStats.drawCalls;
+		}
+	}
+
+	// em space glyphs scaled by transform; if the stream is full SFML draws the raw field instead
+	void drawSdfText(RenderTarget& target, const itc::SdfText& text, const Transform& transform)
+	{
+		const vector<Vertex>& mesh = text.geometry();
+		if (mesh.empty())
+			return;
+		const Texture& atlas = text.getFont()->texture();
+		GLintptr offset;
+		if (void* dst = guiStream.allocate(mesh.size() * sizeof(Vertex), sizeof(Vertex), offset)) {
+			memcpy(dst, mesh.data(), mesh.size() * sizeof(Vertex));
+			guiStream.commit();
+			renderer2d.draw(target, guiStream.buffer, offset, (int)mesh.size(), GL_TRIANGLES, transform, sdfShader, atlas);
+		}
+		else {
+			target.draw(mesh.data(), mesh.size(), PrimitiveType::Triangles, RenderStates(BlendAlpha, transform, &atlas, nullptr));
+			++DrawStats.drawCalls;
+		}
 	}
 
-	void draw3d(float deltaTime)
+	void drawGui(RenderTarget& target, const FramePacket& frame)
 	{
-		// sorry; SFML was a bad dog
+		PROFILE_SCOPE("drawGui");
+		for (const GuiItem& item : frame.gui)
+		{
+			RenderStates states(item.transform);
+			switch (item.type)
+			{
+			case GuiItem::Sprite:
+				guiBatch.addSprite(*item.sprite, item.transform);
+				break;
+			case GuiItem::ShadowText:
+				item.text->draw(guiBatch, item.transform); // cached glyph meshes, only moved
+				break;
+			case GuiItem::SdfText:
+				guiBatch.flush(target);
+				drawSdfText(target, *item.sdfText, item.transform);
+				break;
+			case GuiItem::LineStrip:
+				guiBatch.flush(target);
+				if (!item.count) break;
+				drawStreamed(target, &frame.guiVerts[item.first], item.count, PrimitiveType::LinesStrip, states);
+				break;
+			case GuiItem::Trail:
+				guiBatch.flush(target);
+				trailBuffer.truncate(item.keep * sizeof(Vertex));
+				if (item.count)
+					trailBuffer.append(guiStream, &frame.guiVerts[item.first], item.count * sizeof(Vertex));
+				renderer2d.draw(target, trailBuffer.buffer, 0, (int)(trailBuffer.size() / sizeof(Vertex)),
+				                GL_LINE_STRIP, item.transform);
+				break;
+			}
+		}
+		guiBatch.flush(target);
+	}
+
+	void draw3d(const FramePacket& frame)
+	{
+		PROFILE_SCOPE("draw3d");
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_DEPTH_TEST);
+		instanced3d.bind();
+		renderQueue.submit(frame, instanced3d, &instancedArray3d);
+		instanced3d.unbind();
+		glDisable(GL_DEPTH_TEST);
 	}
 };
 
 
 ////////////////////////////////////////////////////////////////////////////////
 
-int main()
+static bool init_glew()
+{
+	glewExperimental = true; // enable loading experimental OpenGL features
+	GLenum status = glewInit();
+	if (status != GLEW_OK) { // init GL extension wrangler
+		fprintf(stderr, "GLEW error: %s\n", glewGetErrorString(status));
+		return false;
+	}
+	return true;
+}
+
+struct HeadlessOptions
+{
+	int frames = 600;
+	int actors = 100;
+	const char* out = "benchmark.json";
+	bool indirect = true;
+	bool arrays   = true;
+	int textures  = 1; // distinct crowd textures
+	int textureBudgetMB = 64;
+};
+
+/**
+ * Renders a scripted camera orbit over N actors into an offscreen RenderTexture,
+ * then writes frame time statistics and draw counters to a JSON file.
+ * On Linux this forces Mesa's llvmpipe so numbers are comparable on GPU-less machines;
+ * SFML still needs an X display for the GL context, e.g. run it under xvfb-run.
+ */
+static int run_headless(ContextSettings& settings, const HeadlessOptions& opt)
 {
+	#ifndef _WIN32
+		setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0); // don't override an explicit choice
+		setenv("GALLIUM_DRIVER", "llvmpipe", 0);
+	#endif
+
+	ITC2016 game { settings, /*headless*/true };
+	RenderTexture target;
+	if (!target.create(1280, 720, /*depthBuffer*/true)) {
+		fprintf(stderr, "headless: failed to create %dx%d RenderTexture\n", 1280, 720);
+		return EXIT_FAILURE;
+	}
+	target.setActive(true);
+	if (!init_glew())
+		return EXIT_FAILURE;
+
+	game.allowIndirect = opt.indirect;
+	game.allowArrays   = opt.arrays;
+	game.textureStreamer.Budget = (size_t)opt.textureBudgetMB * 1024 * 1024;
+	game.loadResources();
+	game.setupScene(target.getSize());
+	game.makeCrowdTextures(opt.textures);
+	game.spawnCrowd(opt.actors);
+
+	const char* glRenderer = (const char*)glGetString(GL_RENDERER);
+	printf("headless: %d frames, %d actors, %d textures, renderer: %s\n", opt.frames, opt.actors, opt.textures, glRenderer);
+
+	FixedTimestep timestep { 1.0 / 120.0 };
+	FrameStats    frameStats;
+	FramePacket   frame;
+	unsigned long long drawCalls = 0, triangles = 0;
+	const float frameDelta = 1.0f / 60.0f; // simulated time always advances at 60fps
+
+	for (int i = 0; i < opt.frames; ++i)
+	{
+		double start = time_ms();
+
+		// scripted camera: orbit the crowd once over the whole run
+		float angle = 6.2831853f * i / opt.frames;
+		game.setCamera(vec3(sinf(angle) * 40.0f, 12.0f, cosf(angle) * 40.0f - 20.0f), vec3(0.0f, 5.0f, -20.0f));
+		for (int n = timestep.advance(frameDelta); n > 0; --n)
+			game.update((float)timestep.step);
+
+		frame.clear();
+		frame.frameId   = i;
+		frame.buildTime = start;
+		frame.showProfiler = false;
+		game.buildFrame(frame, timestep.alpha());
+
+		game.renderFrame(target, frame);
+		target.display();
+		glFinish(); // include the (software) GPU time in the frame
+
+		drawCalls += DrawStats.drawCalls;
+		triangles += DrawStats.triangles;
+		frameStats.add((float)(time_ms() - start));
+	}
+
+	FrameStats::Summary s = frameStats.summary();
+	frameStats.print("headless");
+	FILE* f = fopen(opt.out, "wb");
+	if (!f) {
+		fprintf(stderr, "headless: fopen failed %s\n", opt.out);
+		return EXIT_FAILURE;
+	}
+	fprintf(f, "{\n");
+	fprintf(f, "  \"renderer\": ");
+	writeJsonString(f, glRenderer ? glRenderer : "unknown");
+	fprintf(f, ",\n");
+	fprintf(f, "  \"width\": %u, \"height\": %u,\n", target.getSize().x, target.getSize().y);
+	fprintf(f, "  \"frames\": %d, \"actors\": %d, \"textures\": %d,\n", opt.frames, opt.actors, opt.textures);
+	fprintf(f, "  \"submission\": \"%s\",\n", game.renderQueue.indirectEnabled() ? "multi_draw_indirect" : "instanced");
+	fprintf(f, "  \"texture_arrays\": %s,\n", game.renderQueue.arraysEnabled() ? "true" : "false");
+	fprintf(f, "  \"frame_ms\": { \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+		s.mean, s.p50, s.p90, s.p99, s.max);
+	fprintf(f, "  \"draw_calls_per_frame\": %.1f,\n", (double)drawCalls / opt.frames);
+	fprintf(f, "  \"triangles_per_frame\": %.1f,\n", (double)triangles / opt.frames);
+	TextureStreamStats tex = game.textureStreamer.stats();
+	fprintf(f, "  \"texture_streaming\": { \"resident_kb\": %d, \"loads\": %d, \"drops\": %d, \"latency_ms\": { \"mean\": %.4f, \"max\": %.4f } }\n",
+		(int)(tex.residentBytes / 1024), tex.loadsDone, tex.drops, tex.avgLatencyMs, tex.maxLatencyMs);
+	fprintf(f, "}\n");
+	fclose(f);
+	printf("headless: wrote %s\n", opt.out);
+	return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	// -st renders on the main thread, for comparing latency/throughput against the render thread
+	// -fps N sets the render rate, 0 for unlimited; simulation always runs at 120Hz
+	// -profile starts recording profiler zones right away; F3 toggles the overlay, F9 exports a trace
+	// F4 shows the occlusion culling depth buffer
+	// -nomdi draws with the GL 3.3 instanced path even if multi-draw indirect is available
+	// -noarrays binds every actor texture on its own instead of merging same sized ones into texture arrays
+	// -texbudget MB limits the VRAM of streamed texture mips, 64 by default
+	// -headless [-frames N] [-actors N] [-textures N] [-out file.json] runs the offscreen benchmark, see run_headless
+	bool threadedRender = true;
+	bool headless       = false;
+	bool allowIndirect  = true;
+	bool allowArrays    = true;
+	double targetFps    = 60.0;
+	HeadlessOptions headlessOpt;
+	for (int i = 1; i < argc; ++i) {
+		if      (strcmp(argv[i], "-st") == 0) threadedRender = false;
+		else if (strcmp(argv[i], "-profile") == 0) Profiler::Enabled = true;
+		else if (strcmp(argv[i], "-headless") == 0) headless = true;
+		else if (strcmp(argv[i], "-nomdi") == 0) allowIndirect = headlessOpt.indirect = false;
+		else if (strcmp(argv[i], "-noarrays") == 0) allowArrays = headlessOpt.arrays = false;
+		else if (i + 1 < argc && strcmp(argv[i], "-fps") == 0)    targetFps = atof(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "-frames") == 0) headlessOpt.frames = atoi(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "-actors") == 0) headlessOpt.actors = atoi(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "-textures") == 0) headlessOpt.textures = atoi(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "-out") == 0)    headlessOpt.out    = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "-texbudget") == 0) headlessOpt.textureBudgetMB = atoi(argv[++i]);
+	}
+	if (headlessOpt.frames < 1 || headlessOpt.actors < 0) {
+		fprintf(stderr, "usage: -frames must be at least 1 and -actors must not be negative\n");
+		return 1;
+	}
+	if (headlessOpt.textureBudgetMB < 0) {
+		fprintf(stderr, "usage: -texbudget must not be negative\n");
+		return 1;
+	}
+
+	Profiler::setThreadName("Main");
+
 	// configure OpenGL
 	ContextSettings settings;
+	settings.depthBits = 24;
 	//settings.antialiasingLevel = 4;
 
+	if (headless)
+		return run_headless(settings, headlessOpt);
+
 	ITC2016 game { settings };
 	game.setVerticalSyncEnabled(false);
-	game.setFramerateLimit(60);
 	game.display();
-	
+
 	////////////// Init GLEW /////////////
-	{
-		glewExperimental = true; // enable loading experimental OpenGL features
-		GLenum status = glewInit();
-		if (status != GLEW_OK) { // init GL extension wrangler
-			fprintf(stderr, "GLEW error: %s\n", glewGetErrorString(status));
-			return EXIT_FAILURE;
-		}
-	}
+	if (!init_glew())
+		return EXIT_FAILURE;
 
 
 	//// Load game resources
-	Clock clock;
+	game.allowIndirect = allowIndirect;
+	game.allowArrays   = allowArrays;
+	game.textureStreamer.Budget = (size_t)headlessOpt.textureBudgetMB * 1024 * 1024;
 	game.loadResources();
-	game.setupScene();
+	game.setupScene(game.getSize());
+	Clock clock;
+
+	// simulation stays on this thread, GL submission moves to the render thread
+	RenderThread renderer { game, [&](const FramePacket& frame) { game.renderFrame(game, frame); }, threadedRender };
+	renderer.start();
+
+	FixedTimestep timestep { 1.0 / 120.0 };
+	FramePacer    pacer    { targetFps };
+	FrameStats    frameStats;
+	frameStats.reserve(60 * 60 * 10);
 
 	// enter game loop
-    while (game.isOpen())
+	bool running = true;
+    while (running)
     {
         Event event;
         while (game.pollEvent(event))
         {
 			if (event.type == Event::Closed || (event.type == Event::KeyPressed && Keyboard::isKeyPressed(Keyboard::Escape))) {
-                game.close();
+                running = false;
+			}
+			else if (event.type == Event::KeyPressed && event.key.code == Keyboard::F3) {
+				game.showProfiler = !game.showProfiler;
+				if (game.showProfiler) Profiler::Enabled = true;
+			}
+			else if (event.type == Event::KeyPressed && event.key.code == Keyboard::F4) {
+				game.showOcclusion = !game.showOcclusion;
+			}
+			else if (event.type == Event::KeyPressed && event.key.code == Keyboard::F9) {
+				Profiler::exportChromeTrace("itc2016_trace.json");
 			}
         }
-		game.clear(Color(64,64,64));
-		float deltaTime = clock.restart().asSeconds();
-		game.draw3d(deltaTime);
-		game.drawGui(deltaTime);
-		game.display();
+		float frameTime = clock.restart().asSeconds();
+		frameStats.add(frameTime * 1000.0f);
+		for (int n = timestep.advance(frameTime); n > 0; --n)
+			game.update((float)timestep.step);
+
+		game.buildFrame(renderer.beginFrame(), timestep.alpha());
+		renderer.submitFrame();
+		{
+			PROFILE_SCOPE("pacer");
+			pacer.wait();
+		}
     }
+
+	renderer.stop(); // GL context is back on this thread
+	renderer.printStats();
+	frameStats.print("Frame time");
+	if (Profiler::Enabled)
+		Profiler::exportChromeTrace("itc2016_trace.json");
+	game.close();
     return 0;
 }
 
-////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+////////////////////////////////////////////////////////////////////////////////
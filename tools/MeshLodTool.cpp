@@ -0,0 +1,93 @@
+#include "StaticMesh.hpp"
+#include "MeshSimplify.hpp"
+#include "JobSystem.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+using namespace itc;
+
+////////////////////////////////////////////////////////////////////////////////
+// Offline LOD chain generator. Writes {name}_lod1.bmd, {name}_lod2.bmd, ... next
+// to the input, which StaticMesh then loads instead of simplifying at load time.
+// With -meshlets every level also gets a {name}.meshlets cluster sidecar.
+//
+//   MeshLodTool model.bmd [-ratios 0.5,0.25,0.12] [-threads N] [-meshlets]
+//
+
+static bool write_meshlets(const BMDModel& model, const string& bmdFile)
+{
+	MeshletMesh meshlets;
+	meshlets.build(model.vertices(), model.num_verts, model.indices(), model.num_indices);
+	string file = StaticMesh::meshletFile(bmdFile);
+	if (!meshlets.saveToFile(file, MeshletMesh::sourceHash(model.vertices(), model.num_verts,
+	                                                       model.indices(), model.num_indices)))
+		return false;
+	printf("  wrote %s (%d meshlets)\n", file.c_str(), (int)meshlets.meshlets.size());
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: MeshLodTool model.bmd [-ratios 0.5,0.25,0.12] [-threads N] [-meshlets]\n");
+		return 1;
+	}
+
+	string input = argv[1];
+	vector<float> ratios(DefaultLodRatios, DefaultLodRatios + sizeof(DefaultLodRatios) / sizeof(float));
+	int threads = 0;
+	bool meshlets = false;
+	for (int i = 2; i < argc; ++i) {
+		if (strcmp(argv[i], "-meshlets") == 0) meshlets = true;
+		else if (i + 1 < argc && strcmp(argv[i], "-threads") == 0) threads = atoi(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "-ratios") == 0) {
+			ratios.clear();
+			for (char* r = strtok(argv[++i], ","); r; r = strtok(nullptr, ","))
+				ratios.push_back((float)atof(r));
+		}
+	}
+	for (size_t i = 0; i < ratios.size(); ++i) {
+		if (ratios[i] <= 0.0f || ratios[i] > 1.0f || (i > 0 && ratios[i] >= ratios[i - 1])) {
+			fprintf(stderr, "usage: -ratios must be in (0,1] and decreasing, e.g. 0.5,0.25,0.12\n");
+			return 1;
+		}
+	}
+
+	unique_ptr<BMDModel> model = BMDModel::loadFromFile(input);
+	if (!model)
+		return 1;
+
+	JobSystem jobs(threads);
+	printf("%s: %d verts, %d tris, %d threads\n", input.c_str(),
+		model->num_verts, model->num_indices / 3, jobs.numWorkers());
+	if (meshlets && !write_meshlets(*model, input))
+		return 1;
+	vector<SimplifiedMesh> chain = generate_lod_chain(model->vertices(), model->num_verts,
+		model->indices(), model->num_indices, ratios.data(), (int)ratios.size(), &jobs);
+
+	for (size_t i = 0; i < chain.size(); ++i)
+	{
+		const SimplifiedMesh& lod = chain[i];
+		string file = StaticMesh::lodFile(input, (int)i + 1);
+		unique_ptr<BMDModel> out = BMDModel::create(model->name, model->tex_name,
+			lod.vertices.data(), (int)lod.vertices.size(), lod.indices.data(), (int)lod.indices.size());
+		if (!out || !out->saveToFile(file))
+			return 1;
+		printf("  wrote %s\n", file.c_str());
+		if (meshlets && !write_meshlets(*out, file))
+			return 1;
+	}
+
+	// StaticMesh loads every level file it finds, so levels left over from a longer chain must go
+	for (int level = (int)chain.size() + 1; ; ++level)
+	{
+		string file = StaticMesh::lodFile(input, level);
+		if (remove(file.c_str()) != 0)
+			break;
+		remove(StaticMesh::meshletFile(file).c_str());
+		printf("  removed stale %s\n", file.c_str());
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
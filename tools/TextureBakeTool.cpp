@@ -0,0 +1,101 @@
+#include "TextureCodec.hpp"
+#include "JobSystem.hpp"
+#include "FrameTiming.hpp"
+#include <SFML/Graphics/Image.hpp>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+using namespace itc;
+
+////////////////////////////////////////////////////////////////////////////////
+// Offline texture baker. Encodes an image and its mip chain to BC1, BC3 or BC7
+// and writes {name}.itx next to it, which the game uploads as is instead of
+// decoding the original image. Without a format flag, opaque images become BC1
+// and images with alpha BC3. Mips are Kaiser filtered in linear space; -box uses
+// a 2x2 average and -linear skips the sRGB conversion, e.g. for normal maps.
+//
+//   TextureBakeTool image.bmp [-bc1|-bc3|-bc7|-rgba8] [-nomips] [-box] [-linear]
+//                   [-threads N] [-o out.itx]
+//
+
+static bool has_alpha(const sf::Image& image)
+{
+	const sf::Uint8* p = image.getPixelsPtr();
+	size_t count = (size_t)image.getSize().x * image.getSize().y;
+	for (size_t i = 0; i < count; ++i)
+		if (p[i * 4 + 3] != 255) return true;
+	return false;
+}
+
+// peak signal to noise ratio of the top level against the source, over RGB and alpha if the format has it
+static double level_psnr(const sf::Image& image, const TextureFile& baked, JobSystem& jobs)
+{
+	const TextureLevel& level = baked.levels[0];
+	vector<sf::Uint8> decoded(level.width * level.height * 4);
+	decompress_image(baked.format, level.data.data(), level.width, level.height, decoded.data(), &jobs);
+	const sf::Uint8* p = image.getPixelsPtr();
+	int channels = baked.format == TexBC1 ? 3 : 4;
+	double sum = 0.0;
+	for (size_t i = 0; i < decoded.size() / 4; ++i)
+		for (int c = 0; c < channels; ++c) {
+			double d = (double)p[i * 4 + c] - decoded[i * 4 + c];
+			sum += d * d;
+		}
+	double mse = sum / (decoded.size() / 4 * channels);
+	return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: TextureBakeTool image.bmp [-bc1|-bc3|-bc7|-rgba8] [-nomips] [-box] [-linear]"
+		                " [-threads N] [-o out.itx]\n");
+		return 1;
+	}
+
+	string input  = argv[1];
+	string output = TextureFile::bakedFile(input);
+	int  format  = -1;
+	bool mipmaps = true;
+	bool srgb    = true;
+	MipFilter filter = MipKaiser;
+	int  threads = 0;
+	for (int i = 2; i < argc; ++i) {
+		if      (strcmp(argv[i], "-bc1") == 0)   format = TexBC1;
+		else if (strcmp(argv[i], "-bc3") == 0)   format = TexBC3;
+		else if (strcmp(argv[i], "-bc7") == 0)   format = TexBC7;
+		else if (strcmp(argv[i], "-rgba8") == 0) format = TexRGBA8;
+		else if (strcmp(argv[i], "-nomips") == 0) mipmaps = false;
+		else if (strcmp(argv[i], "-box") == 0)    filter  = MipBox;
+		else if (strcmp(argv[i], "-linear") == 0) srgb    = false;
+		else if (i + 1 < argc && strcmp(argv[i], "-threads") == 0) threads = atoi(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "-o") == 0)       output  = argv[++i];
+	}
+
+	sf::Image image;
+	if (!image.loadFromFile(input))
+		return 1;
+	if (format < 0)
+		format = has_alpha(image) ? TexBC3 : TexBC1;
+
+	JobSystem jobs(threads);
+	int width = image.getSize().x, height = image.getSize().y;
+	printf("%s: %dx%d -> %s, %d threads\n", input.c_str(), width, height,
+		texture_format_name((TextureFormat)format), jobs.numWorkers());
+
+	double start = time_ms();
+	TextureFile baked;
+	baked.build(image.getPixelsPtr(), width, height, (TextureFormat)format, mipmaps, &jobs, filter, srgb);
+	double elapsed = time_ms() - start;
+	if (!baked.saveToFile(output))
+		return 1;
+
+	size_t raw = (size_t)width * height * 4;
+	printf("  wrote %s: %d levels, %d KB (RGBA8 level 0 is %d KB), %.1f ms, PSNR %.2f dB\n",
+		output.c_str(), (int)baked.levels.size(), (int)(baked.byteSize() / 1024), (int)(raw / 1024),
+		elapsed, level_psnr(image, baked, jobs));
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -1,13 +1,17 @@
 #include "Types3D.hpp"
+#include <emmintrin.h> // SSE2
 
 namespace itc
 {
-	const vec2 vec2::ZERO = { 0.0f, 0.0f };
-	const vec3 vec3::ZERO = { 0.0f, 0.0f, 0.0f };
-	const vec4 vec4::ZERO = { 0.0f, 0.0f, 0.0f, 0.0f };
-	const vec3 vec3::XAXIS; // Represents vec3 {1,0,0}
-	const vec3 vec3::YAXIS; // Represents vec3 {0,1,0}
-	const vec3 vec3::ZAXIS; // Represents vec3 {0,0,1}
+	// constexpr constructors make these constant initialized, so they're set before any
+	// dynamic initializer in another translation unit can read them
+	const vec2 vec2::ZERO  = { 0.0f, 0.0f };
+	const vec3 vec3::ZERO  = { 0.0f, 0.0f, 0.0f };
+	const vec3 vec3::XAXIS = { 1.0f, 0.0f, 0.0f };
+	const vec3 vec3::YAXIS = { 0.0f, 1.0f, 0.0f };
+	const vec3 vec3::ZAXIS = { 0.0f, 0.0f, 1.0f };
+	const vec4 vec4::ZERO  = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const quat quat::IDENTITY = { 0.0f, 0.0f, 0.0f, 1.0f };
 
 	////////////////////////////////////////////////////////////////////////////////
 
@@ -15,50 +19,250 @@ namespace itc
 		return (degrees * (float)M_PI) / 180.0f; // rads=(degs*PI)/180
 	}
 
-	// creates a quaternion rotation from an euler angle (degrees), rotation axis must be specified
-	vec4 quat_angle_axis(float angle, const vec3& axis)
+	// Cephes style sincos: x is reduced to [-pi/4, pi/4] around the nearest multiple of pi/2,
+	// then the quadrant picks which polynomial and sign gives sin and which gives cos.
+	// The precise mode (sincos_precise) subtracts pi/2 in three parts so large angles keep their low bits,
+	// and uses the Cephes sinf/cosf polynomials; the fast mode uses two parts and
+	// polynomials two degrees shorter, minimax fitted over [-pi/4, pi/4]
+	template<bool Precise> static inline void sincos_ps(__m128 x, __m128& outSin, __m128& outCos)
 	{
-		const float r = radf(angle) * 0.5f;
-		const float s = sinf(r);
-		return vec4{axis.x * s, axis.y * s, axis.z * s, cosf(r)};
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		__m128 sinSign = _mm_and_ps(x, signBit);
+		x = _mm_andnot_ps(signBit, x);
+
+		// even multiple j of pi/4 closest to |x|
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f))); // 4/pi
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		const __m128 y = _mm_cvtepi32_ps(j);
+		if (Precise) {
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+		} else {
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4191339745e-4f)));
+		}
+
+		sinSign = _mm_xor_ps(sinSign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+		const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		const __m128 sinFromSin = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+		const __m128 z = _mm_mul_ps(x, x);
+		__m128 c, s;
+		if (Precise) {
+			c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), z), _mm_set1_ps(-1.388731625493765e-3f));
+			c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(4.166664568298827e-2f));
+			s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), z), _mm_set1_ps(8.3321608736e-3f));
+			s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(-1.6666654611e-1f));
+		} else {
+			c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.3652450089e-3f), z), _mm_set1_ps(4.1661278619e-2f));
+			s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(8.1529922460e-3f), z), _mm_set1_ps(-1.6662833802e-1f));
+		}
+		c = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c, _mm_mul_ps(z, z)), _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+		s = _mm_add_ps(_mm_mul_ps(s, _mm_mul_ps(z, x)), x);
+
+		outSin = _mm_or_ps(_mm_and_ps(sinFromSin, s), _mm_andnot_ps(sinFromSin, c));
+		outCos = _mm_or_ps(_mm_and_ps(sinFromSin, c), _mm_andnot_ps(sinFromSin, s));
+		outSin = _mm_xor_ps(outSin, sinSign);
+		outCos = _mm_xor_ps(outCos, cosSign);
 	}
 
-	// creates a quaternion rotation from an euler angle (degrees), rotation axis must be specified
-	vec4 quat_angle_axis(float angle, float x, float y, float z)
+	template<bool Precise> static void sincos_array(const float* angles, float* outSin, float* outCos, int count)
 	{
-		return quat_angle_axis(angle, {x,y,z});
+		int i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128 s, c;
+			sincos_ps<Precise>(_mm_loadu_ps(angles + i), s, c);
+			_mm_storeu_ps(outSin + i, s);
+			_mm_storeu_ps(outCos + i, c);
+		}
+		if (i < count) { // the last 1-3 angles
+			float a[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, sines[4], cosines[4];
+			for (int k = i; k < count; ++k) a[k - i] = angles[k];
+			__m128 s, c;
+			sincos_ps<Precise>(_mm_loadu_ps(a), s, c);
+			_mm_storeu_ps(sines, s);
+			_mm_storeu_ps(cosines, c);
+			for (int k = i; k < count; ++k) outSin[k] = sines[k - i], outCos[k] = cosines[k - i];
+		}
 	}
 
-	// creates a quaternion rotation from euler XYZ (degrees) rotation 
-	vec4 quat_from_rotation(const vec3& rotation)
+	void sincos(const float* angles, float* outSin, float* outCos, int count)
 	{
-		vec4 q = quat_angle_axis(rotation.x, 1.0f, 0.0f, 0.0f);
-		     q = quat_mul(quat_angle_axis(rotation.y, 0.0f, 1.0f, 0.0f), q);
-		return   quat_mul(quat_angle_axis(rotation.z, 0.0f, 0.0f, 1.0f), q);
+		sincos_array<false>(angles, outSin, outCos, count);
 	}
 
-	// rotates quaternion p with extra rotation p
-	// q = additional rotation we wish to rotate with
-	// p = original rotation
-	vec4 quat_mul(const vec4& q, const vec4& p)
+	void sincos_precise(const float* angles, float* outSin, float* outCos, int count)
 	{
-		return vec4{
-			q.w*p.w - q.x*p.x - q.y*p.y - q.z*p.z,
-			q.w*p.x + q.x*p.w + q.y*p.z - q.z*p.y,
-			q.w*p.y + q.y*p.w + q.z*p.x - q.x*p.z,
-			q.w*p.z + q.z*p.w + q.x*p.y - q.y*p.x
+		sincos_array<true>(angles, outSin, outCos, count);
+	}
+
+	void sincos(float angle, float& outSin, float& outCos)
+	{
+		__m128 s, c;
+		sincos_ps<false>(_mm_set_ss(angle), s, c);
+		outSin = _mm_cvtss_f32(s);
+		outCos = _mm_cvtss_f32(c);
+	}
+
+	vec3 quat::rotate(const vec3& v) const
+	{
+		// v + 2w(u x v) + 2u x (u x v), with u = xyz
+		const vec3 u = { x, y, z };
+		const vec3 t = u.cross(v) * 2.0f;
+		return v + t * w + u.cross(t);
+	}
+
+	quat quat::from_angle_axis(float angleDegs, const vec3& axis)
+	{
+		float s, c;
+		sincos(radf(angleDegs) * 0.5f, s, c);
+		return quat(axis.x * s, axis.y * s, axis.z * s, c);
+	}
+
+	quat quat::from_euler(const vec3& rotation)
+	{
+		// Z * Y * X with the three single axis rotations multiplied out
+		const float half = (float)M_PI / 360.0f;
+		const __m128 angles = _mm_setr_ps(rotation.x * half, rotation.y * half, rotation.z * half, 0.0f);
+		float sines[4], cosines[4];
+		__m128 s, c;
+		sincos_ps<false>(angles, s, c);
+		_mm_storeu_ps(sines, s);
+		_mm_storeu_ps(cosines, c);
+		const float sx = sines[0], cx = cosines[0];
+		const float sy = sines[1], cy = cosines[1];
+		const float sz = sines[2], cz = cosines[2];
+		return quat(
+			cz*cy*sx - sz*sy*cx,
+			cz*sy*cx + sz*cy*sx,
+			sz*cy*cx - cz*sy*sx,
+			cz*cy*cx + sz*sy*sx);
+	}
+
+	void quat::from_euler(quat* out, const vec3* rotations, int count)
+	{
+		const __m128 half = _mm_set1_ps((float)M_PI / 360.0f);
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const vec3* r = rotations + i;
+			__m128 sx, cx, sy, cy, sz, cz;
+			sincos_ps<false>(_mm_mul_ps(_mm_setr_ps(r[0].x, r[1].x, r[2].x, r[3].x), half), sx, cx);
+			sincos_ps<false>(_mm_mul_ps(_mm_setr_ps(r[0].y, r[1].y, r[2].y, r[3].y), half), sy, cy);
+			sincos_ps<false>(_mm_mul_ps(_mm_setr_ps(r[0].z, r[1].z, r[2].z, r[3].z), half), sz, cz);
+			const __m128 czcy = _mm_mul_ps(cz, cy), szsy = _mm_mul_ps(sz, sy);
+			const __m128 czsy = _mm_mul_ps(cz, sy), szcy = _mm_mul_ps(sz, cy);
+			__m128 qx = _mm_sub_ps(_mm_mul_ps(czcy, sx), _mm_mul_ps(szsy, cx));
+			__m128 qy = _mm_add_ps(_mm_mul_ps(czsy, cx), _mm_mul_ps(szcy, sx));
+			__m128 qz = _mm_sub_ps(_mm_mul_ps(szcy, cx), _mm_mul_ps(czsy, sx));
+			__m128 qw = _mm_add_ps(_mm_mul_ps(czcy, cx), _mm_mul_ps(szsy, sx));
+			_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+			_mm_storeu_ps(&out[i + 0].x, qx);
+			_mm_storeu_ps(&out[i + 1].x, qy);
+			_mm_storeu_ps(&out[i + 2].x, qz);
+			_mm_storeu_ps(&out[i + 3].x, qw);
+		}
+		for (; i < count; ++i)
+			out[i] = from_euler(rotations[i]);
+	}
+
+	quat slerp(const quat& a, const quat& b, float t)
+	{
+		float d = a.dot(b);
+		float sign = d < 0.0f ? -1.0f : 1.0f;
+		d *= sign;
+		if (d > 0.9995f) // sin(theta) is too small to divide by, and nlerp is exact enough
+			return nlerp(a, b, t);
+		const float theta = acosf(d);
+		const float angles[3] = { theta, (1.0f - t) * theta, t * theta };
+		float sines[3], cosines[3];
+		sincos(angles, sines, cosines, 3);
+		const float inv = 1.0f / sines[0];
+		const float ta = sines[1] * inv;
+		const float tb = sines[2] * inv * sign;
+		return quat(a.x*ta + b.x*tb, a.y*ta + b.y*tb, a.z*ta + b.z*tb, a.w*ta + b.w*tb);
+	}
+
+	// a * ta + b * tb for 4 quaternions, transposed to one component per register,
+	// with b flipped onto a's hemisphere and the result normalized
+	template<class TWeight> static void quat_blend4(quat* out, const quat* a, const quat* b, TWeight weight)
+	{
+		__m128 ax = _mm_loadu_ps(&a[0].x), ay = _mm_loadu_ps(&a[1].x), az = _mm_loadu_ps(&a[2].x), aw = _mm_loadu_ps(&a[3].x);
+		__m128 bx = _mm_loadu_ps(&b[0].x), by = _mm_loadu_ps(&b[1].x), bz = _mm_loadu_ps(&b[2].x), bw = _mm_loadu_ps(&b[3].x);
+		_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+		_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+		                      _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		__m128 sign = _mm_and_ps(d, signBit);
+		__m128 ta, tb;
+		weight(_mm_andnot_ps(signBit, d), ta, tb);
+		tb = _mm_xor_ps(tb, sign);
+
+		__m128 rx = _mm_add_ps(_mm_mul_ps(ax, ta), _mm_mul_ps(bx, tb));
+		__m128 ry = _mm_add_ps(_mm_mul_ps(ay, ta), _mm_mul_ps(by, tb));
+		__m128 rz = _mm_add_ps(_mm_mul_ps(az, ta), _mm_mul_ps(bz, tb));
+		__m128 rw = _mm_add_ps(_mm_mul_ps(aw, ta), _mm_mul_ps(bw, tb));
+		__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)),
+		                                    _mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw))));
+		__m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), len);
+		rx = _mm_mul_ps(rx, inv), ry = _mm_mul_ps(ry, inv), rz = _mm_mul_ps(rz, inv), rw = _mm_mul_ps(rw, inv);
+
+		_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+		_mm_storeu_ps(&out[0].x, rx);
+		_mm_storeu_ps(&out[1].x, ry);
+		_mm_storeu_ps(&out[2].x, rz);
+		_mm_storeu_ps(&out[3].x, rw);
+	}
+
+	void nlerp(quat* out, const quat* a, const quat* b, float t, int count)
+	{
+		const __m128 ta = _mm_set1_ps(1.0f - t), tb = _mm_set1_ps(t);
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+			quat_blend4(out + i, a + i, b + i, [&](__m128, __m128& outA, __m128& outB) { outA = ta, outB = tb; });
+		for (; i < count; ++i)
+			out[i] = nlerp(a[i], b[i], t);
+	}
+
+	// corrects t so that nlerp follows the arc at constant speed, fitted against slerp
+	// over the whole range of d = |dot(a,b)|; A and B are cubic and quadratic in d
+	static float slerp_t(float t, float d)
+	{
+		const float A = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+		const float B = 0.848013f + d * (-1.06021f + d * 0.215638f);
+		const float k = A * (t - 0.5f) * (t - 0.5f) + B;
+		return t + t * (t - 0.5f) * (t - 1.0f) * k;
+	}
+
+	void slerp(quat* out, const quat* a, const quat* b, float t, int count)
+	{
+		const __m128 half = _mm_set1_ps((t - 0.5f) * (t - 0.5f));
+		const __m128 cubic = _mm_set1_ps(t * (t - 0.5f) * (t - 1.0f));
+		const __m128 vt = _mm_set1_ps(t), one = _mm_set1_ps(1.0f);
+		auto weight = [&](__m128 d, __m128& outA, __m128& outB)
+		{
+			__m128 A = _mm_add_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(-1.43519f)));
+			A = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, A));
+			A = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, A));
+			__m128 B = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+			B = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, B));
+			__m128 k = _mm_add_ps(_mm_mul_ps(A, half), B);
+			outB = _mm_add_ps(vt, _mm_mul_ps(cubic, k));
+			outA = _mm_sub_ps(one, outB);
 		};
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+			quat_blend4(out + i, a + i, b + i, weight);
+		for (; i < count; ++i)
+			out[i] = nlerp(a[i], b[i], slerp_t(t, fabsf(a[i].dot(b[i]))));
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
 
-	const mat4 IDENTITY = {
-		1, 0, 0, 0, 
-		0, 1, 0, 0, 
-		0, 0, 1, 0, 
-		0, 0, 0, 1,
-	};
-
 	mat4& mat4::identity()
 	{
 		return (*this = IDENTITY);
@@ -112,11 +316,11 @@ namespace itc
 	}
 	mat4& mat4::rotate(float angleDegs, const vec3& rotationAxis)
 	{
-		float rad = radf(angleDegs);
-		float c = cosf(rad);
+		float s, c;
+		sincos(radf(angleDegs), s, c);
 		vec3 axis  = (rotationAxis).normalized();
 		vec3 temp  = axis * (1.0f - c);
-		vec3 sAxis = axis * sinf(rad);
+		vec3 sAxis = axis * s;
 		vec3 r0 = { c + temp.x*axis.x, 
 						temp.x*axis.y + sAxis.z,
 						temp.x*axis.z - sAxis.y, };
@@ -146,25 +350,20 @@ namespace itc
 
 	mat4& mat4::ortho(float left, float right, float bottom, float top)
 	{
-		const float rl = right - left;
-		const float tb = top - bottom;
-		m00 = 2.0f / rl, m01 = 0.0f, m02 = 0.0f,  m03 = 0.0f;
-		m10 = 0.0f, m11 = 2.0f / tb, m12 = 0.0f,  m13 = 0.0f;
-		m20 = 0.0f, m21 = 0.0f,      m22 = -1.0f, m23 = 0.0f;
-		m30 = -(right+left)/rl, m31 = -(top+bottom)/tb, m32 = 0.0f, m33 = 1.0f;
-		return *this;
+		return (*this = from_ortho(left, right, bottom, top));
 	}
 
 	mat4& mat4::perspective(float fov, float width, float height, float zNear, float zFar)
 	{
-		const float rad2 = radf(fov) * 0.5f;
-		const float h = cosf(rad2) / sinf(rad2);
+		float s, c;
+		sincos(radf(fov) * 0.5f, s, c);
+		const float h = c / s;
 		const float w = (h * height) / width;
 		const float range = zFar - zNear;
 		m00 = w, m01 = 0, m02 = 0, m03 = 0;
 		m10 = 0, m11 = h, m12 = 0, m13 = 0;
 		m20 = 0, m21 = 0, m22 = -(zFar + zNear) / range, m23 = -1;
-		m30 = 0, m31 = 0, m32 = (-2.0f * zFar * zNear) / range, m33 = 1;
+		m30 = 0, m31 = 0, m32 = (-2.0f * zFar * zNear) / range, m33 = 0;
 		return *this;
 	}
 
@@ -180,15 +379,135 @@ namespace itc
 		return *this;
 	}
 
+	#define SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+	#define SWIZZLE(a, x, y, z, w)    _mm_shuffle_ps(a, a, _MM_SHUFFLE(w, z, y, x))
+
+	// products of 2x2 matrices packed as (m00, m01, m10, m11)
+	static inline __m128 mat2_mul(__m128 a, __m128 b) // a * b
+	{
+		return _mm_add_ps(_mm_mul_ps(a, SWIZZLE(b, 0,3,0,3)), _mm_mul_ps(SWIZZLE(a, 1,0,3,2), SWIZZLE(b, 2,1,2,1)));
+	}
+	static inline __m128 mat2_adj_mul(__m128 a, __m128 b) // adjugate(a) * b
+	{
+		return _mm_sub_ps(_mm_mul_ps(SWIZZLE(a, 3,3,0,0), b), _mm_mul_ps(SWIZZLE(a, 1,1,2,2), SWIZZLE(b, 2,3,0,1)));
+	}
+	static inline __m128 mat2_mul_adj(__m128 a, __m128 b) // a * adjugate(b)
+	{
+		return _mm_sub_ps(_mm_mul_ps(a, SWIZZLE(b, 3,0,3,0)), _mm_mul_ps(SWIZZLE(a, 1,0,3,2), SWIZZLE(b, 2,1,2,1)));
+	}
+
+	mat4 mat4::inverse() const
+	{
+		// blockwise inversion of | A B | with 2x2 blocks, using adjugates instead of inverses
+		//                        | C D |
+		const __m128 r0 = _mm_loadu_ps(&m00), r1 = _mm_loadu_ps(&m10);
+		const __m128 r2 = _mm_loadu_ps(&m20), r3 = _mm_loadu_ps(&m30);
+		const __m128 A = _mm_movelh_ps(r0, r1), B = _mm_movehl_ps(r1, r0);
+		const __m128 C = _mm_movelh_ps(r2, r3), D = _mm_movehl_ps(r3, r2);
+
+		// (|A|, |B|, |C|, |D|)
+		const __m128 dets = _mm_sub_ps(_mm_mul_ps(SHUFFLE(r0, r2, 0,2,0,2), SHUFFLE(r1, r3, 1,3,1,3)),
+		                               _mm_mul_ps(SHUFFLE(r0, r2, 1,3,1,3), SHUFFLE(r1, r3, 0,2,0,2)));
+		const __m128 detA = SWIZZLE(dets, 0,0,0,0), detB = SWIZZLE(dets, 1,1,1,1);
+		const __m128 detC = SWIZZLE(dets, 2,2,2,2), detD = SWIZZLE(dets, 3,3,3,3);
+
+		const __m128 DC = mat2_adj_mul(D, C);
+		const __m128 AB = mat2_adj_mul(A, B);
+		__m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), mat2_mul(B, DC));
+		__m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), mat2_mul(C, AB));
+		__m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), mat2_mul_adj(D, AB));
+		__m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), mat2_mul_adj(A, DC));
+
+		// |M| = |A||D| + |B||C| - trace(AB * DC)
+		__m128 tr = _mm_mul_ps(AB, SWIZZLE(DC, 0,2,1,3));
+		tr = _mm_add_ps(tr, _mm_movehl_ps(tr, tr));
+		tr = _mm_add_ss(tr, SWIZZLE(tr, 1,1,1,1));
+		__m128 det = _mm_sub_ss(_mm_add_ss(_mm_mul_ss(detA, detD), _mm_mul_ss(detB, detC)), tr);
+		det = SWIZZLE(det, 0,0,0,0);
+		const __m128 invDet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+		X = _mm_mul_ps(X, invDet);
+		Y = _mm_mul_ps(Y, invDet);
+		Z = _mm_mul_ps(Z, invDet);
+		W = _mm_mul_ps(W, invDet);
+
+		// the shuffles finish the adjugates and put the blocks back into rows
+		mat4 inv;
+		_mm_storeu_ps(&inv.m00, SHUFFLE(X, Y, 3,1,3,1));
+		_mm_storeu_ps(&inv.m10, SHUFFLE(X, Y, 2,0,2,0));
+		_mm_storeu_ps(&inv.m20, SHUFFLE(Z, W, 3,1,3,1));
+		_mm_storeu_ps(&inv.m30, SHUFFLE(Z, W, 2,0,2,0));
+		return inv;
+	}
+
+	static inline __m128 cross3(__m128 a, __m128 b)
+	{
+		return _mm_sub_ps(_mm_mul_ps(SWIZZLE(a, 1,2,0,3), SWIZZLE(b, 2,0,1,3)),
+		                  _mm_mul_ps(SWIZZLE(a, 2,0,1,3), SWIZZLE(b, 1,2,0,3)));
+	}
+
+	// the columns of the inverse of the upper 3x3 are cross products of its rows over the determinant,
+	// and they have w = 0 because the rows of an affine matrix do
+	static inline void inverse3_rows(const mat4& m, __m128& i0, __m128& i1, __m128& i2)
+	{
+		const __m128 r0 = _mm_loadu_ps(&m.m00), r1 = _mm_loadu_ps(&m.m10), r2 = _mm_loadu_ps(&m.m20);
+		const __m128 c12 = cross3(r1, r2), c20 = cross3(r2, r0), c01 = cross3(r0, r1);
+		__m128 det = _mm_mul_ps(r0, c12);
+		det = _mm_add_ps(det, _mm_movehl_ps(det, det));
+		det = _mm_add_ss(det, SWIZZLE(det, 1,1,1,1));
+		const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), SWIZZLE(det, 0,0,0,0));
+		i0 = _mm_mul_ps(c12, invDet);
+		i1 = _mm_mul_ps(c20, invDet);
+		i2 = _mm_mul_ps(c01, invDet);
+	}
+
+	mat4 mat4::affine_inverse() const
+	{
+		__m128 i0, i1, i2, i3 = _mm_setzero_ps();
+		inverse3_rows(*this, i0, i1, i2);
+		_MM_TRANSPOSE4_PS(i0, i1, i2, i3);
+
+		// translation moves back by the inverse rotation and scale of the offset
+		__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(i0, _mm_set1_ps(m30)), _mm_mul_ps(i1, _mm_set1_ps(m31))),
+		                      _mm_mul_ps(i2, _mm_set1_ps(m32)));
+		t = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), t);
+
+		mat4 inv;
+		_mm_storeu_ps(&inv.m00, i0);
+		_mm_storeu_ps(&inv.m10, i1);
+		_mm_storeu_ps(&inv.m20, i2);
+		_mm_storeu_ps(&inv.m30, t);
+		return inv;
+	}
+
+	mat4 mat4::normal_matrix() const
+	{
+		// the columns of the inverse stored as rows are already its transpose
+		__m128 i0, i1, i2;
+		inverse3_rows(*this, i0, i1, i2);
+		mat4 n;
+		_mm_storeu_ps(&n.m00, i0);
+		_mm_storeu_ps(&n.m10, i1);
+		_mm_storeu_ps(&n.m20, i2);
+		_mm_storeu_ps(&n.m30, _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+		return n;
+	}
+
+	#undef SHUFFLE
+	#undef SWIZZLE
+
 	// creates a translated matrix from XYZ position
 	mat4& mat4::from_position(mat4& m, const vec3& pos)
 	{
-		return m.identity().translate(pos);
+		return (m = from_position(pos));
 	}
 
 	mat4& mat4::from_rotation(mat4& m, const vec3& rotation)
 	{
-		vec4 q = quat_from_rotation(rotation);
+		return from_rotation(m, quat::from_euler(rotation));
+	}
+
+	mat4& mat4::from_rotation(mat4& m, const quat& q)
+	{
 		m.m00 = 1 - 2 * q.y * q.y - 2 * q.z * q.z;
 		m.m01 = 2 * q.x * q.y + 2 * q.w * q.z;
 		m.m02 = 2 * q.x * q.z - 2 * q.w * q.y;
@@ -210,12 +529,35 @@ namespace itc
 
 	mat4& mat4::from_scale(mat4& m, const vec3& sc)
 	{
-		m.m00 = sc.x, m.m01 = 0.0f, m.m02 = 0.0f, m.m03 = 0.0f;
-		m.m10 = 0.0f, m.m11 = sc.y, m.m12 = 0.0f, m.m13 = 0.0f;
-		m.m20 = 0.0f, m.m21 = 0.0f, m.m22 = sc.z, m.m23 = 0.0f;
-		m.m30 = 0.0f, m.m31 = 0.0f, m.m32 = 0.0f, m.m33 = 1.0f;
-		return m;
+		return (m = from_scale(sc));
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	Frustum::Frustum(const mat4& m) // Gribb-Hartmann plane extraction
+	{
+		const vec4 row0 = { m.m00, m.m10, m.m20, m.m30 };
+		const vec4 row1 = { m.m01, m.m11, m.m21, m.m31 };
+		const vec4 row2 = { m.m02, m.m12, m.m22, m.m32 };
+		const vec4 row3 = { m.m03, m.m13, m.m23, m.m33 };
+		planes[0] = row3 + row0;
+		planes[1] = row3 - row0;
+		planes[2] = row3 + row1;
+		planes[3] = row3 - row1;
+		planes[4] = row3 + row2;
+		planes[5] = row3 - row2;
+		for (vec4& p : planes) {
+			float inv = 1.0f / sqrtf(p.x*p.x + p.y*p.y + p.z*p.z);
+			p = p * inv;
+		}
 	}
 
+	bool Frustum::sphereVisible(const vec3& c, float radius) const
+	{
+		for (const vec4& p : planes)
+			if (p.x*c.x + p.y*c.y + p.z*c.z + p.w < -radius)
+				return false;
+		return true;
+	}
 
 }
\ No newline at end of file
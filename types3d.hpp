@@ -8,6 +8,16 @@ namespace itc
 
 	float radf(float degrees);
 
+	// sin and cos of count angles in radians, 4 at a time with SSE polynomials instead of libm
+	// max abs error 1.2e-6 for |angle| < 8192 (libm sinf is 3e-8)
+	void sincos(const float* angles, float* outSin, float* outCos, int count);
+
+	// same as sincos() with slower polynomials, max abs error 1e-7 for |angle| < 8192
+	void sincos_precise(const float* angles, float* outSin, float* outCos, int count);
+
+	// sin and cos of one angle with the same polynomials
+	void sincos(float angle, float& outSin, float& outCos);
+
 	////////////////////////////////////////////////////////////////////////////////
 
 	// 2D position vector - typical UV container or 2D coordinate
@@ -16,8 +26,10 @@ namespace itc
 		static const vec2 ZERO; // Represents vec2 {0,0}
 		float x, y;
 
-		float len()   const { return sqrtf(x*x + y*y); }
-		float sqlen() const { return x*x + y*y; }
+		vec2() = default;
+		constexpr vec2(float x, float y) : x(x), y(y) {}
+		float len()             const { return sqrtf(x*x + y*y); }
+		constexpr float sqlen() const { return x*x + y*y; }
 		vec2& normalize() {
 			float sqr = x*x + y*y;
 			float inv = 1.0f / sqrtf(sqr);
@@ -42,12 +54,12 @@ namespace itc
 		static const vec3 ZAXIS; // Represents vec3 {0,0,1}
 		float x, y, z;
 
-		vec3() {}
-		vec3(float x, float y, float z) : x(x), y(y), z(z) {}
-		vec3 cross(const vec3& b) const { return vec3(y*b.z - b.y*z, z*b.x - b.z*x, x*b.y - b.x*y); }
-		float dot(const vec3& b) const { return x*b.x + y*b.y + z*b.z; }
-		float len(vec3 v)   const { return sqrtf(v.x*v.x + v.y*v.y + v.z*v.z); }
-		float sqlen(vec3 v) const { return v.x*v.x + v.y*v.y + v.z*v.z; }
+		vec3() = default;
+		constexpr vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+		constexpr vec3 cross(const vec3& b) const { return vec3(y*b.z - b.y*z, z*b.x - b.z*x, x*b.y - b.x*y); }
+		constexpr float dot(const vec3& b) const { return x*b.x + y*b.y + z*b.z; }
+		float len(vec3 v)             const { return sqrtf(v.x*v.x + v.y*v.y + v.z*v.z); }
+		constexpr float sqlen(vec3 v) const { return v.x*v.x + v.y*v.y + v.z*v.z; }
 		vec3& normalize() {
 			float sqr = x*x + y*y + z*z;
 			float inv = 1.0f / sqrtf(sqr);
@@ -61,53 +73,104 @@ namespace itc
 		}
 	}; 
 
-	inline vec3 operator+(const vec3& a, const vec3& b) { return vec3(a.x+b.x, a.y+b.y, a.z+b.z); }
-	inline vec3 operator-(const vec3& a, const vec3& b) { return vec3(a.x-b.x, a.y-b.y, a.z-b.z); }
-	inline vec3 operator*(const vec3& a, const vec3& b) { return vec3(a.x*b.x, a.y*b.y, a.z*b.z); }
-	inline vec3 operator/(const vec3& a, const vec3& b) { return vec3(a.x/b.x, a.y/b.y, a.z/b.z); }
-	inline vec3 operator+(const vec3& a, float v) { return vec3(a.x+v, a.y+v, a.z+v); }
-	inline vec3 operator-(const vec3& a, float v) { return vec3(a.x-v, a.y-v, a.z-v); }
-	inline vec3 operator*(const vec3& a, float v) { return vec3(a.x*v, a.y*v, a.z*v); }
-	inline vec3 operator/(const vec3& a, float v) { return vec3(a.x/v, a.y/v, a.z/v); }
+	constexpr vec3 operator+(const vec3& a, const vec3& b) { return vec3(a.x+b.x, a.y+b.y, a.z+b.z); }
+	constexpr vec3 operator-(const vec3& a, const vec3& b) { return vec3(a.x-b.x, a.y-b.y, a.z-b.z); }
+	constexpr vec3 operator*(const vec3& a, const vec3& b) { return vec3(a.x*b.x, a.y*b.y, a.z*b.z); }
+	constexpr vec3 operator/(const vec3& a, const vec3& b) { return vec3(a.x/b.x, a.y/b.y, a.z/b.z); }
+	constexpr vec3 operator+(const vec3& a, float v) { return vec3(a.x+v, a.y+v, a.z+v); }
+	constexpr vec3 operator-(const vec3& a, float v) { return vec3(a.x-v, a.y-v, a.z-v); }
+	constexpr vec3 operator*(const vec3& a, float v) { return vec3(a.x*v, a.y*v, a.z*v); }
+	constexpr vec3 operator/(const vec3& a, float v) { return vec3(a.x/v, a.y/v, a.z/v); }
+
+	// linear interpolation between a and b: t=0 gives a, t=1 gives b
+	constexpr vec3 lerp(const vec3& a, const vec3& b, float t) { return a + (b - a) * t; }
 
 	////////////////////////////////////////////////////////////////////////////////
 
-	// 4D float vector - used for Quaternions and RGBA colors
+	// 4D float vector - used for RGBA colors and plane equations
+	// an aggregate without constructors, because mat4 puts it in an anonymous struct; vec4{x,y,z,w} is still constexpr
 	struct vec4
 	{
 		static const vec4 ZERO; // Represents vec4 {0,0,0,0}
 		float x, y, z, w;
 
 		void set(float X, float Y, float Z, float W) { x=X,y=Y,z=Z,w=W; }
-
-
 	};
 
-	inline vec4 operator+(const vec4& a, const vec4& b) { return vec4{a.x+b.x, a.y+b.y, a.z+b.z, a.w+b.w}; }
-	inline vec4 operator-(const vec4& a, const vec4& b) { return vec4{a.x-b.x, a.y-b.y, a.z-b.z, a.w-b.w}; }
-	inline vec4 operator*(const vec4& a, const vec4& b) { return vec4{a.x*b.x, a.y*b.y, a.z*b.z, a.w*b.w}; }
-	inline vec4 operator/(const vec4& a, const vec4& b) { return vec4{a.x/b.x, a.y/b.y, a.z/b.z, a.w/b.w}; }
-	inline vec4 operator+(const vec4& a, float v) { return vec4{a.x+v, a.y+v, a.z+v, a.w+v}; }
-	inline vec4 operator-(const vec4& a, float v) { return vec4{a.x-v, a.y-v, a.z-v, a.w-v}; }
-	inline vec4 operator*(const vec4& a, float v) { return vec4{a.x*v, a.y*v, a.z*v, a.w*v}; }
-	inline vec4 operator/(const vec4& a, float v) { return vec4{a.x/v, a.y/v, a.z/v, a.w/v}; }
+	constexpr vec4 operator+(const vec4& a, const vec4& b) { return vec4{a.x+b.x, a.y+b.y, a.z+b.z, a.w+b.w}; }
+	constexpr vec4 operator-(const vec4& a, const vec4& b) { return vec4{a.x-b.x, a.y-b.y, a.z-b.z, a.w-b.w}; }
+	constexpr vec4 operator*(const vec4& a, const vec4& b) { return vec4{a.x*b.x, a.y*b.y, a.z*b.z, a.w*b.w}; }
+	constexpr vec4 operator/(const vec4& a, const vec4& b) { return vec4{a.x/b.x, a.y/b.y, a.z/b.z, a.w/b.w}; }
+	constexpr vec4 operator+(const vec4& a, float v) { return vec4{a.x+v, a.y+v, a.z+v, a.w+v}; }
+	constexpr vec4 operator-(const vec4& a, float v) { return vec4{a.x-v, a.y-v, a.z-v, a.w-v}; }
+	constexpr vec4 operator*(const vec4& a, float v) { return vec4{a.x*v, a.y*v, a.z*v, a.w*v}; }
+	constexpr vec4 operator/(const vec4& a, float v) { return vec4{a.x/v, a.y/v, a.z/v, a.w/v}; }
 
 	////////////////////////////////////////////////////////////////////////////////
 
+	// Unit quaternion rotation - xyz = axis * sin(angle/2), w = cos(angle/2)
+	struct quat
+	{
+		static const quat IDENTITY; // Represents quat {0,0,0,1}, no rotation
+		float x, y, z, w;
+
+		quat() = default;
+		constexpr quat(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+
+		constexpr float dot(const quat& b) const { return x*b.x + y*b.y + z*b.z + w*b.w; }
+		// inverse rotation of a unit quaternion
+		constexpr quat conjugate() const { return quat(-x, -y, -z, w); }
+		quat& normalize() {
+			float inv = 1.0f / sqrtf(x*x + y*y + z*z + w*w);
+			x*=inv, y*=inv, z*=inv, w*=inv;
+			return *this;
+		}
+		quat normalized() const {
+			float inv = 1.0f / sqrtf(x*x + y*y + z*z + w*w);
+			return quat(x*inv, y*inv, z*inv, w*inv);
+		}
+
+		// rotates vector v by this quaternion
+		vec3 rotate(const vec3& v) const;
+
+		// creates a rotation of angleDegs around a unit length axis
+		static quat from_angle_axis(float angleDegs, const vec3& axis);
+
+		// creates a rotation from euler XYZ (degrees), X is applied first and Z last
+		static quat from_euler(const vec3& rotation);
+
+		// from_euler of count rotations, 4 at a time with SSE
+		static void from_euler(quat* out, const vec3* rotations, int count);
+	};
 
-	// creates a quaternion rotation from an euler angle (degrees), rotation axis must be specified
-	vec4 quat_angle_axis(float angle, const vec3& axis);
+	// rotates p with an extra rotation q, so q is applied after p
+	constexpr quat operator*(const quat& q, const quat& p)
+	{
+		return quat(
+			q.w*p.x + q.x*p.w + q.y*p.z - q.z*p.y,
+			q.w*p.y + q.y*p.w + q.z*p.x - q.x*p.z,
+			q.w*p.z + q.z*p.w + q.x*p.y - q.y*p.x,
+			q.w*p.w - q.x*p.x - q.y*p.y - q.z*p.z);
+	}
+
+	// normalized linear interpolation along the shortest arc: t=0 gives a, t=1 gives b
+	// no trig, but the angular speed isn't constant, which is invisible for small steps
+	inline quat nlerp(const quat& a, const quat& b, float t)
+	{
+		float tb = a.dot(b) < 0.0f ? -t : t;
+		float ta = 1.0f - t;
+		return quat(a.x*ta + b.x*tb, a.y*ta + b.y*tb, a.z*ta + b.z*tb, a.w*ta + b.w*tb).normalized();
+	}
 
-	// creates a quaternion rotation from an euler angle (degrees), rotation axis must be specified
-	vec4 quat_angle_axis(float angle, float x, float y, float z);
+	// spherical linear interpolation along the shortest arc, constant angular speed
+	quat slerp(const quat& a, const quat& b, float t);
 
-	// creates a quaternion rotation from euler XYZ (degrees) rotation 
-	vec4 quat_from_rotation(const vec3& rotation);
+	// nlerp of count quaternion pairs with the same t, 4 at a time with SSE
+	void nlerp(quat* out, const quat* a, const quat* b, float t, int count);
 
-	// rotates quaternion p with extra rotation p
-	// q = additional rotation we wish to rotate with
-	// p = original rotation
-	vec4 quat_mul(const vec4& q, const vec4& p);
+	// approximate slerp of count quaternion pairs with the same t, 4 at a time with SSE
+	// nlerp with t corrected by a polynomial fit, so there's no trig; max error 0.0008 rad (0.05 degrees)
+	void slerp(quat* out, const quat* a, const quat* b, float t, int count);
 
 	////////////////////////////////////////////////////////////////////////////////
 	// A 4x4 matrix for affine transformations
@@ -136,15 +199,17 @@ namespace itc
 			vec4 r[4]; // rows 0-3
 		};
 
-		mat4() {}
-		mat4(float m00, float m01, float m02, float m03, 
-			 float m10, float m11, float m12, float m13,
-			 float m20, float m21, float m22, float m23,
-			 float m30, float m31, float m32, float m33)
-			: m00(m00), m01(m01), m02(m02), m03(m03),
-			  m10(m10), m11(m11), m12(m12), m13(m13),
-			  m20(m20), m21(m21), m22(m22), m23(m23),
-			  m30(m30), m31(m31), m32(m32), m33(m33) {}
+		mat4() = default;
+		// initializes the m[] member of the union, so the result can be a compile time constant;
+		// constant expressions must read it back through m[] too
+		constexpr mat4(float m00, float m01, float m02, float m03, 
+		               float m10, float m11, float m12, float m13,
+		               float m20, float m21, float m22, float m23,
+		               float m30, float m31, float m32, float m33)
+			: m{ m00, m01, m02, m03,
+			     m10, m11, m12, m13,
+			     m20, m21, m22, m23,
+			     m30, m31, m32, m33 } {}
 
 		// initializes a new identity matrix
 		mat4& identity();
@@ -179,18 +244,74 @@ namespace itc
 		// creates a lookat view/camera matrix
 		mat4& lookat(const vec3& eye, const vec3& center, const vec3& up);
 
+		// general inverse with SSE, the result is undefined if the matrix is singular (determinant 0)
+		mat4 inverse() const;
+
+		// inverse of a translate * rotate * scale transform, much cheaper than inverse()
+		// the 4th component of each row must be 0, 0, 0, 1 as built by translate/rotate/scale
+		mat4 affine_inverse() const;
+
+		// inverse-transpose of the upper 3x3, for transforming normals by a model or
+		// modelview matrix with non-uniform scale; translation is cleared
+		mat4 normal_matrix() const;
+
 		// creates a translated matrix from XYZ position
 		static mat4& from_position(mat4& out, const vec3& position);
+		static constexpr mat4 from_position(const vec3& p)
+		{
+			return mat4(1.0f, 0.0f, 0.0f, 0.0f,
+			            0.0f, 1.0f, 0.0f, 0.0f,
+			            0.0f, 0.0f, 1.0f, 0.0f,
+			            p.x,  p.y,  p.z,  1.0f);
+		}
 
 		// creates a rotated matrix from euler XYZ rotation
 		static mat4& from_rotation(mat4& out, const vec3& rotation);
 
+		// creates a rotated matrix from a unit quaternion
+		static mat4& from_rotation(mat4& out, const quat& rotation);
+
 		// creates a scaled matrix from XYZ scale
 		static mat4& from_scale(mat4& out, const vec3& scale);
+		static constexpr mat4 from_scale(const vec3& s)
+		{
+			return mat4(s.x,  0.0f, 0.0f, 0.0f,
+			            0.0f, s.y,  0.0f, 0.0f,
+			            0.0f, 0.0f, s.z,  0.0f,
+			            0.0f, 0.0f, 0.0f, 1.0f);
+		}
+
+		// creates an ortographic projection matrix, a compile time constant for constant bounds
+		static constexpr mat4 from_ortho(float left, float right, float bottom, float top)
+		{
+			return mat4(2.0f / (right - left), 0.0f, 0.0f, 0.0f,
+			            0.0f, 2.0f / (top - bottom), 0.0f, 0.0f,
+			            0.0f, 0.0f, -1.0f, 0.0f,
+			            -(right + left) / (right - left), -(top + bottom) / (top - bottom), 0.0f, 1.0f);
+		}
 	};
 
 	// global identity matrix for easy initialization
-	extern const struct mat4 IDENTITY;
+	constexpr mat4 IDENTITY = {
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1,
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+
+	// view frustum planes extracted from a view-projection matrix, normals point inwards
+	struct Frustum
+	{
+		vec4 planes[6]; // left, right, bottom, top, near, far; xyz = normal, w = distance
+
+		Frustum() {}
+		explicit Frustum(const mat4& viewProj);
+
+		// true if the sphere is at least partially inside the frustum
+		bool sphereVisible(const vec3& center, float radius) const;
+	};
 
 	////////////////////////////////////////////////////////////////////////////////
 }
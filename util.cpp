@@ -13,6 +13,15 @@ namespace itc
 		return false;
 	}
 
+	bool loadTexture(Texture& outTexture, const Image& image)
+	{
+		if (outTexture.loadFromImage(image)) {
+			outTexture.setSmooth(true);
+			return true;
+		}
+		return false;
+	}
+
 	Text& createText(Text& outText, const Font& font, const string& str, int size)
 	{
 		outText.setFont(font);
@@ -21,6 +30,17 @@ namespace itc
 		return outText;
 	}
 
+	void writeJsonString(FILE* f, const char* str)
+	{
+		fputc('"', f);
+		for (const char* c = str; *c; ++c) {
+			if (*c == '"' || *c == '\\') fputc('\\', f);
+			if ((unsigned char)*c < 0x20) fprintf(f, "\\u%04x", (unsigned char)*c);
+			else fputc(*c, f);
+		}
+		fputc('"', f);
+	}
+
 }
 
 ////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include <SFML/Graphics.hpp>
 #include <iostream>
+#include <stdio.h>
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -13,8 +14,14 @@ namespace itc
 	/** @return true if the texture was loaded */
 	bool loadTexture(Texture& outTexture, const string& filename);
 
+	/** @return true if the texture was created from an already decoded image */
+	bool loadTexture(Texture& outTexture, const Image& image);
+
 	/** @brief Simplifies Text creation */
 	Text& createText(Text& outText, const Font& font, const string& str, int size);
+
+	/** @brief Writes str as a JSON string literal, quotes included */
+	void writeJsonString(FILE* f, const char* str);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file